@@ -43,11 +43,13 @@ extern "C" {
 #include <stdarg.h>
 
 #include <tarantool/tnt_mem.h>
+#include <tarantool/tnt_arena.h>
 #include <tarantool/tnt_proto.h>
 #include <tarantool/tnt_reply.h>
 #include <tarantool/tnt_stream.h>
 #include <tarantool/tnt_buf.h>
 #include <tarantool/tnt_object.h>
+#include <tarantool/tnt_format.h>
 #include <tarantool/tnt_iter.h>
 #include <tarantool/tnt_call.h>
 #include <tarantool/tnt_execute.h>
@@ -57,6 +59,7 @@ extern "C" {
 #include <tarantool/tnt_auth.h>
 #include <tarantool/tnt_select.h>
 #include <tarantool/tnt_update.h>
+#include <tarantool/tnt_batch.h>
 #include <tarantool/tnt_schema.h>
 #include <tarantool/tnt_request.h>
 
@@ -0,0 +1,86 @@
+#ifndef TNT_ARENA_H_INCLUDED
+#define TNT_ARENA_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file tnt_arena.h
+ * \brief Arena (bump) allocator
+ */
+
+struct tnt_arena_chunk;
+
+/**
+ * \brief Arena allocator
+ *
+ * Memory is taken from chunks one after another, it's freed only by
+ * tnt_arena_reset() (all at once) or by tnt_arena_destroy(). Freeing
+ * of a single block is no-op, except the last allocated one.
+ */
+struct tnt_arena {
+	struct tnt_mem_ctx ctx;        /*!< allocator interface */
+	struct tnt_arena_chunk *first; /*!< list of chunks */
+	struct tnt_arena_chunk *chunk; /*!< current chunk */
+	size_t chunk_size;             /*!< minimal size of chunk */
+	char *last;                    /*!< last allocated block */
+};
+
+/**
+ * \brief Initialize arena
+ *
+ * \param a          arena pointer
+ * \param chunk_size minimal size of memory chunk (0 for default)
+ *
+ * \returns allocator context of arena for tnt_stream_mem()
+ */
+struct tnt_mem_ctx *
+tnt_arena_init(struct tnt_arena *a, size_t chunk_size);
+
+/**
+ * \brief Free all memory allocated from arena at once
+ *
+ * Chunks are kept for next allocations.
+ */
+void
+tnt_arena_reset(struct tnt_arena *a);
+
+/**
+ * \brief Release chunks of arena
+ */
+void
+tnt_arena_destroy(struct tnt_arena *a);
+
+/**
+ * \brief Count of bytes allocated from arena since reset
+ */
+size_t
+tnt_arena_used(struct tnt_arena *a);
+
+#endif /* TNT_ARENA_H_INCLUDED */
@@ -0,0 +1,63 @@
+#ifndef TNT_BATCH_H_INCLUDED
+#define TNT_BATCH_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file tnt_batch.h
+ * \brief Batch of homogeneous requests
+ */
+
+/**
+ * \brief Construct batch of requests of one type and write it into stream
+ *
+ * Requests are encoded by single pass into one contiguous buffer, which
+ * is written to stream at once. They get consecutive syncs, so replies
+ * of i-th request has sync + i.
+ *
+ * \param s     stream object to write requests to
+ * \param op    TNT_OP_INSERT, TNT_OP_REPLACE (items are tuples),
+ *              TNT_OP_DELETE or TNT_OP_SELECT (items are keys)
+ * \param space space no
+ * \param index index no for delete and select
+ * \param items (tnt_object instances) msgpack arrays with tuples or keys
+ * \param count count of items
+ * \param sync  sync of the first request (may be NULL)
+ *
+ * \returns count of written requests, it is less than count, if
+ *          non-blocking stream accepted only a part of batch
+ * \retval  -1 error
+ */
+int
+tnt_batch(struct tnt_stream *s, enum tnt_request_t op, uint32_t space,
+	  uint32_t index, struct tnt_stream **items, int count,
+	  uint64_t *sync);
+
+#endif /* TNT_BATCH_H_INCLUDED */
@@ -52,6 +52,8 @@ struct tnt_stream_buf {
 	void  (*free)(struct tnt_stream *); /*!< custom free function */
 	void   *subdata; /*!< subclass */
 	int     as;      /*!< constructed from user's string */
+	char   *storage; /*!< caller's memory, data is there until it grows
+			  * \sa tnt_buf_inline */
 };
 
 /* buffer stream accessors */
@@ -85,4 +87,52 @@ tnt_buf(struct tnt_stream *s);
 struct tnt_stream *
 tnt_buf_as(struct tnt_stream *s, char *buf, size_t buf_len);
 
+/**
+ * \brief Init stream buffer in caller's memory
+ *
+ * Stream, its buffer substructure and first size bytes of data live in
+ * memory of caller (on stack or inside of other structure), so buffer
+ * is built without allocations, until data doesn't fit into storage.
+ * Then it's moved to heap. tnt_stream_free() has to be called anyway.
+ *
+ * \param s       stream
+ * \param sb      buffer substructure
+ * \param storage initial data buffer
+ * \param size    size of storage
+ *
+ * \returns s
+ * \retval  NULL s is NULL
+ */
+struct tnt_stream *
+tnt_buf_inline(struct tnt_stream *s, struct tnt_stream_buf *sb,
+	       char *storage, size_t size);
+
+/**
+ * \brief Reserve space for writing into stream buffer
+ *
+ * Next writes of size bytes in total don't reallocate the buffer.
+ *
+ * \param s    stream buffer
+ * \param size bytes to reserve after data
+ *
+ * \retval 0  ok
+ * \retval -1 memory allocation failure or immutable buffer (tnt_buf_as())
+ */
+int
+tnt_buf_reserve(struct tnt_stream *s, size_t size);
+
+/**
+ * \brief Release unused space of stream buffer
+ *
+ * Buffer grows geometrically, so up to a half of it may be unused.
+ * Buffer without data is freed.
+ *
+ * \param s stream buffer
+ *
+ * \retval 0  ok
+ * \retval -1 memory allocation failure (buffer is left as is)
+ */
+int
+tnt_buf_shrink(struct tnt_stream *s);
+
 #endif /* TNT_BUF_H_INCLUDED */
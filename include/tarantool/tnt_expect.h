@@ -0,0 +1,146 @@
+#ifndef TNT_EXPECT_H_INCLUDED
+#define TNT_EXPECT_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file tnt_expect.h
+ * \brief Dispatching of replies by sync to callbacks and futures
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include <tarantool/tnt_reply.h>
+
+struct tnt_stream;
+
+/**
+ * \brief Reply callback
+ *
+ * \param s     stream, reply is read from
+ * \param r     reply (it's freed after callback returns)
+ * \param arg   argument, passed to tnt_expect()
+ */
+typedef void (*tnt_expect_t)(struct tnt_stream *s, struct tnt_reply *r,
+			     void *arg);
+
+/**
+ * \brief Future handle, that receives reply of a request
+ */
+struct tnt_future {
+	struct tnt_reply reply; /*!< reply, valid if ready */
+	int ready; /*!< 1 if reply is received */
+};
+
+/**
+ * \brief Register callback for reply with given sync
+ *
+ * Callback is called by tnt_poll_replies() once final reply is received,
+ * IPROTO pushes (TNT_CHUNK) are passed to the same callback before it.
+ * Registrations are dropped by tnt_close().
+ *
+ * \param s    network stream
+ * \param sync sync of request (returned by tnt_request_compile())
+ * \param cb   callback
+ * \param arg  callback argument
+ *
+ * \retval 0  ok
+ * \retval -1 oom
+ */
+int
+tnt_expect(struct tnt_stream *s, uint64_t sync, tnt_expect_t cb, void *arg);
+
+/**
+ * \brief Initialize future handle
+ */
+void
+tnt_future_init(struct tnt_future *f);
+
+/**
+ * \brief Register future for reply with given sync
+ *
+ * \retval 0  ok
+ * \retval -1 oom
+ */
+int
+tnt_expect_future(struct tnt_stream *s, uint64_t sync, struct tnt_future *f);
+
+/**
+ * \brief Read replies until future is ready
+ *
+ * Replies of other requests are dispatched meanwhile.
+ *
+ * \retval 0  ok, reply is in f->reply
+ * \retval -1 network error (TNT_EAGAIN in non-blocking mode)
+ */
+int
+tnt_future_wait(struct tnt_stream *s, struct tnt_future *f);
+
+/**
+ * \brief Free reply of future
+ */
+void
+tnt_future_free(struct tnt_future *f);
+
+/**
+ * \brief Dispatch every received reply to its callback or future
+ *
+ * All replies, that are completely received, are dispatched. If there are
+ * none, then socket is read once: in blocking mode it waits for the next
+ * reply, in non-blocking mode it doesn't wait. Replies, that nobody
+ * waits for, are dropped.
+ *
+ * \param s network stream
+ *
+ * \returns count of dispatched replies
+ * \retval  -1 network error
+ *
+ * \code{.c}
+ * for (int i = 0; i < n; ++i) {
+ *     int64_t sync = tnt_request_compile(s, req[i]);
+ *     tnt_expect(s, sync, on_reply, &ctx[i]);
+ * }
+ * tnt_flush(s);
+ * while (pending > 0 && tnt_poll_replies(s) != -1)
+ *     ;
+ * \endcode
+ */
+int
+tnt_poll_replies(struct tnt_stream *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TNT_EXPECT_H_INCLUDED */
@@ -0,0 +1,133 @@
+#ifndef TNT_FORMAT_H_INCLUDED
+#define TNT_FORMAT_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file tnt_format.h
+ * \brief Compiled format strings for msgpack objects
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct tnt_stream;
+
+/**
+ * \brief format string, compiled into program of opcodes
+ *
+ * Format is parsed once, sizes of arrays and maps are counted at compile
+ * time, so the object is encoded with exact container headers in a single
+ * pass into preallocated space of the buffer.
+ */
+struct tnt_format;
+
+/**
+ * \brief argument of compiled format
+ *
+ * Arguments go in order of format specifiers. Integers of any width are
+ * passed in i (signed) or u (unsigned), %f and %lf in d, %b in b. Both
+ * %s and %.*s take str with len set.
+ */
+union tnt_format_arg {
+	int64_t  i;
+	uint64_t u;
+	double   d;
+	int      b;
+	struct {
+		const char *data;
+		uint32_t    len;
+	} str;
+};
+
+/**
+ * \brief Compile format string
+ *
+ * \param fmt format string, as for tnt_object_format()
+ *
+ * \returns compiled format
+ * \retval  NULL oom, unknown specifier or unbalanced brackets
+ * \sa tnt_object_format
+ */
+struct tnt_format *
+tnt_format_compile(const char *fmt);
+
+/**
+ * \brief Free compiled format
+ */
+void
+tnt_format_free(struct tnt_format *f);
+
+/**
+ * \brief count of arguments, that format takes
+ */
+uint32_t
+tnt_format_argc(const struct tnt_format *f);
+
+/**
+ * \brief Append values to tnt_object (or tnt_buf) by compiled format
+ *
+ * Unlike tnt_object_format() values may be appended to an object with
+ * data or with open containers (of any packing type), they are counted
+ * as items of the innermost one.
+ *
+ * \param s tnt_object instance
+ * \param f compiled format
+ * \param ... arguments for format string
+ *
+ * \returns count of written bytes
+ * \retval  -1 oom or immutable buffer
+ */
+ssize_t
+tnt_format_encode(struct tnt_stream *s, const struct tnt_format *f, ...);
+
+/**
+ * \brief Append values by compiled format (va_list variation)
+ * \sa tnt_format_encode
+ */
+ssize_t
+tnt_format_vencode(struct tnt_stream *s, const struct tnt_format *f,
+		   va_list vl);
+
+/**
+ * \brief Append values by compiled format from array of arguments
+ *
+ * \param s    tnt_object instance
+ * \param f    compiled format
+ * \param args tnt_format_argc(f) arguments
+ *
+ * \sa tnt_format_encode
+ */
+ssize_t
+tnt_format_encode_args(struct tnt_stream *s, const struct tnt_format *f,
+		       const union tnt_format_arg *args);
+
+#endif /* TNT_FORMAT_H_INCLUDED */
@@ -41,8 +41,16 @@
 
 enum tnt_error
 tnt_io_connect(struct tnt_stream_net *s);
+enum tnt_error
+tnt_io_connect_finish(struct tnt_stream_net *s);
+enum tnt_error
+tnt_io_nonblock(struct tnt_stream_net *s, int set);
 void
 tnt_io_close(struct tnt_stream_net *s);
+void
+tnt_io_sendq_drop(struct tnt_stream_net *s);
+int
+tnt_io_zerocopy_reap(struct tnt_stream_net *s);
 
 ssize_t
 tnt_io_flush(struct tnt_stream_net *s);
@@ -59,9 +67,13 @@ tnt_io_recv_raw(struct tnt_stream_net *s, char *buf, size_t size, int all);
 ssize_t
 tnt_io_send(struct tnt_stream_net *s, const char *buf, size_t size);
 ssize_t
+tnt_io_send_copy(struct tnt_stream_net *s, const char *buf, size_t size);
+ssize_t
 tnt_io_sendv(struct tnt_stream_net *s, struct iovec *iov, int count);
 ssize_t
 tnt_io_recv(struct tnt_stream_net *s, char *buf, size_t size);
+ssize_t
+tnt_io_recv_fill(struct tnt_stream_net *s, size_t size);
 
 int getiovmax();
 #endif /* TNT_IO_H_INCLUDED */
@@ -36,6 +36,23 @@
  * \brief Basic network layer static sized buffer
  */
 
+#include <stddef.h>
+
+/**
+ * \brief Reference counted memory of buffer
+ *
+ * Buffer holds one reference, every reply, that points into buffer
+ * (TNT_OPT_REPLY_ZEROCOPY), holds another one. Memory is freed when the
+ * last reference is dropped.
+ */
+struct tnt_iob_chunk {
+	long refs;
+	char data[];
+};
+
+#define TNT_IOB_CHUNK(BUF) \
+	((struct tnt_iob_chunk *)((BUF) - offsetof(struct tnt_iob_chunk, data)))
+
 typedef ssize_t (*tnt_iob_tx_t)(void *ptr, const char *buf, size_t size);
 typedef ssize_t (*tnt_iob_txv_t)(void *ptr, struct iovec *iov, int count);
 
@@ -53,10 +70,76 @@ int
 tnt_iob_init(struct tnt_iob *iob, size_t size, tnt_iob_tx_t tx,
 	     tnt_iob_txv_t txv, void *ptr);
 
+/**
+ * \brief Drop buffered data
+ *
+ * Pinned memory is left to its references. If new memory can't be
+ * allocated, buffer is dropped (buf is NULL) until tnt_iob_restore().
+ */
 void
 tnt_iob_clear(struct tnt_iob *iob);
 
+/**
+ * \brief Allocate memory of buffer, that was dropped by tnt_iob_clear()
+ *
+ * \retval 0  ok
+ * \retval -1 oom
+ */
+int
+tnt_iob_restore(struct tnt_iob *iob);
+
 void
 tnt_iob_free(struct tnt_iob *iob);
 
+/**
+ * \brief Take reference to buffer memory
+ */
+struct tnt_iob_chunk *
+tnt_iob_pin(struct tnt_iob *iob);
+
+/**
+ * \brief Release reference, taken by tnt_iob_pin()
+ */
+void
+tnt_iob_unpin(struct tnt_iob_chunk *chunk);
+
+/**
+ * \brief Check, that buffer memory is referenced by somebody else
+ */
+int
+tnt_iob_pinned(struct tnt_iob *iob);
+
+/**
+ * \brief Change buffer size, unread data [off, top) is kept
+ *
+ * Pinned memory isn't reallocated, it's left to its references.
+ *
+ * \retval 0  ok
+ * \retval -1 oom
+ */
+int
+tnt_iob_resize(struct tnt_iob *iob, size_t size);
+
+/**
+ * \brief Make room for size bytes of contiguous data, starting from off
+ *
+ * Buffer is compacted, if possible, or grown geometrically up to max.
+ *
+ * \retval 0  ok
+ * \retval -1 size is bigger, than max, or oom
+ */
+int
+tnt_iob_reserve(struct tnt_iob *iob, size_t size, size_t max);
+
+/**
+ * \brief Move unread data [off, top) into new memory, if buffer is pinned
+ *
+ * Pinned memory can't be reused, so it's left to its references.
+ *
+ * \retval 0  ok
+ * \retval -1 oom
+ */
+int
+tnt_iob_unshare(struct tnt_iob *iob);
+
 #endif /* TNT_IOB_H_INCLUDED */
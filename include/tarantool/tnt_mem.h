@@ -36,6 +36,9 @@
  * \brief Basic memory functions
  */
 
+#include <stddef.h>
+#include <stdint.h>
+
 #define tntfunction_unused __attribute__((unused))
 
 #if !defined __GNUC_MINOR__ || defined __INTEL_COMPILER || \
@@ -71,6 +74,13 @@ typedef void *(tnt_allocator_t)(void *ptr, size_t size);
 
 /**
  * \brief initialize memory allocation function
+ *
+ * Freelists of the calling thread are released to the previous allocator.
+ * The allocator isn't changed, while other threads have freelists enabled
+ * (\sa tnt_mem_pool).
+ *
+ * \returns previous allocation function
+ * \retval  NULL freelists of another thread are enabled
  */
 void *
 tnt_mem_init(tnt_allocator_t alloc);
@@ -99,4 +109,122 @@ tnt_mem_dup(char *sz);
 void
 tnt_mem_free(void *ptr);
 
+/**
+ * \brief Allocator context
+ *
+ * Allocator, that can be attached to a stream (see tnt_stream_mem()).
+ * Implementation embeds the structure and gets it back in callback.
+ */
+struct tnt_mem_ctx {
+	/*!< allocation function with tnt_allocator_t semantics */
+	void *(*realloc)(struct tnt_mem_ctx *ctx, void *ptr, size_t size);
+};
+
+/**
+ * \brief Internal function
+ *
+ * Allocate with context, global allocator is used for NULL context.
+ */
+void *
+tnt_mem_ctx_alloc(struct tnt_mem_ctx *ctx, size_t size);
+
+/**
+ * \brief Internal function
+ */
+void *
+tnt_mem_ctx_realloc(struct tnt_mem_ctx *ctx, void *ptr, size_t size);
+
+/**
+ * \brief Internal function
+ */
+void
+tnt_mem_ctx_free(struct tnt_mem_ctx *ctx, void *ptr);
+
+/**
+ * \brief Memory statistics of the thread
+ */
+struct tnt_mem_stat {
+	uint64_t alloc;       /*!< blocks allocated by allocator */
+	uint64_t realloc;     /*!< blocks reallocated */
+	uint64_t free;        /*!< blocks freed */
+	uint64_t pool_hit;    /*!< allocations served from freelists */
+	uint64_t pool_miss;   /*!< allocations missed freelists */
+	size_t   pool_cached; /*!< bytes kept in freelists */
+};
+
+/**
+ * \brief Enable freelists of the calling thread
+ *
+ * Streams, buffers, objects, requests, replies and iterators freed by the
+ * thread are kept for reuse instead of returning them to the allocator,
+ * up to high_water bytes. Passing 0 disables freelists and releases
+ * cached memory, it must be done before the thread exits and before
+ * the allocator is changed by tnt_mem_init().
+ *
+ * \param high_water maximal count of cached bytes
+ */
+void
+tnt_mem_pool(size_t high_water);
+
+/**
+ * \brief Release cached blocks of the calling thread
+ *
+ * \param keep count of bytes to keep cached
+ */
+void
+tnt_mem_pool_trim(size_t keep);
+
+/**
+ * \brief Get memory statistics of the calling thread
+ */
+void
+tnt_mem_stat(struct tnt_mem_stat *stat);
+
+/**
+ * \brief Reset counters of the calling thread (cached size is kept)
+ */
+void
+tnt_mem_stat_reset(void);
+
+/**
+ * \brief Internal function
+ *
+ * Block of tnt_mem_pool_size(size) bytes, possibly from freelist.
+ */
+void *
+tnt_mem_pool_alloc(size_t size);
+
+/**
+ * \brief Internal function
+ *
+ * Free block of at least tnt_mem_pool_size(size) bytes (allocated with
+ * tnt_mem_pool_alloc(size)) into freelist.
+ */
+void
+tnt_mem_pool_free(void *ptr, size_t size);
+
+/**
+ * \brief Internal function
+ */
+size_t
+tnt_mem_pool_size(size_t size);
+
+/**
+ * \brief Internal function
+ *
+ * Block for data of variable size. It's rounded up to size class only,
+ * if freelists are enabled, allocated size is returned in alloc.
+ */
+void *
+tnt_mem_pool_alloc_data(size_t size, size_t *alloc);
+
+/**
+ * \brief Internal function
+ *
+ * Free block of alloc bytes, it goes to freelist only if alloc is size
+ * of class.
+ */
+void
+tnt_mem_pool_free_data(void *ptr, size_t alloc);
+
 #endif /* TNT_MEM_H_INCLUDED */
@@ -0,0 +1,126 @@
+#ifndef TNT_MUX_H_INCLUDED
+#define TNT_MUX_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file tnt_mux.h
+ * \brief Connection, shared by many threads
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <tarantool/tnt_net.h>
+
+struct tnt_mux;
+struct tnt_stream;
+struct tnt_request;
+struct tnt_reply;
+
+/**
+ * \brief Create multiplexed connection on top of network stream
+ *
+ * Stream is connected in non-blocking mode (if it isn't connected yet)
+ * and is served by I/O thread from then on. Any thread may submit requests
+ * by tnt_mux_call(): they are queued into lock-free queue, written and
+ * pipelined by I/O thread, and replies are dispatched to waiting threads
+ * by sync.
+ *
+ * Stream must not be used directly, until tnt_mux_free() is called, except
+ * for schema lookups (tnt_get_spaceno()/tnt_get_indexno()). It stays owned
+ * by caller.
+ *
+ * \param s network stream with options set (connected streams must be
+ *          in non-blocking mode, io_uring streams aren't supported)
+ *
+ * \returns mux pointer
+ * \retval  NULL connection failed (error is stored in stream) or OOM
+ *
+ * \code{.c}
+ * struct tnt_stream *tnt = tnt_net(NULL);
+ * tnt_set(tnt, TNT_OPT_URI, uri);
+ * struct tnt_mux *mux = tnt_mux_new(tnt);
+ * ...
+ * // in any thread
+ * struct tnt_reply reply;
+ * tnt_reply_init(&reply);
+ * if (tnt_mux_call(mux, req, &reply) == 0)
+ *     ...
+ * tnt_reply_free(&reply);
+ * ...
+ * tnt_mux_free(mux);
+ * tnt_stream_free(tnt);
+ * \endcode
+ */
+struct tnt_mux *
+tnt_mux_new(struct tnt_stream *s);
+
+/**
+ * \brief Stop I/O thread and free mux
+ *
+ * There must be no tnt_mux_call() in progress.
+ */
+void
+tnt_mux_free(struct tnt_mux *m);
+
+/**
+ * \brief Send request and wait for its reply
+ *
+ * Thread-safe. Sync of request is assigned by mux.
+ *
+ * \param m     mux pointer
+ * \param req   request to send
+ * \param reply reply to fill (initialized by tnt_reply_init())
+ *
+ * \retval 0  ok
+ * \retval -1 connection is broken (see tnt_mux_error()), request is too
+ *            big for send buffer or OOM
+ */
+int
+tnt_mux_call(struct tnt_mux *m, struct tnt_request *req,
+	     struct tnt_reply *reply);
+
+/**
+ * \brief Get connection error
+ *
+ * Broken connection isn't restored, all requests fail then.
+ *
+ * \retval TNT_EOK connection is alive
+ */
+enum tnt_error
+tnt_mux_error(struct tnt_mux *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TNT_MUX_H_INCLUDED */
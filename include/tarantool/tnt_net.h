@@ -62,9 +62,34 @@ enum tnt_error {
 	TNT_ETMOUT, /*!< Operation timeout */
 	TNT_EBADVAL, /*!< Bad argument (value) */
 	TNT_ELOGIN, /*!< Failed to login */
+	TNT_EAGAIN, /*!< Operation would block (non-blocking mode) */
+	TNT_EWINDOW, /*!< Too many requests in flight
+		      * \sa TNT_OPT_WINDOW */
 	TNT_LAST /*!< Not an error */
 };
 
+/**
+ * \brief Connection state
+ *
+ * In blocking mode connection goes from TNT_STATE_CLOSED to
+ * TNT_STATE_READY inside of single tnt_connect() call. In non-blocking
+ * mode every step may end with TNT_EAGAIN and is resumed by next
+ * tnt_connect() call, after socket becomes ready for tnt_events().
+ */
+enum tnt_state {
+	TNT_STATE_CLOSED, /*!< Not connected */
+	TNT_STATE_CONNECTING, /*!< connect(2) is in progress */
+	TNT_STATE_GREETING, /*!< Waiting for greeting */
+	TNT_STATE_AUTH, /*!< Waiting for authentication reply */
+	TNT_STATE_SCHEMA, /*!< Waiting for space/index schema */
+	TNT_STATE_READY /*!< Connection is established */
+};
+
+struct tnt_reply;
+struct mh_sync_t;
+struct tnt_wheel;
+struct tnt_timer;
+
 /**
  * \brief Network stream structure
  */
@@ -79,6 +104,89 @@ struct tnt_stream_net {
 	char *greeting; /*!< Pointer to greeting, if connected */
 	struct tnt_schema *schema; /*!< Collation for space/index string<->number */
 	int inited; /*!< 1 if iob/schema were allocated */
+	enum tnt_state state; /*!< Connection state */
+	struct tnt_addr *addrs; /*!< Resolved addresses, non-blocking connect
+				 * moves to the next one on failure */
+	int addrs_count; /*!< Count of addrs */
+	int addrs_next; /*!< Address to connect to after current one */
+	int schema_loaded; /*!< Bitmap of loaded schema parts (1 - spaces,
+			    * 2 - indexes), while in TNT_STATE_SCHEMA */
+	struct tnt_reply *schema_reply; /*!< Index reply, received before
+					 * spaces reply */
+	int uring_ops; /*!< Bitmap of io_uring operations in flight */
+	int uring_buf; /*!< Index of registered sbuf in io_uring (rbuf is
+			* the next one), -1 if not registered */
+	int uring_errno; /*!< errno of failed io_uring operation */
+	struct iovec *sendq; /*!< Borrowed payloads, that are sent after
+			      * sbuf bytes [0, sendq_off[i]) (in order)
+			      * \sa TNT_OPT_SEND_BORROW */
+	size_t *sendq_off; /*!< sbuf offset of every borrowed payload */
+	struct iovec *sendq_vec; /*!< iovec of flushed data */
+	int sendq_count; /*!< Count of borrowed payloads */
+	int sendq_size; /*!< Allocated size of sendq arrays */
+	size_t sendq_head_sent; /*!< Bytes of sendq[0], that are already sent */
+	int zerocopy; /*!< SO_ZEROCOPY is enabled on socket
+		       * \sa TNT_OPT_SEND_ZEROCOPY */
+	struct iovec *zc_iov; /*!< Payloads, that are sent, but may be still
+			       * referenced by kernel (in order) */
+	uint32_t *zc_need; /*!< Value of zc_done, that releases zc_iov[i] */
+	int zc_count; /*!< Count of zc_iov */
+	int zc_size; /*!< Allocated size of zc arrays */
+	uint32_t zc_next; /*!< Zerocopy sends made on socket */
+	uint32_t zc_done; /*!< Zerocopy sends, kernel has completed */
+	uint64_t zc_bytes; /*!< Bytes sent with MSG_ZEROCOPY */
+	int zc_copied; /*!< Completions, that report kernel has copied data
+			* anyway (e.g. on loopback) */
+	int low_latency; /*!< TCP options of low latency profile are applied
+			  * \sa TNT_OPT_LOW_LATENCY */
+	int busy_poll; /*!< SO_BUSY_POLL time applied on last connect (0 -
+			* not permitted) */
+	struct mh_sync_t *expect; /*!< Reply callbacks by sync
+				   * \sa tnt_expect */
+	struct mh_sync_t *retain; /*!< Requests in flight by sync, that are
+				   * resent after reconnect (NULL data -
+				   * request isn't idempotent)
+				   * \sa TNT_OPT_RECONNECT */
+	uint64_t *lost; /*!< Syncs of requests, that were lost on reconnect */
+	int lost_count; /*!< Count of lost requests, replies aren't read yet */
+	int lost_size; /*!< Allocated size of lost */
+	int idempotent; /*!< Next written request is idempotent */
+	int recovering; /*!< Reconnect is in progress */
+	int reconnects; /*!< Reconnect attempts since last received reply */
+	int sockbuf_send; /*!< SO_SNDBUF size applied on last connect, as
+			   * reported by kernel */
+	int sockbuf_recv; /*!< SO_RCVBUF size applied on last connect, as
+			   * reported by kernel */
+	int sockbuf_calls; /*!< setsockopt() calls made to size socket
+			    * buffers on last connect */
+	int flush_pending; /*!< Requests written since last flush
+			    * \sa TNT_OPT_FLUSH_COUNT */
+	int64_t flush_deadline; /*!< Monotonic time (usec), when buffered
+				 * requests have to be flushed
+				 * \sa TNT_OPT_FLUSH_DELAY */
+	int window; /*!< Current size of adaptive window
+		     * \sa TNT_OPT_WINDOW_ADAPTIVE */
+	int window_cut; /*!< Window was decreased since connect, it grows
+			 * additively then */
+	int rtt_timing; /*!< Request rtt_sync is being timed */
+	uint64_t rtt_sync; /*!< Sync of timed request */
+	int64_t rtt_start; /*!< Monotonic time (usec), timed request was
+			    * written at */
+	int64_t rtt; /*!< Last measured round trip time (usec) */
+	int64_t rtt_min; /*!< Minimal measured round trip time (usec) */
+	int window_ahead; /*!< Replies, read ahead into rbuf by full window */
+	size_t window_ahead_size; /*!< Size of replies read ahead, starting
+				   * from rbuf.off */
+	struct tnt_wheel *wheel; /*!< Deadlines of requests in flight
+				  * \sa tnt_deadline */
+	struct mh_sync_t *deadlines; /*!< Timers of requests by sync (NULL
+				      * data - request is expired, its late
+				      * reply is skipped) */
+	struct tnt_timer *timedout; /*!< Expired requests, that aren't
+				     * answered by read_reply yet */
+	int timedout_count; /*!< Count of timedout */
+	int expired; /*!< Expired requests, that server didn't answer yet */
+	int64_t deadline_next; /*!< Timeout of next written request (usec) */
 };
 
 /*!
@@ -156,6 +264,11 @@ tnt_init(struct tnt_stream *s);
 /**
  * \brief Connect to tarantool with preconfigured and allocated settings
  *
+ * In non-blocking mode (TNT_OPT_NONBLOCK) function returns -1 with
+ * TNT_EAGAIN error until connection is established. Wait for
+ * tnt_events() on tnt_fd() and call tnt_connect() again to resume
+ * connection, greeting, authentication and schema loading.
+ *
  * \param s stream pointer
  *
  * \retval 0  ok
@@ -182,12 +295,126 @@ tnt_close(struct tnt_stream *s);
 ssize_t
 tnt_flush(struct tnt_stream *s);
 
+/**
+ * \brief Set deadline of next request
+ *
+ * If reply doesn't come within timeout after the request is written,
+ * read_reply returns TNT_ER_TIMEOUT error for its sync, and the late
+ * reply is skipped. Overrides TNT_OPT_REQUEST_TIMEOUT.
+ *
+ * \code{.c}
+ * struct timeval tm = { 0, 50000 };
+ * tnt_deadline(s, &tm);
+ * tnt_call(s, "fn", 2, args);
+ * \endcode
+ *
+ * \param s       stream pointer
+ * \param timeout time to wait for reply
+ */
+void
+tnt_deadline(struct tnt_stream *s, const struct timeval *timeout);
+
+/**
+ * \brief Get time left until the nearest request deadline
+ *
+ * In non-blocking mode use the result as a poll timeout and call
+ * read_reply, when it's 0, to get expired requests.
+ *
+ * \param s stream pointer
+ *
+ * \returns milliseconds left
+ * \retval  0 there are expired requests
+ * \retval -1 no request has a deadline
+ */
+int
+tnt_deadline_timeout(struct tnt_stream *s);
+
+/**
+ * \brief Get time left until buffered requests have to be flushed
+ *
+ * With TNT_OPT_FLUSH_DELAY set, tnt_events() doesn't ask for POLLOUT
+ * until buffered requests reach one of auto-flush thresholds or wait
+ * for the delay. Use the result as a poll timeout and call tnt_flush()
+ * when it's 0.
+ *
+ * \param s stream pointer
+ *
+ * \returns milliseconds left until flush
+ * \retval  0 flush is due
+ * \retval -1 nothing to flush by timer
+ *
+ * \code{.c}
+ * struct pollfd pfd = { tnt_fd(s), tnt_events(s), 0 };
+ * poll(&pfd, 1, tnt_flush_timeout(s));
+ * if (tnt_flush_timeout(s) == 0 || (pfd.revents & POLLOUT))
+ *	tnt_flush(s);
+ * \endcode
+ */
+int
+tnt_flush_timeout(struct tnt_stream *s);
+
+/**
+ * \brief Get count of payloads, that kernel still references
+ *
+ * Reads completions of MSG_ZEROCOPY sends from socket error queue and
+ * releases completed payloads (calls TNT_OPT_SEND_ZEROCOPY_CB). In
+ * non-blocking mode payloads, sent with MSG_ZEROCOPY, must stay valid
+ * until it returns 0, call it, when poll reports POLLERR on tnt_fd().
+ *
+ * \param s stream pointer
+ *
+ * \returns count of payloads in flight
+ * \retval  -1 error
+ */
+int
+tnt_zerocopy_pending(struct tnt_stream *s);
+
 /**
  * \brief Get tnt_net stream fd
  */
 int
 tnt_fd(struct tnt_stream *s);
 
+/**
+ * \brief Get events to wait for on tnt_fd() before next operation
+ *
+ * \param s stream pointer
+ *
+ * \returns mask of POLLIN/POLLOUT (same values as EPOLLIN/EPOLLOUT)
+ * \retval  0 nothing to wait for
+ *
+ * \code{.c}
+ * while (tnt_connect(s) == -1 && tnt_error(s) == TNT_EAGAIN) {
+ *	struct pollfd pfd = { tnt_fd(s), tnt_events(s), 0 };
+ *	poll(&pfd, 1, -1);
+ * }
+ * \endcode
+ */
+int
+tnt_events(struct tnt_stream *s);
+
+/**
+ * \brief Mark next request as idempotent
+ *
+ * With TNT_OPT_RECONNECT set, idempotent requests in flight are resent
+ * after connection loss, and other ones are answered with
+ * TNT_ER_NO_CONNECTION error. Selects and pings are always idempotent,
+ * the function marks others (e.g. call of read-only function).
+ *
+ * \code{.c}
+ * tnt_idempotent(s);
+ * tnt_call(s, "get_config", 10, args);
+ * \endcode
+ */
+void
+tnt_idempotent(struct tnt_stream *s);
+
+/**
+ * \brief Get connection state
+ */
+enum tnt_state
+tnt_state(struct tnt_stream *s);
+
 /**
  * \brief Error accessor for tnt_net stream
  */
@@ -209,6 +436,11 @@ tnt_errno(struct tnt_stream *s);
 /**
  * \brief Flush space/index schema and get it from server
  *
+ * In non-blocking mode requests are sent and connection moves to
+ * TNT_STATE_SCHEMA, replies are processed by following tnt_connect() calls.
+ * Fails for a stream, that borrows schema of another one (\sa TNT_OPT_SCHEMA),
+ * the owner must be reloaded instead.
+ *
  * \param s stream pointer
  *
  * \returns result
@@ -37,6 +37,9 @@
 
 #include <stdarg.h>
 
+#include <tarantool/tnt_stream.h>
+#include <tarantool/tnt_buf.h>
+
 /**
  * \brief for internal use
  */
@@ -44,6 +47,7 @@ struct tnt_sbo_stack {
 	size_t   offset;
 	uint32_t size;
 	int8_t   type;
+	uint32_t pending; /* pending headers before container */
 };
 
 /**
@@ -52,8 +56,8 @@ struct tnt_sbo_stack {
  * - TNT_SBO_SIMPLE - without packing, demanding size to be specified
  * - TNT_SBO_SPARSE - 5 bytes always allocated for map/array, size is ignored
  * - TNT_SBO_PACKED - 1 byte is alloced for map/array, if needed more, then
- *                    everything is moved to n bytes, when called
- *                    "tnt_object_container_close"
+ *                    headers are expanded by single pass, when outermost
+ *                    container is closed with "tnt_object_container_close"
  */
 enum tnt_sbo_type {
 	TNT_SBO_SIMPLE = 0,
@@ -61,16 +65,48 @@ enum tnt_sbo_type {
 	TNT_SBO_PACKED,
 };
 
+/**
+ * \brief for internal use
+ */
+struct tnt_sbo_pending {
+	size_t   offset;
+	uint32_t size;
+	int8_t   type;
+};
+
 struct tnt_sbuf_object {
 	struct tnt_sbo_stack *stack;
 	uint8_t stack_size;
 	uint8_t stack_alloc;
 	enum tnt_sbo_type type;
+	struct tnt_sbo_pending *pending; /* closed, but not expanded headers */
+	uint32_t pending_size;
+	uint32_t pending_alloc;
+	struct tnt_sbo_stack *stack_storage; /* stack of inline object */
 };
 
 #define TNT_OBJ_CAST(SB) ((struct tnt_sbuf_object *)(SB)->subdata)
 #define TNT_SOBJ_CAST(S) TNT_OBJ_CAST(TNT_SBUF_CAST(S))
 
+/**
+ * \brief data and containers depth of inline object, that need no memory
+ * allocations
+ */
+#define TNT_OBJECT_INLINE_SIZE  64
+#define TNT_OBJECT_INLINE_DEPTH 4
+
+/**
+ * \brief storage for tnt_object, provided by caller
+ * \sa tnt_object_inline
+ */
+struct tnt_object_inline {
+	struct tnt_stream      stream;
+	struct tnt_stream_buf  buf;
+	struct tnt_sbuf_object obj;
+	struct tnt_sbo_stack   stack[TNT_OBJECT_INLINE_DEPTH];
+	char                   data[TNT_OBJECT_INLINE_SIZE];
+};
+
 /**
  * \brief Set type of packing for objects
  *
@@ -176,6 +212,28 @@ tnt_object_add_map(struct tnt_stream *s, uint32_t size);
 ssize_t
 tnt_object_container_close(struct tnt_stream *s);
 
+/**
+ * \brief Init tnt_object in caller's storage
+ *
+ * Object is built without memory allocations, while its data fits into
+ * TNT_OBJECT_INLINE_SIZE bytes and containers are nested not deeper than
+ * TNT_OBJECT_INLINE_DEPTH, then data (stack) is moved to heap.
+ *
+ * \code{.c}
+ * struct tnt_object_inline storage;
+ * struct tnt_stream *key = tnt_object_inline(&storage);
+ * tnt_object_format(key, "[%d]", 42);
+ * ...
+ * tnt_stream_free(key);
+ * \endcode
+ *
+ * \param o storage (on stack or inside of other structure)
+ *
+ * \returns object stream
+ */
+struct tnt_stream *
+tnt_object_inline(struct tnt_object_inline *o);
+
 /**
  * \brief create immutable tnt_object from given buffer
  */
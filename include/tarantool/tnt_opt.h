@@ -38,6 +38,8 @@
  */
 
 struct tnt_iob;
+struct tnt_uring;
+struct tnt_schema;
 
 /**
  * \brief Callback type for read (instead of reading from socket)
@@ -75,6 +77,41 @@ typedef ssize_t (*send_cb_t)(struct tnt_iob *b, void *buf, size_t len);
  */
 typedef ssize_t (*sendv_cb_t)(struct tnt_iob *b, const struct iovec *iov, int iov_count);
 
+/**
+ * \brief Callback, that releases payload, sent with MSG_ZEROCOPY
+ *
+ * \param buf  payload, as it was passed to request
+ * \param size payload size
+ * \param arg  TNT_OPT_SEND_ZEROCOPY_CB_ARG
+ */
+typedef void (*zerocopy_cb_t)(void *buf, size_t size, void *arg);
+
+/**
+ * \brief Policy of sizing kernel socket buffers (SO_SNDBUF/SO_RCVBUF)
+ * \sa TNT_OPT_SOCKBUF
+ */
+enum tnt_sockbuf {
+	TNT_SOCKBUF_PROBE = 0, /*!< Find maximum allowed size on every
+				* connect */
+	TNT_SOCKBUF_PROBE_ONCE, /*!< Find maximum allowed size once per
+				 * process and reuse it */
+	TNT_SOCKBUF_FIXED, /*!< Use TNT_OPT_SOCKBUF_SEND and
+			    * TNT_OPT_SOCKBUF_RECV sizes */
+	TNT_SOCKBUF_KERNEL /*!< Keep kernel defaults */
+};
+
+/**
+ * \brief Behaviour of request submission, when window of requests in
+ * flight is full
+ * \sa TNT_OPT_WINDOW
+ */
+enum tnt_window {
+	TNT_WINDOW_BLOCK = 0, /*!< Read replies ahead into receive buffer,
+			       * until server answers the oldest request */
+	TNT_WINDOW_FAIL, /*!< Fail with TNT_EWINDOW */
+	TNT_WINDOW_EAGAIN /*!< Fail with TNT_EAGAIN */
+};
+
 /**
  * \brief Options for connection
  */
@@ -95,7 +132,84 @@ enum tnt_opt_type {
 	TNT_OPT_RECV_CB_ARG, /*!< callback context for recv
 			      * \sa recv_cb_t
 			      */
-	TNT_OPT_RECV_BUF /*!< Option for setting recv buffer size */
+	TNT_OPT_RECV_BUF, /*!< Option for setting recv buffer size */
+	TNT_OPT_NONBLOCK, /*!< Option for enabling non-blocking mode
+			   * \sa tnt_events
+			   */
+	TNT_OPT_URING, /*!< io_uring instance for socket operations,
+			* enables non-blocking mode
+			* \sa tnt_uring_new
+			*/
+	TNT_OPT_REPLY_ZEROCOPY, /*!< Replies point into recv buffer, which
+				 * memory is kept until tnt_reply_free()
+				 */
+	TNT_OPT_RECV_BUF_MAX, /*!< Option for setting the size, that recv
+			       * buffer may grow up to, to keep big reply
+			       * contiguous
+			       */
+	TNT_OPT_SEND_BORROW, /*!< Payloads of this size and bigger are sent
+			      * from caller's memory instead of being copied
+			      * into send buffer (0 - always copy)
+			      */
+	TNT_OPT_SCHEMA, /*!< Schema of another stream to use instead of
+			 * own one, it isn't loaded on connect
+			 * \sa tnt_pool
+			 */
+	TNT_OPT_RECONNECT, /*!< Number of reconnect attempts after
+			    * connection loss, idempotent requests in
+			    * flight are resent (0 - disabled)
+			    * \sa tnt_idempotent
+			    */
+	TNT_OPT_RECONNECT_DELAY, /*!< Delay before the second reconnect
+				  * attempt, doubled for every next one
+				  */
+	TNT_OPT_CONNECT_STAGGER, /*!< Delay between concurrent connection
+				  * attempts to resolved addresses
+				  */
+	TNT_OPT_RESOLVE_TTL, /*!< Seconds, resolved addresses are cached
+			      * for (0 - no caching)
+			      */
+	TNT_OPT_SOCKBUF, /*!< Policy of sizing socket buffers
+			  * \sa tnt_sockbuf
+			  */
+	TNT_OPT_SOCKBUF_SEND, /*!< SO_SNDBUF size for TNT_SOCKBUF_FIXED */
+	TNT_OPT_SOCKBUF_RECV, /*!< SO_RCVBUF size for TNT_SOCKBUF_FIXED */
+	TNT_OPT_FLUSH_BYTES, /*!< Flush send buffer, when this many bytes are
+			      * buffered (0 - disabled) */
+	TNT_OPT_FLUSH_COUNT, /*!< Flush send buffer, when this many requests
+			      * are buffered (0 - disabled) */
+	TNT_OPT_FLUSH_DELAY, /*!< Flush send buffer, when the first buffered
+			      * request waits this long (0 - disabled)
+			      * \sa tnt_flush_timeout
+			      */
+	TNT_OPT_WINDOW, /*!< Maximum number of requests in flight
+			 * (0 - unlimited) */
+	TNT_OPT_WINDOW_MODE, /*!< What to do, when window is full
+			      * \sa tnt_window
+			      */
+	TNT_OPT_WINDOW_ADAPTIVE, /*!< Adapt window size to measured round
+				  * trip time, TNT_OPT_WINDOW is the limit */
+	TNT_OPT_REQUEST_TIMEOUT, /*!< Deadline of every request, relative to
+				  * its write (0 - no deadline)
+				  * \sa tnt_deadline
+				  */
+	TNT_OPT_SEND_ZEROCOPY, /*!< Payloads of this size and bigger are
+				* borrowed and sent with MSG_ZEROCOPY
+				* (0 - disabled)
+				* \sa tnt_zerocopy_pending
+				*/
+	TNT_OPT_SEND_ZEROCOPY_CB, /*!< Callback, that is called, when kernel
+				   * doesn't need payload anymore
+				   * \sa zerocopy_cb_t
+				   */
+	TNT_OPT_SEND_ZEROCOPY_CB_ARG, /*!< Argument of zerocopy callback */
+	TNT_OPT_LOW_LATENCY, /*!< Tune socket for latency: busy polling,
+			      * quick acks, corking of flushes, that take
+			      * several calls */
+	TNT_OPT_BUSY_POLL, /*!< SO_BUSY_POLL time (usec) of low latency
+			    * profile (0 - not set) */
+	TNT_OPT_RECV_SPIN /*!< Blocking read spins this long on socket,
+			   * before falling asleep (0 - disabled) */
 };
 
 /**
@@ -115,6 +229,32 @@ struct tnt_opt {
 	void *recv_cb;
 	void *recv_cb_arg;
 	int recv_buf;
+	int recv_buf_max;
+	int nonblock;
+	struct tnt_uring *uring;
+	int reply_zerocopy;
+	int send_borrow;
+	struct tnt_schema *schema;
+	int reconnect;
+	struct timeval reconnect_delay;
+	struct timeval connect_stagger;
+	int resolve_ttl;
+	enum tnt_sockbuf sockbuf;
+	int sockbuf_send;
+	int sockbuf_recv;
+	int flush_bytes;
+	int flush_count;
+	struct timeval flush_delay;
+	int window;
+	enum tnt_window window_mode;
+	int window_adaptive;
+	struct timeval request_timeout;
+	int send_zerocopy;
+	void *send_zerocopy_cb;
+	void *send_zerocopy_cb_arg;
+	int low_latency;
+	int busy_poll;
+	struct timeval recv_spin;
 };
 
 /**
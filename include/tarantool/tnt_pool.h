@@ -0,0 +1,165 @@
+#ifndef TNT_POOL_H_INCLUDED
+#define TNT_POOL_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file tnt_pool.h
+ * \brief Pool of connections with least-loaded balancing
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <tarantool/tnt_net.h>
+
+struct tnt_pool;
+struct tnt_stream;
+
+/**
+ * \brief Create empty connection pool
+ *
+ * \returns pool pointer
+ * \retval  NULL oom
+ *
+ * \code{.c}
+ * struct tnt_pool *pool = tnt_pool_new();
+ * tnt_pool_add(pool, "localhost:3301", 4);
+ * tnt_pool_add(pool, "localhost:3302", 4);
+ * if (tnt_pool_connect(pool) == -1)
+ *     ...
+ * struct tnt_stream *tnt = tnt_pool_get(pool);
+ * tnt_ping(tnt);
+ * tnt_flush(tnt);
+ * ...
+ * tnt_pool_free(pool);
+ * \endcode
+ */
+struct tnt_pool *
+tnt_pool_new(void);
+
+/**
+ * \brief Free pool and all its connections
+ */
+void
+tnt_pool_free(struct tnt_pool *p);
+
+/**
+ * \brief Add connections to pool
+ *
+ * Connections aren't established until tnt_pool_connect() is called.
+ *
+ * \param p     pool pointer
+ * \param uri   URI to connect to
+ * \param count number of connections to add
+ *
+ * \retval 0  ok
+ * \retval -1 failed to parse URI or oom
+ */
+int
+tnt_pool_add(struct tnt_pool *p, const char *uri, int count);
+
+/**
+ * \brief Set option for every connection added so far
+ *
+ * \sa tnt_set
+ *
+ * \retval 0  ok
+ * \retval -1 bad option or oom
+ */
+int
+tnt_pool_set(struct tnt_pool *p, int opt, ...);
+
+/**
+ * \brief Connect all connections of pool in parallel
+ *
+ * Connections are established in non-blocking mode, all of them are
+ * waited for together, so warm-up takes as long as the slowest one.
+ * Connections without TNT_OPT_NONBLOCK are switched to blocking mode
+ * afterwards. Space/index schema is loaded only by the first connection,
+ * that gets established (the schema owner), and shared by all other ones
+ * (\sa TNT_OPT_SCHEMA, tnt_pool_owner).
+ *
+ * Connections, that are already established, are skipped, so the function
+ * may be called again to restore broken ones.
+ *
+ * \returns number of established connections
+ * \retval  -1 no connection was established (error of every connection is
+ *          stored in its stream) or oom
+ */
+int
+tnt_pool_connect(struct tnt_pool *p);
+
+/**
+ * \brief Get established connection with fewest requests in flight
+ *
+ * Requests in flight are counted by wrcnt of stream (requests, that were
+ * written, but whose replies weren't read yet). Ties are resolved in
+ * round-robin order.
+ *
+ * \returns stream pointer, owned by pool
+ * \retval  NULL no established connection
+ */
+struct tnt_stream *
+tnt_pool_get(struct tnt_pool *p);
+
+/**
+ * \brief Get number of connections in pool
+ */
+int
+tnt_pool_count(struct tnt_pool *p);
+
+/**
+ * \brief Get connection, that owns space/index schema
+ *
+ * Other connections of pool borrow its schema, so tnt_reload_schema()
+ * fails for them and must be called for the owner.
+ *
+ * \returns stream pointer, owned by pool
+ * \retval  NULL no connection was established yet
+ */
+struct tnt_stream *
+tnt_pool_owner(struct tnt_pool *p);
+
+/**
+ * \brief Get connection by position in pool
+ *
+ * \returns stream pointer, owned by pool
+ * \retval  NULL bad position
+ */
+struct tnt_stream *
+tnt_pool_stream(struct tnt_pool *p, int i);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TNT_POOL_H_INCLUDED */
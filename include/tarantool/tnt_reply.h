@@ -52,6 +52,9 @@
  */
 typedef ssize_t (*tnt_reply_t)(void *ptr, char *dst, ssize_t size);
 
+struct tnt_iob_chunk;
+struct tnt_mem_ctx;
+
 /*!
  * \brief basic reply structure
  */
@@ -71,6 +74,13 @@ struct tnt_reply {
 	const char *metadata_end; /*!< end if tuple metadata (NULL if not present) */
 	const char *sqlinfo;	/*!< map sqlinfo (NULL if not present) */
 	const char *sqlinfo_end;/*!< end if map sqlinfo (NULL if not present) */
+	struct tnt_iob_chunk *pin; /*!< receive buffer memory, that reply points
+				    * into (TNT_OPT_REPLY_ZEROCOPY), released
+				    * by tnt_reply_free() */
+	struct tnt_mem_ctx *mem; /*!< allocator of buffer (NULL for allocator
+				  * of stream, reply is read from) */
+	struct tnt_mem_ctx *buf_mem; /*!< allocator of current buffer (internal) */
+	size_t buf_alloc; /*!< allocated size of buffer (internal) */
 };
 
 /*!
@@ -137,6 +147,24 @@ tnt_reply(struct tnt_reply *r, char *buf, size_t size, size_t *off);
 int
 tnt_reply_from(struct tnt_reply *r, tnt_reply_t rcv, void *ptr);
 
+/*!
+ * \brief Internal function
+ *
+ * tnt_reply() with allocator of stream, used unless reply has its own.
+ */
+int
+tnt_reply_mem(struct tnt_reply *r, char *buf, size_t size, size_t *off,
+	      struct tnt_mem_ctx *mem);
+
+/*!
+ * \brief Internal function
+ *
+ * tnt_reply_from() with allocator of stream, used unless reply has its own.
+ */
+int
+tnt_reply_from_mem(struct tnt_reply *r, tnt_reply_t rcv, void *ptr,
+		   struct tnt_mem_ctx *mem);
+
 /*!
  * \brief Process buffer as reply header without copying processed bytes
  *
@@ -35,8 +35,12 @@
  * \brief Request creation using connection schema
  */
 
+#include <sys/types.h>
+
 #include <tarantool/tnt_proto.h>
 
+struct tnt_format;
+
 struct tnt_request {
 	struct {
 		uint64_t sync; /*!< Request sync id. Generated when encoded */
@@ -72,6 +76,12 @@ struct tnt_request {
 					  */
 	int index_base; /*!< field offset for UPDATE */
 	int alloc; /*!< allocation mark */
+	char *tmpl; /*!< Pre-encoded request
+		     * \sa tnt_request_prepare */
+	size_t tmpl_size; /*!< Size of template */
+	size_t tmpl_hdr; /*!< Size of length and header, that are patched */
+	ssize_t tmpl_key; /*!< Offset of key in template (-1 - no key) */
+	ssize_t tmpl_tuple; /*!< Offset of tuple in template (-1 - no tuple) */
 };
 
 /**
@@ -188,6 +198,21 @@ tnt_request_set_key(struct tnt_request *req, struct tnt_stream *s);
 int
 tnt_request_set_key_format(struct tnt_request *req, const char *fmt, ...);
 
+/**
+ * \brief Set key from compiled format
+ *
+ * \param req request pointer
+ * \param fmt compiled format
+ * \param ... arguments for format string
+ *
+ * \retval 0  ok
+ * \retval -1 oom
+ * \sa tnt_format_compile
+ */
+int
+tnt_request_set_key_compiled(struct tnt_request *req,
+			     const struct tnt_format *fmt, ...);
+
 /**
  * \brief Set function from string
  *
@@ -261,6 +286,21 @@ tnt_request_set_tuple(struct tnt_request *req, struct tnt_stream *s);
 int
 tnt_request_set_tuple_format(struct tnt_request *req, const char *fmt, ...);
 
+/**
+ * \brief Set tuple from compiled format
+ *
+ * \param req request pointer
+ * \param fmt compiled format
+ * \param ... arguments for format string
+ *
+ * \retval 0  ok
+ * \retval -1 oom
+ * \sa tnt_format_compile
+ */
+int
+tnt_request_set_tuple_compiled(struct tnt_request *req,
+			       const struct tnt_format *fmt, ...);
+
 /**
  * \brief Set operations from predefined object
  *
@@ -297,6 +337,36 @@ tnt_request_compile(struct tnt_stream *s, struct tnt_request *req);
 int
 tnt_request_writeout(struct tnt_stream *s, struct tnt_request *req,
 		     uint64_t *sync);
+/**
+ * \brief Prepare request template
+ *
+ * Encodes request once, with all fields except key and tuple, then
+ * tnt_request_compile() only patches sync and length of the template and
+ * writes it together with current key and tuple. Function name of call
+ * and expression of eval are fixed by template too. Prepare request again
+ * after changing other fields, template is freed by tnt_request_free().
+ *
+ * \code{.c}
+ * struct tnt_request *req = tnt_request_select(NULL);
+ * tnt_request_set_space(req, 512);
+ * tnt_request_set_key(req, key);
+ * tnt_request_prepare(req);
+ * for (i = 0; i < count; ++i) {
+ *	tnt_object_reset(key);
+ *	tnt_object_format(key, "[%d]", i);
+ *	tnt_request_set_key(req, key);
+ *	tnt_request_compile(s, req);
+ * }
+ * \endcode
+ *
+ * \param req request object
+ *
+ * \retval 0  ok
+ * \retval -1 bad request type or oom
+ */
+int
+tnt_request_prepare(struct tnt_request *req);
+
 /**
  * \brief create select request object
  * \sa tnt_request_init
@@ -38,6 +38,7 @@
  */
 
 struct mh_assoc_t;
+struct tnt_mem_ctx;
 
 /**
  * \internal
@@ -66,6 +67,7 @@ struct tnt_schema_sval {
 struct tnt_schema {
 	struct mh_assoc_t *space_hash; /*!< hash with spaces */
 	int alloc; /*!< allocation mark */
+	struct tnt_mem_ctx *mem; /*!< allocator of entries (NULL for global) */
 };
 
 /**
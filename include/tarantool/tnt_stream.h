@@ -41,6 +41,8 @@
 #include <tarantool/tnt_reply.h>
 #include <tarantool/tnt_request.h>
 
+struct tnt_mem_ctx;
+
 /**
  * \brief Basic stream object
  * all function pointers are NULL, if operation is not supported
@@ -50,6 +52,7 @@ struct tnt_stream {
 	ssize_t (*write)(struct tnt_stream *s, const char *buf, size_t size); /*!< write to buffer function */
 	ssize_t (*writev)(struct tnt_stream *s, struct iovec *iov, int count); /*!< writev function */
 	ssize_t (*write_request)(struct tnt_stream *s, struct tnt_request *r, uint64_t *sync); /*!< write request function */
+	ssize_t (*write_batch)(struct tnt_stream *s, const char *buf, size_t size, int count); /*!< write count requests, encoded into buf one by one */
 
 	ssize_t (*read)(struct tnt_stream *s, char *buf, size_t size); /*!< read from buffer function */
 	int (*read_reply)(struct tnt_stream *s, struct tnt_reply *r); /*!< read reply from buffer */
@@ -59,6 +62,7 @@ struct tnt_stream {
 	void *data; /*!< subclass data */
 	uint32_t wrcnt; /*!< count of write operations */
 	uint64_t reqid; /*!< request id of current operation */
+	struct tnt_mem_ctx *mem; /*!< allocator of stream data (NULL for global) */
 };
 
 /**
@@ -76,4 +80,14 @@ void tnt_stream_free(struct tnt_stream *s);
  */
 uint32_t tnt_stream_reqid(struct tnt_stream *s, uint32_t reqid);
 
+/**
+ * \brief set allocator of stream data, returns previous one
+ *
+ * Buffer data and buffers of replies read from the stream are allocated
+ * with it (reply remembers allocator of its buffer). Buffer stream must
+ * have no data, when it's changed. NULL is global allocator.
+ */
+struct tnt_mem_ctx *
+tnt_stream_mem(struct tnt_stream *s, struct tnt_mem_ctx *mem);
+
 #endif /* TNT_STREAM_H_INCLUDED */
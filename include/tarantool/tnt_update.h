@@ -191,6 +191,80 @@ tnt_update_splice(struct tnt_stream *ops, uint32_t fieldno,
 		  uint32_t position, uint32_t offset,
 		  const char *buffer, size_t buffer_len);
 
+/**
+ * \brief Add operation with integer value for update to tnt_object
+ *
+ * Value is encoded right into the container, these functions don't
+ * allocate memory if the container has enough reserved space.
+ *
+ * \param ops     operation container
+ * \param fieldno field number
+ * \param op      operation ('=', '!', '+', '-', '&', '|', '^')
+ * \param value   value for update op
+ *
+ * \returns count of bytes written
+ * \retval  -1 oom or wrong op
+ * \sa tnt_update_cointainer
+ * \sa tnt_update_cointainer_close
+ */
+ssize_t
+tnt_update_value_int(struct tnt_stream *ops, uint32_t fieldno, char op,
+		     int64_t value);
+
+/**
+ * \brief Add operation with unsigned value for update to tnt_object
+ *
+ * \sa tnt_update_value_int
+ */
+ssize_t
+tnt_update_value_uint(struct tnt_stream *ops, uint32_t fieldno, char op,
+		      uint64_t value);
+
+/**
+ * \brief Add operation with double value for update to tnt_object
+ *
+ * \sa tnt_update_value_int
+ */
+ssize_t
+tnt_update_value_double(struct tnt_stream *ops, uint32_t fieldno, char op,
+			double value);
+
+/**
+ * \brief Add assign ('=') or insert ('!') of boolean for update
+ *
+ * \sa tnt_update_value_int
+ */
+ssize_t
+tnt_update_value_bool(struct tnt_stream *ops, uint32_t fieldno, char op,
+		      char value);
+
+/**
+ * \brief Add assign ('=') or insert ('!') of string for update
+ *
+ * \param str string to assign (insert)
+ * \param len string length
+ *
+ * \sa tnt_update_value_int
+ */
+ssize_t
+tnt_update_value_str(struct tnt_stream *ops, uint32_t fieldno, char op,
+		     const char *str, uint32_t len);
+
+/**
+ * \brief Add assign ('=') or insert ('!') of encoded msgpack value
+ *
+ * Unlike tnt_update_assign() and tnt_update_insert() value isn't
+ * checked, it must be a single valid msgpack value.
+ *
+ * \param value msgpack value
+ * \param len   value length
+ *
+ * \sa tnt_update_value_int
+ */
+ssize_t
+tnt_update_value_raw(struct tnt_stream *ops, uint32_t fieldno, char op,
+		     const char *value, size_t len);
+
 /**
  * \brief shortcut for tnt_object() with type == TNT_SBO_SPARSE
  */
@@ -0,0 +1,154 @@
+#ifndef TNT_URING_H_INCLUDED
+#define TNT_URING_H_INCLUDED
+
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/**
+ * \file tnt_uring.h
+ * \brief io_uring transport for non-blocking streams
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct tnt_uring;
+struct tnt_stream_net;
+
+/**
+ * \brief Create io_uring instance, that may be shared by many streams
+ *
+ * Stream is attached to ring with tnt_set(s, TNT_OPT_URING, ring), before
+ * tnt_connect(). Attached stream is switched into non-blocking mode, but
+ * instead of calling send(2)/recv(2) it only queues requests into ring and
+ * fails with TNT_EAGAIN. All queued requests of all streams are submitted
+ * by single tnt_uring_enter() call, which also processes completions.
+ *
+ * Send/recv buffers of attached streams are registered in ring (if kernel
+ * supports sparse buffer tables), so fixed read/write operations are used.
+ *
+ * \param entries submission queue size (rounded up to power of 2 by kernel)
+ *
+ * \returns ring pointer
+ * \retval  NULL io_uring isn't supported by build or by kernel, or OOM.
+ *               Streams must use poll(2) based non-blocking mode then.
+ *
+ * \code{.c}
+ * struct tnt_uring *ring = tnt_uring_new(256);
+ * for (int i = 0; i < n; ++i) {
+ *     tnt_set(s[i], TNT_OPT_URI, uri);
+ *     tnt_set(s[i], TNT_OPT_URING, ring);
+ *     tnt_connect(s[i]);
+ * }
+ * ...
+ * tnt_uring_enter(ring, 1);
+ * \endcode
+ */
+struct tnt_uring *
+tnt_uring_new(unsigned entries);
+
+/**
+ * \brief Free ring. All attached streams must be freed before.
+ */
+void
+tnt_uring_free(struct tnt_uring *ring);
+
+/**
+ * \brief Submit queued requests and process completions
+ *
+ * Streams, which requests are completed, may be continued: tnt_connect(),
+ * tnt_flush() and read_reply() must be called again for them.
+ *
+ * \param ring    ring pointer
+ * \param wait_nr minimal number of completions to wait for (0 - don't wait)
+ *
+ * \returns number of processed completions
+ * \retval  -1 io_uring_enter(2) failed, errno is set
+ */
+int
+tnt_uring_enter(struct tnt_uring *ring, unsigned wait_nr);
+
+/**
+ * \internal
+ * \brief Operations, that are in flight for stream (bitmap)
+ */
+enum tnt_uring_op {
+	TNT_URING_SEND = 1,
+	TNT_URING_RECV = 2,
+	TNT_URING_POLL = 4
+};
+
+/**
+ * \internal
+ * \brief Register stream buffers in ring (not registered if failed)
+ */
+void
+tnt_uring_attach(struct tnt_uring *ring, struct tnt_stream_net *s);
+
+/**
+ * \internal
+ * \brief Unregister stream buffers
+ */
+void
+tnt_uring_detach(struct tnt_uring *ring, struct tnt_stream_net *s);
+
+/**
+ * \internal
+ * \brief Queue send of the whole send buffer, if it's not in flight
+ */
+int
+tnt_uring_send(struct tnt_uring *ring, struct tnt_stream_net *s);
+
+/**
+ * \internal
+ * \brief Queue recv into the free tail of recv buffer
+ */
+int
+tnt_uring_recv(struct tnt_uring *ring, struct tnt_stream_net *s);
+
+/**
+ * \internal
+ * \brief Queue waiting for socket events
+ */
+int
+tnt_uring_poll(struct tnt_uring *ring, struct tnt_stream_net *s, int events);
+
+/**
+ * \internal
+ * \brief Cancel requests in flight and wait for their completion
+ */
+void
+tnt_uring_cancel(struct tnt_uring *ring, struct tnt_stream_net *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TNT_URING_H_INCLUDED */
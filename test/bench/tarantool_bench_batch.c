@@ -0,0 +1,138 @@
+/*
+ * Request throughput benchmark for batch encoder.
+ *
+ * Usage: tarantool-bench-batch [uri] [requests] [batch]
+ *
+ * uri defaults to $LISTEN. Selects from _vspace by name are written by
+ * batches of the given size, either one tnt_select() per request or one
+ * tnt_batch() per batch, all replies of a batch are read before the next
+ * one. Both encoding alone (into tnt_buf) and round trips are measured.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include <tarantool/tarantool.h>
+#include <tarantool/tnt_net.h>
+#include <tarantool/tnt_opt.h>
+#include <tarantool/tnt_buf.h>
+
+struct bench {
+	const char *uri;
+	long requests;
+	int batch;
+	struct tnt_stream **keys;
+};
+
+static double
+bench_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench_write(struct bench *b, struct tnt_stream *s, int batched)
+{
+	int rc = b->batch, i;
+	if (batched) {
+		rc = tnt_batch(s, TNT_OP_SELECT, 281, 2, b->keys, b->batch,
+			       NULL);
+	} else {
+		for (i = 0; i < b->batch; ++i)
+			if (tnt_select(s, 281, 2, UINT32_MAX, 0, TNT_ITER_EQ,
+				       b->keys[i]) == -1)
+				rc = -1;
+	}
+	if (rc != b->batch) {
+		fprintf(stderr, "write failed: %s\n", tnt_strerror(s));
+		exit(1);
+	}
+}
+
+static void
+bench_encode(struct bench *b, const char *name, int batched)
+{
+	struct tnt_stream *buf = tnt_buf(NULL);
+	assert(buf != NULL);
+	double start = bench_now();
+	long i;
+	for (i = 0; i < b->requests; i += b->batch) {
+		bench_write(b, buf, batched);
+		TNT_SBUF_SIZE(buf) = 0;
+	}
+	double t = bench_now() - start;
+	tnt_stream_free(buf);
+	printf("encode %-10s %12.0f req/s\n", name, i / t);
+}
+
+static void
+bench_run(struct bench *b, const char *name, int batched)
+{
+	struct tnt_stream *tnt = tnt_net(NULL);
+	assert(tnt != NULL);
+	tnt_set(tnt, TNT_OPT_URI, b->uri);
+	if (tnt_connect(tnt) == -1) {
+		fprintf(stderr, "connect failed: %s\n", tnt_strerror(tnt));
+		exit(1);
+	}
+	struct tnt_reply reply;
+	double start = bench_now();
+	long i;
+	int j;
+	for (i = 0; i < b->requests; i += b->batch) {
+		bench_write(b, tnt, batched);
+		if (tnt_flush(tnt) == -1) {
+			fprintf(stderr, "send failed: %s\n",
+				tnt_strerror(tnt));
+			exit(1);
+		}
+		for (j = 0; j < b->batch; ++j) {
+			tnt_reply_init(&reply);
+			if (tnt->read_reply(tnt, &reply) != 0) {
+				fprintf(stderr, "recv failed: %s\n",
+					tnt_strerror(tnt));
+				exit(1);
+			}
+			tnt_reply_free(&reply);
+		}
+	}
+	double t = bench_now() - start;
+	tnt_stream_free(tnt);
+	printf("send   %-10s %12.0f req/s\n", name, i / t);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench b;
+	b.uri = argc > 1 ? argv[1] : getenv("LISTEN");
+	b.requests = argc > 2 ? atol(argv[2]) : 1000000;
+	b.batch = argc > 3 ? atoi(argv[3]) : 64;
+	if (b.uri == NULL || b.requests <= 0 || b.batch <= 0) {
+		fprintf(stderr, "usage: %s uri [requests] [batch]\n", argv[0]);
+		return 1;
+	}
+	const char *names[] = { "_vspace", "_vindex", "_vuser", "_vfunc" };
+	b.keys = calloc(b.batch, sizeof(struct tnt_stream *));
+	assert(b.keys != NULL);
+	int i;
+	for (i = 0; i < b.batch; ++i) {
+		b.keys[i] = tnt_object(NULL);
+		tnt_object_format(b.keys[i], "[%s]", names[i % 4]);
+	}
+	printf("%ld selects by batches of %d\n", b.requests, b.batch);
+
+	bench_encode(&b, "per call", 0);
+	bench_encode(&b, "batch", 1);
+	bench_run(&b, "per call", 0);
+	bench_run(&b, "batch", 1);
+	for (i = 0; i < b.batch; ++i)
+		tnt_stream_free(b.keys[i]);
+	free(b.keys);
+	return 0;
+}
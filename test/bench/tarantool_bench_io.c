@@ -0,0 +1,173 @@
+/*
+ * Pipelined ping benchmark for network backends.
+ *
+ * Usage: tarantool-bench-io [uri] [connections] [depth] [requests]
+ *
+ * uri defaults to $LISTEN. Every connection keeps up to `depth` pings in
+ * flight, until `requests` replies are received. The same load is run
+ * through poll(2) based non-blocking streams and through streams attached
+ * to single io_uring instance (if supported).
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <poll.h>
+#include <time.h>
+
+#include <tarantool/tarantool.h>
+#include <tarantool/tnt_net.h>
+#include <tarantool/tnt_opt.h>
+#include <tarantool/tnt_uring.h>
+
+struct bench {
+	const char *uri;
+	int conns;
+	int depth;
+	long requests;
+};
+
+struct bench_conn {
+	struct tnt_stream *tnt;
+	long sent;
+	long received;
+	int ready;
+};
+
+static double
+bench_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+bench_again(struct tnt_stream *tnt, int rc)
+{
+	return rc == -1 && tnt_error(tnt) == TNT_EAGAIN;
+}
+
+/* returns 1, when connection is done */
+static int
+bench_step(struct bench *b, struct bench_conn *c)
+{
+	if (!c->ready) {
+		int rc = tnt_connect(c->tnt);
+		if (bench_again(c->tnt, rc))
+			return 0;
+		if (rc == -1) {
+			fprintf(stderr, "connect failed: %s\n",
+				tnt_strerror(c->tnt));
+			exit(1);
+		}
+		c->ready = 1;
+	}
+	struct tnt_reply reply;
+	while (c->received < b->requests) {
+		tnt_reply_init(&reply);
+		int rc = c->tnt->read_reply(c->tnt, &reply);
+		if (rc != 0)
+			break;
+		tnt_reply_free(&reply);
+		c->received++;
+	}
+	while (c->sent < b->requests && c->sent - c->received < b->depth) {
+		if (tnt_ping(c->tnt) == -1)
+			break;
+		c->sent++;
+	}
+	if (tnt_flush(c->tnt) == -1 && !bench_again(c->tnt, -1)) {
+		fprintf(stderr, "send failed: %s\n", tnt_strerror(c->tnt));
+		exit(1);
+	}
+	return c->received == b->requests;
+}
+
+static double
+bench_run(struct bench *b, struct tnt_uring *ring)
+{
+	struct bench_conn *c = calloc(b->conns, sizeof(struct bench_conn));
+	struct pollfd *fds = calloc(b->conns, sizeof(struct pollfd));
+	assert(c != NULL && fds != NULL);
+	int i, done = 0;
+	for (i = 0; i < b->conns; ++i) {
+		c[i].tnt = tnt_net(NULL);
+		assert(c[i].tnt != NULL);
+		tnt_set(c[i].tnt, TNT_OPT_URI, b->uri);
+		tnt_set(c[i].tnt, TNT_OPT_SEND_BUF, 65536);
+		tnt_set(c[i].tnt, TNT_OPT_RECV_BUF, 65536);
+		if (ring != NULL)
+			tnt_set(c[i].tnt, TNT_OPT_URING, ring);
+		else
+			tnt_set(c[i].tnt, TNT_OPT_NONBLOCK, 1);
+	}
+	double start = bench_now();
+	while (done < b->conns) {
+		done = 0;
+		for (i = 0; i < b->conns; ++i)
+			done += bench_step(b, &c[i]);
+		if (done == b->conns)
+			break;
+		if (ring != NULL) {
+			if (tnt_uring_enter(ring, 1) == -1) {
+				perror("io_uring_enter");
+				exit(1);
+			}
+			continue;
+		}
+		int nfds = 0;
+		for (i = 0; i < b->conns; ++i) {
+			int events = tnt_events(c[i].tnt);
+			if (events == 0)
+				continue;
+			fds[nfds].fd = tnt_fd(c[i].tnt);
+			fds[nfds].events = events;
+			nfds++;
+		}
+		poll(fds, nfds, 1000);
+	}
+	double elapsed = bench_now() - start;
+	for (i = 0; i < b->conns; ++i)
+		tnt_stream_free(c[i].tnt);
+	free(fds);
+	free(c);
+	return elapsed;
+}
+
+static void
+bench_report(struct bench *b, const char *name, double elapsed)
+{
+	double total = (double)b->requests * b->conns;
+	printf("%-8s %10.0f req/s  (%.3f sec)\n", name, total / elapsed,
+	       elapsed);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench b;
+	b.uri = argc > 1 ? argv[1] : getenv("LISTEN");
+	b.conns = argc > 2 ? atoi(argv[2]) : 16;
+	b.depth = argc > 3 ? atoi(argv[3]) : 128;
+	b.requests = argc > 4 ? atol(argv[4]) : 100000;
+	if (b.uri == NULL) {
+		fprintf(stderr, "usage: %s uri [connections] [depth] "
+			"[requests]\n", argv[0]);
+		return 1;
+	}
+	printf("%d connections, %d in flight, %ld requests per "
+	       "connection\n", b.conns, b.depth, b.requests);
+
+	bench_report(&b, "poll", bench_run(&b, NULL));
+
+	struct tnt_uring *ring = tnt_uring_new(2 * b.conns);
+	if (ring == NULL) {
+		printf("%-8s not supported\n", "io_uring");
+		return 0;
+	}
+	bench_report(&b, "io_uring", bench_run(&b, ring));
+	tnt_uring_free(ring);
+	return 0;
+}
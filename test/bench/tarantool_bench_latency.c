@@ -0,0 +1,117 @@
+/*
+ * Request latency benchmark for low latency socket profile.
+ *
+ * Usage: tarantool-bench-latency [uri] [requests] [spin usec]
+ *
+ * uri defaults to $LISTEN. A single blocking connection sends one ping at
+ * a time and measures its round trip. The same load is run with default
+ * socket options, with TNT_OPT_LOW_LATENCY and with the profile plus
+ * spinning reads (TNT_OPT_RECV_SPIN), p50/p99/p99.9 are reported.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include <tarantool/tarantool.h>
+#include <tarantool/tnt_net.h>
+#include <tarantool/tnt_opt.h>
+
+struct bench {
+	const char *uri;
+	long requests;
+	double *samples;
+};
+
+static double
+bench_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int
+bench_cmp(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+static double
+bench_percentile(struct bench *b, double p)
+{
+	long i = (long)(p * (b->requests - 1));
+	return b->samples[i] * 1e6;
+}
+
+static void
+bench_run(struct bench *b, const char *name, int low_latency, int spin)
+{
+	struct tnt_stream *tnt = tnt_net(NULL);
+	assert(tnt != NULL);
+	tnt_set(tnt, TNT_OPT_URI, b->uri);
+	tnt_set(tnt, TNT_OPT_LOW_LATENCY, low_latency);
+	if (spin > 0) {
+		struct timeval tv = { 0, spin };
+		tnt_set(tnt, TNT_OPT_RECV_SPIN, &tv);
+	}
+	if (tnt_connect(tnt) == -1) {
+		fprintf(stderr, "connect failed: %s\n", tnt_strerror(tnt));
+		exit(1);
+	}
+	struct tnt_reply reply;
+	long i;
+	for (i = 0; i < b->requests; ++i) {
+		double start = bench_now();
+		tnt_ping(tnt);
+		if (tnt_flush(tnt) == -1) {
+			fprintf(stderr, "send failed: %s\n",
+				tnt_strerror(tnt));
+			exit(1);
+		}
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) != 0) {
+			fprintf(stderr, "recv failed: %s\n",
+				tnt_strerror(tnt));
+			exit(1);
+		}
+		tnt_reply_free(&reply);
+		b->samples[i] = bench_now() - start;
+	}
+	int busy_poll = TNT_SNET_CAST(tnt)->busy_poll;
+	tnt_stream_free(tnt);
+
+	qsort(b->samples, b->requests, sizeof(double), bench_cmp);
+	printf("%-12s p50 %8.1f us  p99 %8.1f us  p99.9 %8.1f us",
+	       name, bench_percentile(b, 0.5), bench_percentile(b, 0.99),
+	       bench_percentile(b, 0.999));
+	if (low_latency && busy_poll == 0)
+		printf("  (SO_BUSY_POLL not permitted)");
+	printf("\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench b;
+	b.uri = argc > 1 ? argv[1] : getenv("LISTEN");
+	b.requests = argc > 2 ? atol(argv[2]) : 100000;
+	int spin = argc > 3 ? atoi(argv[3]) : 50;
+	if (b.uri == NULL || b.requests <= 0) {
+		fprintf(stderr, "usage: %s uri [requests] [spin usec]\n",
+			argv[0]);
+		return 1;
+	}
+	b.samples = calloc(b.requests, sizeof(double));
+	assert(b.samples != NULL);
+	printf("%ld sequential pings\n", b.requests);
+
+	bench_run(&b, "default", 0, 0);
+	bench_run(&b, "low latency", 1, 0);
+	bench_run(&b, "spin", 1, spin);
+	free(b.samples);
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Object encoding benchmark for container packing types.
+ *
+ * Usage: tarantool-bench-object [elements] [pairs] [rounds]
+ *
+ * An array of elements maps with pairs key/value pairs each is built with
+ * tnt_object_add_* using TNT_SBO_SIMPLE (sizes are known), TNT_SBO_SPARSE
+ * and TNT_SBO_PACKED. Maps with more than 15 pairs need expanded headers
+ * in packed mode. Then small keys are encoded with tnt_object_format() and
+ * with a format, compiled by tnt_format_compile().
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+
+#include <msgpuck.h>
+
+#include <tarantool/tarantool.h>
+
+struct bench {
+	long elements;
+	int pairs;
+	int rounds;
+};
+
+static double
+bench_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void
+bench_build(struct bench *b, struct tnt_stream *s, enum tnt_sbo_type type)
+{
+	tnt_object_reset(s);
+	tnt_object_type(s, type);
+	tnt_object_add_array(s, b->elements);
+	long i;
+	int j;
+	for (i = 0; i < b->elements; ++i) {
+		tnt_object_add_map(s, b->pairs);
+		for (j = 0; j < b->pairs; ++j) {
+			tnt_object_add_uint(s, j);
+			tnt_object_add_int(s, i);
+		}
+		tnt_object_container_close(s);
+	}
+	tnt_object_container_close(s);
+}
+
+static void
+bench_run(struct bench *b, const char *name, enum tnt_sbo_type type)
+{
+	struct tnt_stream *s = tnt_object(NULL);
+	assert(s != NULL);
+	double start = bench_now();
+	int r;
+	for (r = 0; r < b->rounds; ++r) {
+		bench_build(b, s, type);
+	}
+	double t = bench_now() - start;
+	if (tnt_object_verify(s, MP_ARRAY) == -1) {
+		fprintf(stderr, "%s: broken object\n", name);
+		exit(1);
+	}
+	printf("%-8s %10.1f ns/element %10zu bytes\n", name,
+	       t * 1e9 / (b->rounds * b->elements), TNT_SBUF_SIZE(s));
+	tnt_stream_free(s);
+}
+
+/* key of request, built from format string for every request */
+static void
+bench_key(struct bench *b, const char *name, int compiled)
+{
+	const char *fmt = "[%d%s{%s%u}]";
+	struct tnt_format *f = tnt_format_compile(fmt);
+	struct tnt_stream *s = tnt_object(NULL);
+	assert(f != NULL && s != NULL);
+	long n = b->elements * b->rounds, i;
+	double start = bench_now();
+	for (i = 0; i < n; ++i) {
+		tnt_object_reset(s);
+		if (compiled)
+			tnt_format_encode(s, f, (int)i, "name", "id", 42);
+		else
+			tnt_object_format(s, fmt, (int)i, "name", "id", 42);
+	}
+	double t = bench_now() - start;
+	printf("%-8s %10.1f ns/key %14zu bytes\n", name, t * 1e9 / n,
+	       TNT_SBUF_SIZE(s));
+	tnt_stream_free(s);
+	tnt_format_free(f);
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench b;
+	b.elements = argc > 1 ? atol(argv[1]) : 10000;
+	b.pairs = argc > 2 ? atoi(argv[2]) : 16;
+	b.rounds = argc > 3 ? atoi(argv[3]) : 100;
+	if (b.elements <= 0 || b.pairs < 0 || b.rounds <= 0) {
+		fprintf(stderr, "usage: %s [elements] [pairs] [rounds]\n",
+			argv[0]);
+		return 1;
+	}
+	printf("array of %ld maps with %d pairs\n", b.elements, b.pairs);
+
+	bench_run(&b, "simple", TNT_SBO_SIMPLE);
+	bench_run(&b, "sparse", TNT_SBO_SPARSE);
+	bench_run(&b, "packed", TNT_SBO_PACKED);
+	printf("keys \"[%%d%%s{%%s%%u}]\"\n");
+	bench_key(&b, "format", 0);
+	bench_key(&b, "compiled", 1);
+	return 0;
+}
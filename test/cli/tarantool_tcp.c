@@ -3,6 +3,11 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include <msgpuck.h>
 
@@ -10,6 +15,10 @@
 
 #include <tarantool/tnt_net.h>
 #include <tarantool/tnt_opt.h>
+#include <tarantool/tnt_uring.h>
+#include <tarantool/tnt_mux.h>
+#include <tarantool/tnt_expect.h>
+#include <tarantool/tnt_pool.h>
 
 #include "common.h"
 
@@ -917,8 +926,1648 @@ test_object_format_uint(const char *uri)
 	return check_plan();
 }
 
+static int
+test_nonblock(const char *uri) {
+	plan(6);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	isnt(tnt, NULL, "Checking that stream is allocated");
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_NONBLOCK, 1);
+
+	int rc = 0;
+	struct pollfd pfd;
+	while ((rc = tnt_connect(tnt)) == -1 && tnt_error(tnt) == TNT_EAGAIN) {
+		pfd.fd = tnt_fd(tnt);
+		pfd.events = tnt_events(tnt);
+		poll(&pfd, 1, 1000);
+	}
+	is  (rc, 0, "Connecting in non-blocking mode");
+	is  (tnt_state(tnt), TNT_STATE_READY, "Checking connection state");
+	isnt(tnt_get_spaceno(tnt, "test", 4), -1, "Checking schema is loaded");
+
+	tnt_ping(tnt);
+	struct tnt_reply reply;
+	tnt_reply_init(&reply);
+	while (1) {
+		tnt_flush(tnt);
+		rc = tnt->read_reply(tnt, &reply);
+		if (rc != -1 || tnt_error(tnt) != TNT_EAGAIN)
+			break;
+		pfd.fd = tnt_fd(tnt);
+		pfd.events = tnt_events(tnt);
+		poll(&pfd, 1, 1000);
+	}
+	is  (rc, 0, "Reading ping reply");
+	is  (reply.code, 0, "Checking ping reply code");
+	tnt_reply_free(&reply);
+
+	tnt_close(tnt);
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_uring(const char *uri) {
+	plan(6);
+	header();
+
+	struct tnt_uring *ring = tnt_uring_new(64);
+	if (ring == NULL) {
+		for (int i = 0; i < 6; ++i)
+			skip("io_uring isn't supported");
+		footer();
+		return check_plan();
+	}
+
+	struct tnt_stream *tnt[2];
+	int i, rc[2], done = 0;
+	for (i = 0; i < 2; ++i) {
+		tnt[i] = tnt_net(NULL);
+		tnt_set(tnt[i], TNT_OPT_URI, uri);
+		tnt_set(tnt[i], TNT_OPT_URING, ring);
+		rc[i] = tnt_connect(tnt[i]);
+	}
+	for (done = 0; done != 2; ) {
+		tnt_uring_enter(ring, 1);
+		for (i = 0, done = 0; i < 2; ++i) {
+			if (rc[i] == -1 && tnt_error(tnt[i]) == TNT_EAGAIN)
+				rc[i] = tnt_connect(tnt[i]);
+			if (rc[i] != -1 || tnt_error(tnt[i]) != TNT_EAGAIN)
+				done++;
+		}
+	}
+	is  (rc[0], 0, "Connecting first stream through io_uring");
+	is  (rc[1], 0, "Connecting second stream through io_uring");
+	isnt(tnt_get_spaceno(tnt[0], "test", 4), -1, "Checking schema is loaded");
+
+	struct tnt_reply reply[2];
+	for (i = 0; i < 2; ++i) {
+		tnt_reply_init(&reply[i]);
+		tnt_ping(tnt[i]);
+		tnt_flush(tnt[i]);
+		rc[i] = -1;
+	}
+	for (done = 0; done != 2; ) {
+		tnt_uring_enter(ring, 1);
+		for (i = 0, done = 0; i < 2; ++i) {
+			if (rc[i] == -1 && tnt_error(tnt[i]) == TNT_EAGAIN)
+				rc[i] = tnt[i]->read_reply(tnt[i], &reply[i]);
+			if (rc[i] != -1 || tnt_error(tnt[i]) != TNT_EAGAIN)
+				done++;
+		}
+	}
+	is  (rc[0], 0, "Reading first ping reply");
+	is  (rc[1], 0, "Reading second ping reply");
+	is  (reply[0].sync, reply[1].sync, "Checking replies sync");
+
+	for (i = 0; i < 2; ++i) {
+		tnt_reply_free(&reply[i]);
+		tnt_stream_free(tnt[i]);
+	}
+	tnt_uring_free(ring);
+
+	footer();
+	return check_plan();
+}
+
+static void *(*oom_prev)(void *, size_t) = NULL;
+
+/* allocations fail, frees and shrinks still work */
+static void *
+oom_realloc(void *ptr, size_t size) {
+	if (size > 0)
+		return NULL;
+	return oom_prev(ptr, size);
+}
+
+static int
+test_reply_zerocopy(const char *uri) {
+	plan(8);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_RECV_BUF, 1024);
+	tnt_set(tnt, TNT_OPT_REPLY_ZEROCOPY, 1);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	/* kept replies don't fit into recv buffer together */
+	enum { count = 100 };
+	struct tnt_reply reply[count];
+	int i, rc = 0, code = 0, pinned = 0, sync = 1;
+	for (i = 0; i < count; ++i)
+		tnt_ping(tnt);
+	tnt_flush(tnt);
+	for (i = 0; i < count; ++i) {
+		tnt_reply_init(&reply[i]);
+		rc |= tnt->read_reply(tnt, &reply[i]);
+		code |= reply[i].code;
+		pinned += (reply[i].pin != NULL);
+		sync &= (i == 0 || reply[i].sync == reply[i - 1].sync + 1);
+	}
+	is  (rc, 0, "Reading replies");
+	is  (code, 0, "Checking replies code");
+	is  (pinned, count, "Checking replies point into recv buffer");
+	is  (sync, 1, "Checking replies sync");
+
+	/* buffer is dropped, if pinned memory can't be replaced on close */
+	oom_prev = tnt_mem_init(oom_realloc);
+	tnt_close(tnt);
+	tnt_mem_init(oom_prev);
+	is  (TNT_SNET_CAST(tnt)->rbuf.buf, NULL, "Dropping pinned buffer");
+	struct tnt_reply last;
+	tnt_reply_init(&last);
+	isnt(tnt_connect(tnt), -1, "Reconnecting with new buffer");
+	tnt_ping(tnt);
+	tnt_flush(tnt);
+	ok  (tnt->read_reply(tnt, &last) == 0 && last.code == 0 &&
+	     reply[count - 1].sync == reply[0].sync + count - 1,
+	     "Reading into new buffer, old replies are intact");
+	tnt_reply_free(&last);
+
+	/* replies outlive stream */
+	tnt_stream_free(tnt);
+	for (i = 0; i < count; ++i)
+		tnt_reply_free(&reply[i]);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_big_reply(const char *uri) {
+	plan(7);
+	header();
+
+	const char *expr = "return string.rep('x', 200000)";
+	struct tnt_stream *args = tnt_object(NULL);
+	tnt_object_add_array(args, 0);
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_RECV_BUF, 1024);
+	tnt_set(tnt, TNT_OPT_REPLY_ZEROCOPY, 1);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	struct tnt_reply reply;
+	tnt_reply_init(&reply);
+	tnt_eval(tnt, expr, strlen(expr), args);
+	tnt_flush(tnt);
+	is  (tnt->read_reply(tnt, &reply), 0, "Reading reply bigger, than buffer");
+	isnt(reply.pin, NULL, "Checking reply points into grown buffer");
+	const char *data = reply.data;
+	uint32_t slen = 0;
+	if (data != NULL && mp_decode_array(&data) == 1 &&
+	    mp_typeof(*data) == MP_STR)
+		mp_decode_str(&data, &slen);
+	is  (slen, 200000, "Checking reply data");
+	tnt_reply_free(&reply);
+	tnt_stream_free(tnt);
+
+	/* reply is bigger, than buffer may grow, so it's copied */
+	tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_RECV_BUF, 1024);
+	tnt_set(tnt, TNT_OPT_RECV_BUF_MAX, 4096);
+	tnt_set(tnt, TNT_OPT_REPLY_ZEROCOPY, 1);
+	tnt_connect(tnt);
+	tnt_reply_init(&reply);
+	tnt_eval(tnt, expr, strlen(expr), args);
+	tnt_flush(tnt);
+	is  (tnt->read_reply(tnt, &reply), 0, "Reading reply bigger, than buffer cap");
+	is  (reply.pin, NULL, "Checking reply is copied");
+	data = reply.data;
+	slen = 0;
+	if (data != NULL && mp_decode_array(&data) == 1 &&
+	    mp_typeof(*data) == MP_STR)
+		mp_decode_str(&data, &slen);
+	is  (slen, 200000, "Checking reply data");
+	tnt_reply_free(&reply);
+	tnt_stream_free(tnt);
+
+	tnt_stream_free(args);
+
+	footer();
+	return check_plan();
+}
+
+/* reply of "return ..." eval, that echoes single string argument */
+static int
+check_echo(struct tnt_reply *reply, const char *str, uint32_t len)
+{
+	const char *data = reply->data;
+	uint32_t slen = 0;
+	if (data == NULL || mp_decode_array(&data) != 1 ||
+	    mp_typeof(*data) != MP_STR)
+		return 0;
+	const char *s = mp_decode_str(&data, &slen);
+	return slen == len && memcmp(s, str, len) == 0;
+}
+
+static int
+test_send_borrow(const char *uri) {
+	plan(5);
+	header();
+
+	const char *expr = "return ...";
+	enum { len = 100000, count = 20 };
+	char *str = malloc(len);
+	for (int i = 0; i < len; ++i)
+		str[i] = 'a' + i % 26;
+	struct tnt_stream *args = tnt_object(NULL);
+	tnt_object_add_array(args, 1);
+	tnt_object_add_str(args, str, len);
+
+	/* payload is much bigger, than send buffer */
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_SEND_BUF, 1024);
+	tnt_set(tnt, TNT_OPT_SEND_BORROW, 512);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	int i, rc = 0, ok = 0;
+	for (i = 0; i < count; ++i)
+		rc |= tnt_eval(tnt, expr, strlen(expr), args);
+	isnt(rc, -1, "Queueing requests with borrowed payload");
+	tnt_flush(tnt);
+	struct tnt_reply reply;
+	for (i = 0; i < count; ++i) {
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0)
+			ok += check_echo(&reply, str, len);
+		tnt_reply_free(&reply);
+	}
+	is  (ok, count, "Checking replies");
+	tnt_stream_free(tnt);
+
+	/* socket accepts only parts of payloads */
+	tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_NONBLOCK, 1);
+	tnt_set(tnt, TNT_OPT_SEND_BORROW, 512);
+	struct pollfd pfd;
+	while ((rc = tnt_connect(tnt)) == -1 && tnt_error(tnt) == TNT_EAGAIN) {
+		pfd.fd = tnt_fd(tnt);
+		pfd.events = tnt_events(tnt);
+		poll(&pfd, 1, 1000);
+	}
+	for (i = 0; i < count; ++i)
+		tnt_eval(tnt, expr, strlen(expr), args);
+	is  (TNT_SNET_CAST(tnt)->sendq_count, count,
+	     "Checking payloads aren't copied");
+	ok = 0;
+	for (i = 0; i < count; ) {
+		tnt_flush(tnt);
+		tnt_reply_init(&reply);
+		rc = tnt->read_reply(tnt, &reply);
+		if (rc == 0) {
+			ok += check_echo(&reply, str, len);
+			i++;
+		}
+		tnt_reply_free(&reply);
+		if (rc == 0)
+			continue;
+		if (tnt_error(tnt) != TNT_EAGAIN)
+			break;
+		pfd.fd = tnt_fd(tnt);
+		pfd.events = tnt_events(tnt);
+		poll(&pfd, 1, 1000);
+	}
+	is  (ok, count, "Checking replies in non-blocking mode");
+	tnt_stream_free(tnt);
+
+	tnt_stream_free(args);
+	free(str);
+
+	footer();
+	return check_plan();
+}
+
+struct mux_worker {
+	struct tnt_mux *mux;
+	int id;
+	int rc;
+	int matched;
+};
+
+enum { mux_threads = 8, mux_calls = 200 };
+
+static void *
+mux_worker_f(void *arg)
+{
+	struct mux_worker *w = arg;
+	struct tnt_stream *args = tnt_object(NULL);
+	struct tnt_request *req = tnt_request_eval(NULL);
+	tnt_request_set_exprz(req, "return ...");
+	for (int i = 0; i < mux_calls; ++i) {
+		tnt_object_reset(args);
+		tnt_object_format(args, "[%d%d]", w->id, i);
+		tnt_request_set_tuple(req, args);
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		w->rc |= tnt_mux_call(w->mux, req, &reply);
+		const char *data = reply.data;
+		if (data != NULL && mp_decode_array(&data) == 2 &&
+		    mp_decode_uint(&data) == (uint64_t)w->id &&
+		    mp_decode_uint(&data) == (uint64_t)i)
+			w->matched++;
+		tnt_reply_free(&reply);
+	}
+	tnt_request_free(req);
+	tnt_stream_free(args);
+	return NULL;
+}
+
+static int
+test_mux(const char *uri) {
+	plan(7);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	struct tnt_mux *mux = tnt_mux_new(tnt);
+	isnt(mux, NULL, "Creating mux");
+
+	struct mux_worker w[mux_threads];
+	pthread_t thread[mux_threads];
+	int i, rc = 0, matched = 0;
+	for (i = 0; i < mux_threads; ++i) {
+		w[i].mux = mux;
+		w[i].id = i;
+		w[i].rc = 0;
+		w[i].matched = 0;
+		pthread_create(&thread[i], NULL, mux_worker_f, &w[i]);
+	}
+	for (i = 0; i < mux_threads; ++i) {
+		pthread_join(thread[i], NULL);
+		rc |= w[i].rc;
+		matched += w[i].matched;
+	}
+	is  (rc, 0, "Calling from many threads");
+	is  (matched, mux_threads * mux_calls, "Checking replies are dispatched by sync");
+	is  (tnt_mux_error(mux), TNT_EOK, "Checking connection is alive");
+
+	tnt_mux_free(mux);
+	tnt_stream_free(tnt);
+
+	tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_WINDOW, 2);
+	tnt_set(tnt, TNT_OPT_WINDOW_MODE, TNT_WINDOW_FAIL);
+	mux = tnt_mux_new(tnt);
+	rc = 0;
+	matched = 0;
+	for (i = 0; i < mux_threads; ++i) {
+		w[i].mux = mux;
+		w[i].rc = 0;
+		w[i].matched = 0;
+		pthread_create(&thread[i], NULL, mux_worker_f, &w[i]);
+	}
+	for (i = 0; i < mux_threads; ++i) {
+		pthread_join(thread[i], NULL);
+		rc |= w[i].rc;
+		matched += w[i].matched;
+	}
+	is  (rc, 0, "Calling with small window");
+	is  (matched, mux_threads * mux_calls, "Queuing requests over window");
+	is  (tnt_mux_error(mux), TNT_EOK, "Checking full window isn't fatal");
+
+	tnt_mux_free(mux);
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+static void
+expect_cb(struct tnt_stream *s, struct tnt_reply *r, void *arg)
+{
+	(void)s;
+	int *count = arg;
+	if (r->code == 0)
+		(*count)++;
+}
+
+static int
+test_expect(const char *uri) {
+	plan(5);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_RECV_BUF, 1024);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	enum { count = 100 };
+	struct tnt_request *ping = tnt_request_ping(NULL);
+	int i, rc = 0, done = 0;
+	for (i = 0; i < count; ++i)
+		rc |= tnt_expect(tnt, tnt_request_compile(tnt, ping), expect_cb,
+				 &done);
+	tnt_flush(tnt);
+	while (done < count && rc != -1)
+		rc = tnt_poll_replies(tnt);
+	is  (done, count, "Dispatching replies to callbacks");
+	tnt_request_free(ping);
+
+	/* futures are waited in reverse order */
+	struct tnt_future f[3];
+	struct tnt_stream *args = tnt_object(NULL);
+	struct tnt_request *eval = tnt_request_eval(NULL);
+	tnt_request_set_exprz(eval, "return ...");
+	for (i = 0; i < 3; ++i) {
+		tnt_object_reset(args);
+		tnt_object_format(args, "[%d]", i);
+		tnt_request_set_tuple(eval, args);
+		tnt_future_init(&f[i]);
+		tnt_expect_future(tnt, tnt_request_compile(tnt, eval), &f[i]);
+	}
+	tnt_flush(tnt);
+	is  (tnt_future_wait(tnt, &f[2]), 0, "Waiting for last future");
+	int ready = 0, matched = 0;
+	for (i = 0; i < 3; ++i) {
+		tnt_future_wait(tnt, &f[i]);
+		ready += f[i].ready;
+		const char *data = f[i].reply.data;
+		if (data != NULL && mp_decode_array(&data) == 1 &&
+		    mp_decode_uint(&data) == (uint64_t)i)
+			matched++;
+		tnt_future_free(&f[i]);
+	}
+	is  (ready, 3, "Checking futures are ready");
+	is  (matched, 3, "Checking futures replies");
+	tnt_request_free(eval);
+	tnt_stream_free(args);
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_pool(const char *uri) {
+	plan(10);
+	header();
+
+	enum { conns = 4, count = 64 };
+	struct tnt_pool *pool = tnt_pool_new();
+	isnt(pool, NULL, "Creating pool");
+	tnt_pool_add(pool, uri, conns);
+	is  (tnt_pool_connect(pool), conns, "Warming up connections");
+
+	/* every request goes to the least loaded connection */
+	struct tnt_stream *tnt[conns];
+	int i, j, sent[conns];
+	for (i = 0; i < conns; ++i) {
+		tnt[i] = tnt_pool_stream(pool, i);
+		sent[i] = 0;
+	}
+	for (i = 0; i < count; ++i) {
+		struct tnt_stream *s = tnt_pool_get(pool);
+		tnt_ping(s);
+		for (j = 0; j < conns; ++j)
+			sent[j] += (tnt[j] == s);
+	}
+	int balanced = 1;
+	for (j = 0; j < conns; ++j)
+		balanced &= (sent[j] == count / conns);
+	ok  (balanced, "Balancing requests by in-flight count");
+
+	int replies = 0;
+	for (j = 0; j < conns; ++j) {
+		tnt_flush(tnt[j]);
+		struct tnt_reply reply;
+		for (i = 0; i < sent[j]; ++i) {
+			tnt_reply_init(&reply);
+			if (tnt[j]->read_reply(tnt[j], &reply) == 0 &&
+			    reply.code == 0)
+				replies++;
+			tnt_reply_free(&reply);
+		}
+	}
+	is  (replies, count, "Reading replies from all connections");
+
+	/* schema is loaded once and shared */
+	int32_t sno = tnt_get_spaceno(tnt[0], "test", 4);
+	int shared = (sno != -1);
+	for (j = 1; j < conns; ++j)
+		shared &= (tnt_get_spaceno(tnt[j], "test", 4) == sno);
+	ok  (shared, "Sharing schema between connections");
+	is  (tnt_pool_get(pool) != NULL, 1, "Idle connection is available");
+	tnt_pool_free(pool);
+
+	/* schema is owned by the first established connection */
+	pool = tnt_pool_new();
+	tnt_pool_add(pool, "test:test@127.0.0.1:1", 1);
+	tnt_pool_add(pool, uri, 2);
+	is  (tnt_pool_connect(pool), 2, "Skipping failed connection");
+	struct tnt_stream *owner = tnt_pool_owner(pool);
+	struct tnt_stream *other = tnt_pool_stream(pool, 1);
+	if (other == owner)
+		other = tnt_pool_stream(pool, 2);
+	ok  (owner != NULL && owner != tnt_pool_stream(pool, 0) &&
+	     tnt_get_spaceno(other, "test", 4) == sno,
+	     "Choosing established connection as schema owner");
+	is  (tnt_reload_schema(other), -1, "Not reloading borrowed schema");
+	ok  (tnt_reload_schema(owner) == 0 &&
+	     tnt_get_spaceno(other, "test", 4) == sno,
+	     "Reloading schema of owner");
+	tnt_pool_free(pool);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_reconnect(const char *uri) {
+	plan(5);
+	header();
+
+	/* broken socket must fail with EPIPE instead of killing us */
+	signal(SIGPIPE, SIG_IGN);
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_RECONNECT, 3);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	struct tnt_stream *key = tnt_object(NULL);
+	tnt_object_add_array(key, 0);
+	struct tnt_stream *args = tnt_object(NULL);
+	tnt_object_format(args, "[%d]", 1);
+	int32_t sno = tnt_get_spaceno(tnt, "test", 4);
+	uint64_t sync = tnt->reqid;
+	tnt_select(tnt, sno, 0, UINT32_MAX, 0, 0, key);
+	tnt_ping(tnt);
+	tnt_eval(tnt, "return ...", 10, args);
+	tnt_idempotent(tnt);
+	tnt_eval(tnt, "return ...", 10, args);
+
+	/* connection is lost before requests are sent */
+	shutdown(tnt_fd(tnt), SHUT_RDWR);
+	isnt(tnt_flush(tnt), -1, "Reconnecting on flush");
+	int i, replied = 0, lost = 0;
+	for (i = 0; i < 4; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0) {
+			uint64_t n = reply.sync - sync;
+			if (reply.code == 0 && n != 2)
+				replied++;
+			if (reply.code == TNT_ER_NO_CONNECTION && n == 2)
+				lost++;
+		}
+		tnt_reply_free(&reply);
+	}
+	is  (replied, 3, "Resending idempotent requests with original syncs");
+	is  (lost, 1, "Failing other requests");
+	tnt_ping(tnt);
+	tnt_flush(tnt);
+	struct tnt_reply reply;
+	tnt_reply_init(&reply);
+	is  (tnt->read_reply(tnt, &reply), 0, "Checking connection is alive");
+	tnt_reply_free(&reply);
+
+	tnt_stream_free(args);
+	tnt_stream_free(key);
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_resolve_cache(const char *uri) {
+	plan(2);
+	header();
+
+	/* the second connection gets addresses from cache */
+	struct timeval stagger = { 0, 50000 };
+	int i, connected = 0, alive = 0;
+	for (i = 0; i < 2; ++i) {
+		struct tnt_stream *tnt = tnt_net(NULL);
+		tnt_set(tnt, TNT_OPT_URI, uri);
+		tnt_set(tnt, TNT_OPT_RESOLVE_TTL, 60);
+		tnt_set(tnt, TNT_OPT_CONNECT_STAGGER, &stagger);
+		if (tnt_connect(tnt) == 0)
+			connected++;
+		tnt_ping(tnt);
+		tnt_flush(tnt);
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0 && reply.code == 0)
+			alive++;
+		tnt_reply_free(&reply);
+		tnt_stream_free(tnt);
+	}
+	is  (connected, 2, "Connecting with cached addresses");
+	is  (alive, 2, "Checking connections are alive");
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_sockbuf(const char *uri) {
+	plan(5);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	struct tnt_stream_net *sn = TNT_SNET_CAST(tnt);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_SOCKBUF, TNT_SOCKBUF_FIXED);
+	tnt_set(tnt, TNT_OPT_SOCKBUF_SEND, 65536);
+	tnt_set(tnt, TNT_OPT_SOCKBUF_RECV, 65536);
+	isnt(tnt_connect(tnt), -1, "Connecting with fixed buffers");
+	is  (sn->sockbuf_calls, 2, "Setting fixed sizes once");
+	ok  (sn->sockbuf_send >= 65536 && sn->sockbuf_recv >= 65536,
+	     "Checking applied sizes");
+	tnt_close(tnt);
+
+	tnt_set(tnt, TNT_OPT_SOCKBUF, TNT_SOCKBUF_KERNEL);
+	tnt_connect(tnt);
+	is  (sn->sockbuf_calls, 0, "Keeping kernel defaults");
+	tnt_close(tnt);
+
+	/* the first connect may probe, the second reuses probed sizes */
+	tnt_set(tnt, TNT_OPT_SOCKBUF, TNT_SOCKBUF_PROBE_ONCE);
+	tnt_connect(tnt);
+	tnt_close(tnt);
+	tnt_connect(tnt);
+	is  (sn->sockbuf_calls, 2, "Reusing probed sizes");
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_autoflush(const char *uri) {
+	plan(10);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	struct tnt_stream_net *sn = TNT_SNET_CAST(tnt);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_FLUSH_COUNT, 3);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	tnt_ping(tnt);
+	tnt_ping(tnt);
+	ok  (sn->sbuf.off > 0, "Buffering requests below count threshold");
+	tnt_ping(tnt);
+	is  (sn->sbuf.off, 0, "Flushing on count threshold");
+
+	struct timeval delay = { 0, 20000 };
+	tnt_set(tnt, TNT_OPT_FLUSH_COUNT, 0);
+	tnt_set(tnt, TNT_OPT_FLUSH_DELAY, &delay);
+	tnt_ping(tnt);
+	ok  (tnt_flush_timeout(tnt) > 0 && !(tnt_events(tnt) & POLLOUT),
+	     "Waiting for flush delay");
+	usleep(25000);
+	ok  (tnt_flush_timeout(tnt) == 0 && (tnt_events(tnt) & POLLOUT),
+	     "Flush delay is expired");
+	tnt_flush(tnt);
+	is  (tnt_flush_timeout(tnt), -1, "Nothing to flush by timer");
+
+	tnt_set(tnt, TNT_OPT_FLUSH_BYTES, 1);
+	tnt_ping(tnt);
+	is  (sn->sbuf.off, 0, "Flushing on bytes threshold");
+
+	int i, replies = 0;
+	for (i = 0; i < 5; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0 && reply.code == 0)
+			replies++;
+		tnt_reply_free(&reply);
+	}
+	is  (replies, 5, "Reading replies");
+
+	tnt_set(tnt, TNT_OPT_FLUSH_BYTES, 0);
+	tnt_set(tnt, TNT_OPT_FLUSH_COUNT, 3);
+	tnt_ping(tnt);
+	ok  (sn->sbuf.off > 0, "Buffering request before reading");
+	struct tnt_reply reply;
+	tnt_reply_init(&reply);
+	is  (tnt->read_reply(tnt, &reply) == 0 && reply.code == 0, 1,
+	     "Flushing by blocking read");
+	tnt_reply_free(&reply);
+
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_window_read(struct tnt_stream *tnt, int count) {
+	int i, replies = 0;
+	for (i = 0; i < count; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0 && reply.code == 0)
+			replies++;
+		tnt_reply_free(&reply);
+	}
+	return replies;
+}
+
+static int
+test_window(const char *uri) {
+	plan(9);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	struct tnt_stream_net *sn = TNT_SNET_CAST(tnt);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_WINDOW, 2);
+	tnt_set(tnt, TNT_OPT_WINDOW_MODE, TNT_WINDOW_FAIL);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	tnt_ping(tnt);
+	tnt_ping(tnt);
+	ok  (tnt_ping(tnt) == -1 && tnt_error(tnt) == TNT_EWINDOW,
+	     "Failing on full window");
+	tnt_flush(tnt);
+	is  (test_window_read(tnt, 2), 2, "Reading replies");
+
+	tnt_set(tnt, TNT_OPT_WINDOW_MODE, TNT_WINDOW_EAGAIN);
+	tnt_ping(tnt);
+	tnt_ping(tnt);
+	ok  (tnt_ping(tnt) == -1 && tnt_error(tnt) == TNT_EAGAIN,
+	     "Returning EAGAIN on full window");
+	tnt_flush(tnt);
+	is  (test_window_read(tnt, 2), 2, "Reading replies");
+
+	tnt_set(tnt, TNT_OPT_WINDOW_MODE, TNT_WINDOW_BLOCK);
+	int i, written = 0;
+	for (i = 0; i < 10; ++i)
+		written += tnt_ping(tnt) > 0;
+	tnt_flush(tnt);
+	is  (written, 10, "Waiting for replies on full window");
+	is  (test_window_read(tnt, 10), 10, "Reading replies read ahead");
+
+	tnt_set(tnt, TNT_OPT_WINDOW, 64);
+	tnt_set(tnt, TNT_OPT_WINDOW_ADAPTIVE, 1);
+	for (i = 0, written = 0; i < 100; ++i)
+		written += tnt_ping(tnt) > 0;
+	tnt_flush(tnt);
+	is  (test_window_read(tnt, 100), 100, "Pipelining with adaptive window");
+	ok  (sn->rtt_min > 0 && sn->window >= 1 && sn->window <= 64,
+	     "Measuring round trip time");
+
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_deadline(const char *uri) {
+	plan(5);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	struct tnt_stream *args = tnt_object(NULL);
+	tnt_object_add_array(args, 0);
+	const char *expr = "require('fiber').sleep(0.3)";
+	uint64_t sync = tnt->reqid;
+	struct timeval tm = { 0, 50000 };
+	tnt_deadline(tnt, &tm);
+	tnt_eval(tnt, expr, strlen(expr), args);
+	tnt_ping(tnt);
+	tnt_flush(tnt);
+	ok  (tnt_deadline_timeout(tnt) > 0, "Waiting for deadline");
+
+	int i, timedout = 0, replied = 0;
+	for (i = 0; i < 2; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0) {
+			if (reply.code == TNT_ER_TIMEOUT && reply.sync == sync)
+				timedout++;
+			if (reply.code == 0 && reply.sync == sync + 1)
+				replied++;
+		}
+		tnt_reply_free(&reply);
+	}
+	is  (timedout, 1, "Expiring request");
+	is  (replied, 1, "Replying to request without deadline");
+
+	/* late reply of expired request is skipped */
+	tnt_ping(tnt);
+	tnt_flush(tnt);
+	struct tnt_reply reply;
+	tnt_reply_init(&reply);
+	ok  (tnt->read_reply(tnt, &reply) == 0 && reply.sync == sync + 2,
+	     "Skipping late reply");
+	tnt_reply_free(&reply);
+
+	tnt_stream_free(args);
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+struct zerocopy_stat {
+	int released;
+	size_t size;
+};
+
+static void
+zerocopy_release(void *buf, size_t size, void *arg)
+{
+	(void)buf;
+	struct zerocopy_stat *stat = arg;
+	stat->released++;
+	stat->size += size;
+}
+
+static int
+test_send_zerocopy(const char *uri) {
+	plan(5);
+	header();
+
+	const char *expr = "return ...";
+	enum { len = 300000, count = 8 };
+	char *str = malloc(len);
+	for (int i = 0; i < len; ++i)
+		str[i] = 'a' + i % 26;
+	struct tnt_stream *args = tnt_object(NULL);
+	tnt_object_add_array(args, 1);
+	tnt_object_add_str(args, str, len);
+
+	/* blocking flush returns, when kernel releases payloads */
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_SEND_ZEROCOPY, 65536);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+
+	int i, ok = 0;
+	for (i = 0; i < count; ++i)
+		tnt_eval(tnt, expr, strlen(expr), args);
+	tnt_flush(tnt);
+	is  (tnt_zerocopy_pending(tnt), 0, "Checking payloads are released");
+	struct tnt_reply reply;
+	for (i = 0; i < count; ++i) {
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0)
+			ok += check_echo(&reply, str, len);
+		tnt_reply_free(&reply);
+	}
+	is  (ok, count, "Checking replies");
+	tnt_stream_free(tnt);
+
+	/* payloads are released by callback */
+	struct zerocopy_stat stat = { 0, 0 };
+	tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_SEND_ZEROCOPY, 65536);
+	tnt_set(tnt, TNT_OPT_SEND_ZEROCOPY_CB, zerocopy_release);
+	tnt_set(tnt, TNT_OPT_SEND_ZEROCOPY_CB_ARG, &stat);
+	tnt_connect(tnt);
+	for (i = 0; i < count; ++i)
+		tnt_eval(tnt, expr, strlen(expr), args);
+	tnt_flush(tnt);
+	ok = 0;
+	for (i = 0; i < count; ++i) {
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0)
+			ok += check_echo(&reply, str, len);
+		tnt_reply_free(&reply);
+	}
+	/* replies came, so data is acknowledged by peer */
+	while (tnt_zerocopy_pending(tnt) > 0) {
+		struct pollfd pfd = { tnt_fd(tnt), 0, 0 };
+		if (poll(&pfd, 1, 1000) == 0)
+			break;
+	}
+	is  (ok, count, "Checking replies with release callback");
+	ok  (stat.released == count &&
+	     stat.size == count * TNT_SBUF_SIZE(args),
+	     "Checking release callback");
+	tnt_stream_free(tnt);
+
+	tnt_stream_free(args);
+	free(str);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_low_latency(const char *uri) {
+	plan(4);
+	header();
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_LOW_LATENCY, 1);
+	struct timeval spin = { 0, 100 };
+	tnt_set(tnt, TNT_OPT_RECV_SPIN, &spin);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+	is  (TNT_SNET_CAST(tnt)->low_latency, 1, "Checking profile is applied");
+
+	/* replies are read by spinning and blocking reads */
+	int i, ok = 0;
+	for (i = 0; i < 100; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		tnt_ping(tnt);
+		tnt_flush(tnt);
+		if (tnt->read_reply(tnt, &reply) == 0 && reply.code == 0)
+			ok++;
+		tnt_reply_free(&reply);
+	}
+	is  (ok, 100, "Checking sequential replies");
+
+	/* several borrowed payloads are flushed corked */
+	const char *expr = "return ...";
+	enum { len = 100000, count = 4 };
+	char *str = malloc(len);
+	memset(str, 'x', len);
+	struct tnt_stream *args = tnt_object(NULL);
+	tnt_object_add_array(args, 1);
+	tnt_object_add_str(args, str, len);
+	tnt_set(tnt, TNT_OPT_SEND_ZEROCOPY, 65536);
+	for (i = 0; i < count; ++i)
+		tnt_eval(tnt, expr, strlen(expr), args);
+	tnt_flush(tnt);
+	ok = 0;
+	for (i = 0; i < count; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0)
+			ok += check_echo(&reply, str, len);
+		tnt_reply_free(&reply);
+	}
+	is  (ok, count, "Checking replies of corked flush");
+	tnt_stream_free(args);
+	free(str);
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+/* body of the only request in buffer stream */
+static const char *
+request_body(struct tnt_stream *buf, size_t *size)
+{
+	const char *p = TNT_SBUF_DATA(buf);
+	const char *end = p + TNT_SBUF_SIZE(buf);
+	mp_decode_uint(&p);
+	mp_next(&p);
+	*size = end - p;
+	return p;
+}
+
+static int
+test_request_prepare(const char *uri) {
+	plan(5);
+	header();
+
+	/* template encodes the same body, as plain request */
+	struct tnt_stream *key = tnt_object(NULL);
+	tnt_object_format(key, "[%s]", "_vspace");
+	struct tnt_request *req = tnt_request_select(NULL);
+	tnt_request_set_space(req, 281);
+	tnt_request_set_index(req, 2);
+	tnt_request_set_key(req, key);
+	struct tnt_stream *plain = tnt_buf(NULL);
+	struct tnt_stream *prepared = tnt_buf(NULL);
+	tnt_request_compile(plain, req);
+	is  (tnt_request_prepare(req), 0, "Preparing request");
+	tnt_request_compile(prepared, req);
+	size_t plain_size, prepared_size;
+	const char *plain_body = request_body(plain, &plain_size);
+	const char *prepared_body = request_body(prepared, &prepared_size);
+	ok  (plain_size == prepared_size &&
+	     memcmp(plain_body, prepared_body, plain_size) == 0,
+	     "Checking template body");
+	tnt_stream_free(plain);
+	tnt_stream_free(prepared);
+
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+	int i, ok = 0;
+	uint64_t sync[4];
+	for (i = 0; i < 4; ++i)
+		sync[i] = tnt_request_compile(tnt, req);
+	tnt_flush(tnt);
+	for (i = 0; i < 4; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0 && reply.code == 0 &&
+		    reply.sync == sync[i])
+			ok++;
+		tnt_reply_free(&reply);
+	}
+	is  (ok, 4, "Checking replies to prepared select");
+	tnt_request_free(req);
+
+	/* arguments are patched into prepared eval */
+	const char *expr = "return ...";
+	req = tnt_request_eval(NULL);
+	tnt_request_set_exprz(req, expr);
+	struct tnt_stream *args = tnt_object(NULL);
+	tnt_object_format(args, "[%s]", "x");
+	tnt_request_set_tuple(req, args);
+	tnt_request_prepare(req);
+	char str[16];
+	ok = 0;
+	for (i = 0; i < 10; ++i) {
+		snprintf(str, sizeof(str), "arg%d", i * 1000);
+		tnt_object_reset(args);
+		tnt_object_format(args, "[%s]", str);
+		tnt_request_set_tuple(req, args);
+		tnt_request_compile(tnt, req);
+		tnt_flush(tnt);
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0)
+			ok += check_echo(&reply, str, strlen(str));
+		tnt_reply_free(&reply);
+	}
+	is  (ok, 10, "Checking replies to prepared eval");
+	tnt_request_free(req);
+	tnt_stream_free(args);
+	tnt_stream_free(key);
+	tnt_stream_free(tnt);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_batch(const char *uri) {
+	plan(7);
+	header();
+
+	const char *names[] = { "_vspace", "_vindex", "_space", "_index",
+				"_vspace", "_vindex", "_space", "_index" };
+	struct tnt_stream *keys[8];
+	int i;
+	for (i = 0; i < 8; ++i) {
+		keys[i] = tnt_object(NULL);
+		tnt_object_format(keys[i], "[%s]", names[i]);
+	}
+
+	/* every request of batch is counted by buffer */
+	struct tnt_stream *buf = tnt_buf(NULL);
+	is  (tnt_batch(buf, TNT_OP_SELECT, 281, 2, keys, 8, NULL), 8,
+	     "Writing batch into buffer");
+	is  (buf->wrcnt, 8, "Checking requests count");
+	tnt_stream_free(buf);
+
+	/* batch is split by window, replies have consecutive syncs */
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_WINDOW, 3);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+	uint64_t sync = 0;
+	is  (tnt_batch(tnt, TNT_OP_SELECT, 281, 2, keys, 8, &sync), 8,
+	     "Writing batch");
+	tnt_flush(tnt);
+	int ok = 0;
+	for (i = 0; i < 8; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0 && reply.code == 0 &&
+		    reply.sync == sync + i)
+			ok++;
+		tnt_reply_free(&reply);
+	}
+	is  (ok, 8, "Checking replies to batch");
+	tnt_stream_free(tnt);
+	for (i = 0; i < 8; ++i)
+		tnt_stream_free(keys[i]);
+
+	/* tuple larger than send buffer is written past it */
+	enum { big = 20000 };
+	char *str = malloc(big);
+	memset(str, 'x', big);
+	struct tnt_stream *tuples[3];
+	for (i = 0; i < 3; ++i) {
+		tuples[i] = tnt_object(NULL);
+		tnt_object_add_array(tuples[i], 2);
+		tnt_object_add_int(tuples[i], i);
+		tnt_object_add_str(tuples[i], str, i == 1 ? big : 3);
+	}
+	tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_set(tnt, TNT_OPT_SEND_BUF, 16384);
+	tnt_connect(tnt);
+	is  (tnt_batch(tnt, TNT_OP_INSERT, 512, 0, tuples, 3, &sync), 3,
+	     "Writing batch with tuple larger than send buffer");
+	tnt_flush(tnt);
+	ok = 0;
+	for (i = 0; i < 3; ++i) {
+		struct tnt_reply reply;
+		tnt_reply_init(&reply);
+		if (tnt->read_reply(tnt, &reply) == 0 && reply.code == 0 &&
+		    reply.sync == sync + i &&
+		    reply.data_end - reply.data > (i == 1 ? big : 3))
+			ok++;
+		tnt_reply_free(&reply);
+	}
+	is  (ok, 3, "Checking replies to batch with large tuple");
+	tnt_stream_free(tnt);
+	for (i = 0; i < 3; ++i)
+		tnt_stream_free(tuples[i]);
+	free(str);
+
+	footer();
+	return check_plan();
+}
+
+static int buf_reallocs = 0, buf_allocs = 0;
+static void *(*buf_realloc)(void *, size_t) = NULL;
+
+static void *
+counting_realloc(void *ptr, size_t size) {
+	if (ptr != NULL && size > 0)
+		buf_reallocs++;
+	if (ptr == NULL && size > 0)
+		buf_allocs++;
+	return buf_realloc(ptr, size);
+}
+
+static int
+test_buf_reserve() {
+	plan(6);
+	header();
+
+	buf_realloc = tnt_mem_init(counting_realloc);
+	struct tnt_stream *buf = tnt_buf(NULL);
+	char data[4096];
+	memset(data, 'x', sizeof(data));
+	int i;
+	for (i = 0; i < 4096; ++i)
+		buf->write(buf, data, 16);
+	ok  (buf_reallocs <= 10, "Checking buffer grows geometrically");
+	struct tnt_stream_buf *sb = TNT_SBUF_CAST(buf);
+	ok  (sb->size == 4096 * 16 && sb->alloc < sb->size * 2,
+	     "Checking buffer size");
+
+	is  (tnt_buf_reserve(buf, sb->alloc), 0, "Reserving space");
+	buf_reallocs = 0;
+	buf->write(buf, data, sizeof(data));
+	is  (buf_reallocs, 0, "Writing into reserved space");
+	tnt_buf_shrink(buf);
+	ok  (sb->alloc == sb->size, "Shrinking buffer");
+	tnt_stream_free(buf);
+	tnt_mem_init(buf_realloc);
+
+	buf = tnt_buf_as(NULL, data, sizeof(data));
+	is  (tnt_buf_reserve(buf, 1), -1, "Reserving in immutable buffer");
+	tnt_stream_free(buf);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_object_packed() {
+	plan(3);
+	header();
+
+	/* headers of any size are expanded to the same bytes as known sizes */
+	struct tnt_stream *packed = tnt_object(NULL);
+	struct tnt_stream *simple = tnt_object(NULL);
+	tnt_object_type(packed, TNT_SBO_PACKED);
+	tnt_object_add_array(packed, 0);
+	tnt_object_add_array(simple, 300);
+	int i, j;
+	for (i = 0; i < 300; ++i) {
+		int pairs = i % 3 == 0 ? 20 : 2;
+		tnt_object_add_map(packed, 0);
+		tnt_object_add_map(simple, pairs);
+		for (j = 0; j < pairs; ++j) {
+			tnt_object_add_int(packed, j);
+			tnt_object_add_int(simple, j);
+			if (j == 1) {
+				tnt_object_add_array(packed, 0);
+				tnt_object_add_array(simple, 16);
+				for (int k = 0; k < 16; ++k) {
+					tnt_object_add_int(packed, i);
+					tnt_object_add_int(simple, i);
+				}
+				tnt_object_container_close(packed);
+				tnt_object_container_close(simple);
+			} else {
+				tnt_object_add_strz(packed, "x");
+				tnt_object_add_strz(simple, "x");
+			}
+		}
+		tnt_object_container_close(packed);
+		tnt_object_container_close(simple);
+	}
+	is  (tnt_object_container_close(packed), 0, "Closing outer array");
+	ok  (TNT_SBUF_SIZE(packed) == TNT_SBUF_SIZE(simple) &&
+	     memcmp(TNT_SBUF_DATA(packed), TNT_SBUF_DATA(simple),
+		    TNT_SBUF_SIZE(simple)) == 0, "Checking packed object");
+	is  (tnt_object_verify(packed, MP_ARRAY), 0, "Verifying packed object");
+	tnt_stream_free(packed);
+	tnt_stream_free(simple);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_format_compile() {
+	plan(7);
+	header();
+
+	const char *fmt = "[%d %u {%s%ld%.*s%llu} %lf %b NIL [%hd %lli]]";
+	struct tnt_format *f = tnt_format_compile(fmt);
+	isnt(f, NULL, "Compiling format");
+	is  (tnt_format_argc(f), 10, "Checking arguments count");
+
+	/* compiled format encodes the same bytes, as tnt_object_format */
+	struct tnt_stream *expected = tnt_object(NULL);
+	struct tnt_stream *obj = tnt_object(NULL);
+	tnt_object_format(expected, fmt, -5, 300u, "key", -70000L, 3, "abc",
+			  1ULL << 40, 0.5, 1, 12, -(1LL << 35));
+	tnt_format_encode(obj, f, -5, 300u, "key", -70000L, 3, "abc",
+			  1ULL << 40, 0.5, 1, 12, -(1LL << 35));
+	ok  (TNT_SBUF_SIZE(obj) == TNT_SBUF_SIZE(expected) &&
+	     memcmp(TNT_SBUF_DATA(obj), TNT_SBUF_DATA(expected),
+		    TNT_SBUF_SIZE(obj)) == 0, "Checking encoded object");
+
+	/* arguments may be passed in array */
+	union tnt_format_arg args[10];
+	args[0].i = -5; args[1].u = 300;
+	args[2].str.data = "key"; args[2].str.len = 3;
+	args[3].i = -70000;
+	args[4].str.data = "abc"; args[4].str.len = 3;
+	args[5].u = 1ULL << 40; args[6].d = 0.5; args[7].b = 1;
+	args[8].i = 12; args[9].i = -(1LL << 35);
+	tnt_object_reset(obj);
+	tnt_format_encode_args(obj, f, args);
+	ok  (TNT_SBUF_SIZE(obj) == TNT_SBUF_SIZE(expected) &&
+	     memcmp(TNT_SBUF_DATA(obj), TNT_SBUF_DATA(expected),
+		    TNT_SBUF_SIZE(obj)) == 0, "Checking encoding from array");
+	tnt_format_free(f);
+
+	/* values are appended into open container */
+	f = tnt_format_compile("{%s%d}");
+	tnt_object_reset(obj);
+	tnt_object_type(obj, TNT_SBO_PACKED);
+	tnt_object_add_array(obj, 0);
+	for (int i = 0; i < 20; ++i)
+		tnt_format_encode(obj, f, "id", i);
+	tnt_object_container_close(obj);
+	const char *data = TNT_SBUF_DATA(obj);
+	ok  (tnt_object_verify(obj, MP_ARRAY) == 0 &&
+	     mp_decode_array(&data) == 20, "Appending into container");
+	tnt_format_free(f);
+	tnt_stream_free(obj);
+	tnt_stream_free(expected);
+
+	is  (tnt_format_compile("[%d}"), NULL, "Unbalanced brackets");
+	is  (tnt_format_compile("[%q]"), NULL, "Unknown specifier");
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_object_inline() {
+	plan(6);
+	header();
+
+	buf_realloc = tnt_mem_init(counting_realloc);
+	buf_allocs = 0;
+	struct tnt_object_inline storage;
+	struct tnt_stream *key = tnt_object_inline(&storage);
+	tnt_object_format(key, "[%d%s{%s%u}]", 42, "name", "id", 7);
+	is  (buf_allocs, 0, "Building small key without allocations");
+	is  (tnt_object_verify(key, MP_ARRAY), 0, "Verifying small key");
+
+	/* data and stack are moved to heap, when they don't fit */
+	char str[100];
+	memset(str, 'x', sizeof(str) - 1);
+	str[sizeof(str) - 1] = 0;
+	tnt_object_reset(key);
+	tnt_object_format(key, "[%d[[[[[[%s]]]]]]]", 42, str);
+	const char *data = TNT_SBUF_DATA(key);
+	ok  (tnt_object_verify(key, MP_ARRAY) == 0 &&
+	     TNT_SBUF_SIZE(key) == 109 && mp_decode_array(&data) == 2 &&
+	     mp_decode_uint(&data) == 42, "Spilling key to heap");
+	tnt_stream_free(key);
+
+	/* request keeps key in one allocation */
+	struct tnt_request *req = tnt_request_select(NULL);
+	buf_allocs = 0;
+	tnt_request_set_key_format(req, "[%d]", 1);
+	is  (buf_allocs, 1, "Setting request key");
+	buf_allocs = 0;
+	tnt_request_set_key_format(req, "[%d]", 2);
+	is  (buf_allocs, 0, "Resetting request key");
+	data = req->key;
+	ok  (mp_decode_array(&data) == 1 && mp_decode_uint(&data) == 2 &&
+	     data == req->key_end, "Checking request key");
+	tnt_request_free(req);
+	tnt_mem_init(buf_realloc);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_update_value() {
+	plan(4);
+	header();
+
+	struct tnt_stream *old = tnt_update_container(NULL);
+	struct tnt_stream *val = tnt_object(NULL);
+	tnt_object_add_int(val, -5);
+	tnt_update_assign(old, 1, val);
+	tnt_object_reset(val);
+	tnt_object_add_str(val, "abc", 3);
+	tnt_update_insert(old, 2, val);
+	tnt_object_reset(val);
+	tnt_object_add_double(val, 1.5);
+	tnt_update_assign(old, 3, val);
+	tnt_object_reset(val);
+	tnt_object_add_bool(val, 1);
+	tnt_update_assign(old, 4, val);
+	tnt_update_arith_int(old, 5, '+', 300);
+	tnt_update_splice(old, 6, 1, 2, "xyz", 3);
+	tnt_update_delete(old, 7, 2);
+	tnt_update_container_close(old);
+	tnt_stream_free(val);
+
+	struct tnt_stream *ops = tnt_update_container(NULL);
+	tnt_buf_reserve(ops, 256);
+	buf_realloc = tnt_mem_init(counting_realloc);
+	buf_allocs = buf_reallocs = 0;
+	tnt_update_value_int(ops, 1, '=', -5);
+	tnt_update_value_str(ops, 2, '!', "abc", 3);
+	tnt_update_value_double(ops, 3, '=', 1.5);
+	tnt_update_value_raw(ops, 4, '=', "\xc3", 1);
+	tnt_update_value_uint(ops, 5, '+', 300);
+	tnt_update_splice(ops, 6, 1, 2, "xyz", 3);
+	tnt_update_delete(ops, 7, 2);
+	is  (buf_allocs + buf_reallocs, 0, "Building update ops without allocations");
+	tnt_mem_init(buf_realloc);
+	tnt_update_container_close(ops);
+	ok  (TNT_SBUF_SIZE(ops) == TNT_SBUF_SIZE(old) &&
+	     memcmp(TNT_SBUF_DATA(ops), TNT_SBUF_DATA(old),
+		    TNT_SBUF_SIZE(ops)) == 0, "Comparing with object based ops");
+	is  (tnt_object_verify(ops, MP_ARRAY), 0, "Verifying update ops");
+	is  (tnt_update_value_str(ops, 1, '#', "a", 1), -1, "Checking wrong op");
+	tnt_stream_free(ops);
+	tnt_stream_free(old);
+
+	footer();
+	return check_plan();
+}
+
+/* request/response cycle, reply is parsed from prepared buffer */
+static void
+mem_cycle(char *reply, size_t size) {
+	struct tnt_request *req = tnt_request_select(NULL);
+	tnt_request_set_key_format(req, "[%d]", 1);
+	struct tnt_stream *buf = tnt_buf(NULL);
+	tnt_request_compile(buf, req);
+	struct tnt_stream *obj = tnt_object(NULL);
+	tnt_object_format(obj, "[%d%s]", 1, "abc");
+	struct tnt_reply *r = tnt_reply_init(NULL);
+	size_t off = 0;
+	tnt_reply(r, reply, size, &off);
+	struct tnt_iter *it = tnt_iter_array(NULL, r->data, r->data_end - r->data);
+	while (tnt_next(it))
+		;
+	tnt_iter_free(it);
+	tnt_reply_free(r);
+	tnt_stream_free(obj);
+	tnt_stream_free(buf);
+	tnt_request_free(req);
+}
+
+static pthread_mutex_t mem_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t mem_pool_cond = PTHREAD_COND_INITIALIZER;
+static int mem_pool_step;
+
+/* keeps freelists enabled until the main thread tries to swap allocator */
+static void *
+mem_pool_thread_f(void *arg) {
+	(void)arg;
+	tnt_mem_pool(1 << 20);
+	struct tnt_stream *buf = tnt_buf(NULL);
+	tnt_stream_free(buf);
+	pthread_mutex_lock(&mem_pool_lock);
+	mem_pool_step = 1;
+	pthread_cond_broadcast(&mem_pool_cond);
+	while (mem_pool_step != 2)
+		pthread_cond_wait(&mem_pool_cond, &mem_pool_lock);
+	pthread_mutex_unlock(&mem_pool_lock);
+	tnt_mem_pool(0);
+	return NULL;
+}
+
+static int
+test_mem_pool() {
+	plan(8);
+	header();
+
+	char reply[64], *p = reply + 5;
+	p = mp_encode_map(p, 2);
+	p = mp_encode_uint(p, TNT_CODE);
+	p = mp_encode_uint(p, 0);
+	p = mp_encode_uint(p, TNT_SYNC);
+	p = mp_encode_uint(p, 1);
+	p = mp_encode_map(p, 1);
+	p = mp_encode_uint(p, TNT_DATA);
+	p = mp_encode_array(p, 1);
+	p = mp_encode_array(p, 2);
+	p = mp_encode_uint(p, 1);
+	p = mp_encode_str(p, "abc", 3);
+	reply[0] = (char)0xce;
+	mp_store_u32(reply + 1, p - reply - 5);
+
+	struct tnt_mem_stat st;
+	tnt_mem_stat_reset();
+	mem_cycle(reply, p - reply);
+	tnt_mem_stat(&st);
+	ok  (st.alloc > 0 && st.alloc == st.free && st.pool_cached == 0,
+	     "Allocating without freelists");
+
+	tnt_mem_pool(1 << 20);
+	mem_cycle(reply, p - reply);
+	tnt_mem_stat_reset();
+	mem_cycle(reply, p - reply);
+	tnt_mem_stat(&st);
+	ok  (st.alloc == 0 && st.realloc == 0 && st.free == 0 &&
+	     st.pool_hit > 0 && st.pool_miss == 0,
+	     "Zero allocations in steady state");
+	ok  (st.pool_cached > 0, "Keeping freed blocks");
+
+	tnt_mem_pool(256);
+	tnt_mem_stat(&st);
+	ok  (st.pool_cached <= 256, "Trimming to high water mark");
+	tnt_mem_pool(0);
+	tnt_mem_stat(&st);
+	is  (st.pool_cached, 0, "Releasing freelists");
+
+	/* reply buffer isn't rounded up to size class without freelists */
+	struct tnt_reply r;
+	tnt_reply_init(&r);
+	size_t off = 0;
+	tnt_reply(&r, reply, p - reply, &off);
+	is  (r.buf_alloc, r.buf_size, "Allocating exact size without freelists");
+	tnt_reply_free(&r);
+
+	/* blocks cached by another thread belong to current allocator */
+	pthread_t thread;
+	pthread_create(&thread, NULL, mem_pool_thread_f, NULL);
+	pthread_mutex_lock(&mem_pool_lock);
+	while (mem_pool_step != 1)
+		pthread_cond_wait(&mem_pool_cond, &mem_pool_lock);
+	pthread_mutex_unlock(&mem_pool_lock);
+	is  (tnt_mem_init(counting_realloc), NULL,
+	     "Keeping allocator while another thread caches blocks");
+	pthread_mutex_lock(&mem_pool_lock);
+	mem_pool_step = 2;
+	pthread_cond_broadcast(&mem_pool_cond);
+	pthread_mutex_unlock(&mem_pool_lock);
+	pthread_join(thread, NULL);
+	buf_realloc = tnt_mem_init(counting_realloc);
+	ok  (buf_realloc != NULL,
+	     "Changing allocator after freelists are released");
+	tnt_mem_init(buf_realloc);
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_mem_arena() {
+	plan(6);
+	header();
+
+	char reply[64], *p = reply + 5;
+	p = mp_encode_map(p, 2);
+	p = mp_encode_uint(p, TNT_CODE);
+	p = mp_encode_uint(p, 0);
+	p = mp_encode_uint(p, TNT_SYNC);
+	p = mp_encode_uint(p, 1);
+	p = mp_encode_map(p, 1);
+	p = mp_encode_uint(p, TNT_DATA);
+	p = mp_encode_array(p, 1);
+	p = mp_encode_uint(p, 42);
+	reply[0] = (char)0xce;
+	mp_store_u32(reply + 1, p - reply - 5);
+
+	struct tnt_arena arena;
+	struct tnt_mem_ctx *mem = tnt_arena_init(&arena, 1024);
+	struct tnt_mem_stat st;
+	int round, ok = 0;
+	for (round = 0; round < 3; ++round) {
+		tnt_mem_stat_reset();
+		struct tnt_stream *buf = tnt_buf(NULL);
+		tnt_stream_mem(buf, mem);
+		buf->write(buf, reply, p - reply);
+		struct tnt_stream *obj = tnt_object(NULL);
+		tnt_stream_mem(obj, mem);
+		tnt_object_format(obj, "[%d%s]", round, "abc");
+		struct tnt_reply r;
+		tnt_reply_init(&r);
+		const char *data = NULL;
+		if (buf->read_reply(buf, &r) == 0 && r.buf_mem == mem) {
+			data = r.data;
+			mp_decode_array(&data);
+		}
+		if (data && mp_decode_uint(&data) == 42 &&
+		    tnt_object_verify(obj, MP_ARRAY) == 0 &&
+		    tnt_arena_used(&arena) > 0)
+			ok++;
+		tnt_reply_free(&r);
+		tnt_stream_free(obj);
+		tnt_stream_free(buf);
+		tnt_arena_reset(&arena);
+		tnt_mem_stat(&st);
+	}
+	is  (ok, 3, "Allocating buffers and replies in arena");
+	ok  (st.alloc == st.free && st.realloc == 0,
+	     "No chunks are allocated after reset");
+	is  (tnt_arena_used(&arena), 0, "Resetting arena");
+
+	char *a = mem->realloc(mem, NULL, 100);
+	memset(a, 'a', 100);
+	char *b = mem->realloc(mem, a, 200);
+	is  (a, b, "Growing last block in place");
+	char *c = mem->realloc(mem, NULL, 4000);
+	memset(c, 'c', 4000);
+	char *d = mem->realloc(mem, b, 300);
+	ok  (c != NULL && d != b && d[0] == 'a' && d[99] == 'a',
+	     "Moving block, that isn't the last one");
+	tnt_arena_destroy(&arena);
+	is  (tnt_arena_used(&arena), 0, "Destroying arena");
+
+	footer();
+	return check_plan();
+}
+
+static int
+test_net_arena(const char *uri) {
+	plan(4);
+	header();
+
+	struct tnt_arena arena;
+	struct tnt_mem_ctx *mem = tnt_arena_init(&arena, 1024);
+	struct tnt_stream *tnt = tnt_net(NULL);
+	tnt_set(tnt, TNT_OPT_URI, uri);
+	tnt_stream_mem(tnt, mem);
+	isnt(tnt_connect(tnt), -1, "Connecting");
+	struct tnt_stream *key = tnt_object(NULL);
+	tnt_object_format(key, "[%s]", "_space");
+
+	/* replies of every round are freed by arena reset */
+	int round, i, ok = 0;
+	size_t used[4];
+	for (round = 0; round < 4; ++round) {
+		for (i = 0; i < 4; ++i)
+			tnt_select(tnt, 281, 2, UINT32_MAX, 0, TNT_ITER_EQ, key);
+		tnt_flush(tnt);
+		struct tnt_reply r[4];
+		for (i = 0; i < 4; ++i) {
+			tnt_reply_init(&r[i]);
+			if (tnt->read_reply(tnt, &r[i]) == 0 &&
+			    r[i].error == NULL && r[i].buf_mem == mem)
+				ok++;
+		}
+		used[round] = tnt_arena_used(&arena);
+		for (i = 0; i < 4; ++i)
+			tnt_reply_free(&r[i]);
+		tnt_arena_reset(&arena);
+	}
+	is  (ok, 16, "Reading replies into arena");
+	ok  (used[0] > 0 && used[1] == used[0] && used[3] == used[0],
+	     "Arena doesn't grow between rounds");
+	isnt(tnt_get_spaceno(tnt, "test", 4), -1, "Schema isn't in arena");
+	tnt_stream_free(key);
+	tnt_stream_free(tnt);
+	tnt_arena_destroy(&arena);
+
+	footer();
+	return check_plan();
+}
+
 int main() {
-	plan(11);
+	plan(37);
 
 	char uri[128] = {0};
 	snprintf(uri, 128, "test:test@%s", getenv("LISTEN"));
@@ -934,6 +2583,32 @@ int main() {
 	test_msgpack_mapa_iter();
 	test_pushes(uri);
 	test_object_format_uint(uri);
+	test_nonblock(uri);
+	test_uring(uri);
+	test_reply_zerocopy(uri);
+	test_big_reply(uri);
+	test_send_borrow(uri);
+	test_mux(uri);
+	test_expect(uri);
+	test_pool(uri);
+	test_reconnect(uri);
+	test_resolve_cache(uri);
+	test_sockbuf(uri);
+	test_autoflush(uri);
+	test_window(uri);
+	test_deadline(uri);
+	test_send_zerocopy(uri);
+	test_low_latency(uri);
+	test_request_prepare(uri);
+	test_batch(uri);
+	test_buf_reserve();
+	test_object_packed();
+	test_format_compile();
+	test_object_inline();
+	test_update_value();
+	test_mem_pool();
+	test_mem_arena();
+	test_net_arena(uri);
 
 	return check_plan();
 }
@@ -0,0 +1,138 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tarantool/tnt_mem.h>
+#include <tarantool/tnt_arena.h>
+
+#define TNT_ARENA_CHUNK 16384
+
+/* blocks are aligned by 8 and prefixed by their capacity */
+#define TNT_ARENA_ALIGN(size) (((size) + 7) & ~(size_t)7)
+#define TNT_ARENA_HDR sizeof(size_t)
+
+struct tnt_arena_chunk {
+	struct tnt_arena_chunk *next;
+	size_t size;
+	size_t used;
+	char data[];
+};
+
+static void *
+tnt_arena_alloc(struct tnt_arena *a, size_t size)
+{
+	size_t need = TNT_ARENA_HDR + TNT_ARENA_ALIGN(size);
+	struct tnt_arena_chunk *c = a->chunk;
+	if (c == NULL || c->used + need > c->size) {
+		if (c != NULL && c->next != NULL && c->next->size >= need) {
+			/* chunks after current one are free since reset */
+			c = c->next;
+			c->used = 0;
+		} else {
+			size_t csize = a->chunk_size;
+			if (csize < need)
+				csize = need;
+			struct tnt_arena_chunk *n =
+				tnt_mem_alloc(sizeof(struct tnt_arena_chunk) + csize);
+			if (n == NULL)
+				return NULL;
+			n->size = csize;
+			n->used = 0;
+			if (c == NULL) {
+				n->next = a->first;
+				a->first = n;
+			} else {
+				n->next = c->next;
+				c->next = n;
+			}
+			c = n;
+		}
+		a->chunk = c;
+	}
+	char *p = c->data + c->used + TNT_ARENA_HDR;
+	*(size_t *)(p - TNT_ARENA_HDR) = need - TNT_ARENA_HDR;
+	c->used += need;
+	a->last = p;
+	return p;
+}
+
+static void *
+tnt_arena_realloc(struct tnt_mem_ctx *ctx, void *ptr, size_t size)
+{
+	struct tnt_arena *a = (struct tnt_arena *)ctx;
+	if (ptr == NULL)
+		return size ? tnt_arena_alloc(a, size) : NULL;
+	struct tnt_arena_chunk *c = a->chunk;
+	size_t *cap = (size_t *)((char *)ptr - TNT_ARENA_HDR);
+	if (size == 0) {
+		/* only the last block can be given back */
+		if (ptr == a->last) {
+			c->used = (char *)cap - c->data;
+			a->last = NULL;
+		}
+		return NULL;
+	}
+	if (size <= *cap)
+		return ptr;
+	if (ptr == a->last) {
+		size_t need = TNT_ARENA_ALIGN(size);
+		size_t off = (char *)ptr - c->data;
+		if (off + need <= c->size) {
+			c->used = off + need;
+			*cap = need;
+			return ptr;
+		}
+	}
+	void *n = tnt_arena_alloc(a, size);
+	if (n == NULL)
+		return NULL;
+	memcpy(n, ptr, *cap);
+	return n;
+}
+
+struct tnt_mem_ctx *
+tnt_arena_init(struct tnt_arena *a, size_t chunk_size)
+{
+	a->ctx.realloc = tnt_arena_realloc;
+	a->first = NULL;
+	a->chunk = NULL;
+	a->chunk_size = chunk_size ? chunk_size : TNT_ARENA_CHUNK;
+	a->last = NULL;
+	return &a->ctx;
+}
+
+void
+tnt_arena_reset(struct tnt_arena *a)
+{
+	a->chunk = a->first;
+	if (a->chunk != NULL)
+		a->chunk->used = 0;
+	a->last = NULL;
+}
+
+void
+tnt_arena_destroy(struct tnt_arena *a)
+{
+	struct tnt_arena_chunk *c = a->first;
+	while (c != NULL) {
+		struct tnt_arena_chunk *next = c->next;
+		tnt_mem_free(c);
+		c = next;
+	}
+	a->first = NULL;
+	a->chunk = NULL;
+	a->last = NULL;
+}
+
+size_t
+tnt_arena_used(struct tnt_arena *a)
+{
+	size_t used = 0;
+	struct tnt_arena_chunk *c = a->first;
+	for (; c != NULL; c = c->next) {
+		used += c->used;
+		if (c == a->chunk)
+			break;
+	}
+	return used;
+}
@@ -0,0 +1,128 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <msgpuck.h>
+
+#include <tarantool/tnt_reply.h>
+#include <tarantool/tnt_stream.h>
+#include <tarantool/tnt_buf.h>
+#include <tarantool/tnt_object.h>
+#include <tarantool/tnt_mem.h>
+#include <tarantool/tnt_batch.h>
+
+#include "tnt_proto_internal.h"
+
+/* length prefix, header and body without tuple (key) */
+#define TNT_BATCH_OVERHEAD (5 + 16 + 64)
+
+static char *
+tnt_batch_body(char *data, enum tnt_request_t op, uint32_t space,
+	       uint32_t index)
+{
+	switch (op) {
+	case TNT_OP_INSERT:
+	case TNT_OP_REPLACE:
+		data = mp_encode_map(data, 2);
+		data = mp_encode_uint(data, TNT_SPACE);
+		data = mp_encode_uint(data, space);
+		return mp_encode_uint(data, TNT_TUPLE);
+	case TNT_OP_DELETE:
+		data = mp_encode_map(data, 3);
+		data = mp_encode_uint(data, TNT_SPACE);
+		data = mp_encode_uint(data, space);
+		data = mp_encode_uint(data, TNT_INDEX);
+		data = mp_encode_uint(data, index);
+		return mp_encode_uint(data, TNT_KEY);
+	default:
+		data = mp_encode_map(data, 6);
+		data = mp_encode_uint(data, TNT_SPACE);
+		data = mp_encode_uint(data, space);
+		data = mp_encode_uint(data, TNT_INDEX);
+		data = mp_encode_uint(data, index);
+		data = mp_encode_uint(data, TNT_LIMIT);
+		data = mp_encode_uint(data, UINT32_MAX);
+		data = mp_encode_uint(data, TNT_OFFSET);
+		data = mp_encode_uint(data, 0);
+		data = mp_encode_uint(data, TNT_ITERATOR);
+		data = mp_encode_uint(data, TNT_ITER_EQ);
+		return mp_encode_uint(data, TNT_KEY);
+	}
+}
+
+/* count of whole requests in first size bytes of batch */
+static int
+tnt_batch_count(const char *buf, size_t size)
+{
+	const char *p = buf, *end = buf + size;
+	int count = 0;
+	while (p < end) {
+		uint64_t len = mp_decode_uint(&p);
+		if ((size_t)(end - p) < len)
+			break;
+		p += len;
+		count++;
+	}
+	return count;
+}
+
+int
+tnt_batch(struct tnt_stream *s, enum tnt_request_t op, uint32_t space,
+	  uint32_t index, struct tnt_stream **items, int count,
+	  uint64_t *sync)
+{
+	if (op != TNT_OP_INSERT && op != TNT_OP_REPLACE &&
+	    op != TNT_OP_DELETE && op != TNT_OP_SELECT)
+		return -1;
+	if (count <= 0)
+		return 0;
+	size_t size = 0;
+	for (int i = 0; i < count; ++i) {
+		if (tnt_object_verify(items[i], MP_ARRAY))
+			return -1;
+		size += TNT_BATCH_OVERHEAD + TNT_SBUF_SIZE(items[i]);
+	}
+	char *buf = tnt_mem_alloc(size);
+	if (buf == NULL)
+		return -1;
+	uint64_t first = s->reqid;
+	char *data = buf;
+	for (int i = 0; i < count; ++i) {
+		char *frame = data;
+		data += 5;
+		data = mp_encode_map(data, 2);
+		data = mp_encode_uint(data, TNT_CODE);
+		data = mp_encode_uint(data, op);
+		data = mp_encode_uint(data, TNT_SYNC);
+		data = mp_encode_uint(data, s->reqid++);
+		data = tnt_batch_body(data, op, space, index);
+		memcpy(data, TNT_SBUF_DATA(items[i]), TNT_SBUF_SIZE(items[i]));
+		data += TNT_SBUF_SIZE(items[i]);
+		mp_encode_luint32(frame, data - frame - 5);
+	}
+	int written = -1;
+	if (s->write_batch != NULL) {
+		ssize_t rc = s->write_batch(s, buf, data - buf, count);
+		if (rc != -1)
+			written = tnt_batch_count(buf, rc);
+	} else {
+		const char *p = buf;
+		for (written = 0; written < count; ++written) {
+			const char *q = p;
+			uint64_t len = mp_decode_uint(&q);
+			if (s->write(s, p, q + len - p) == -1)
+				break;
+			p = q + len;
+		}
+		if (written == 0)
+			written = -1;
+	}
+	tnt_mem_free(buf);
+	if (written == -1)
+		return -1;
+	if (sync != NULL)
+		*sync = first;
+	return written;
+}
@@ -38,13 +38,27 @@
 #include <tarantool/tnt_stream.h>
 #include <tarantool/tnt_buf.h>
 
+/* first allocation of growing buffer */
+#define TNT_BUF_MIN 128
+
+/* data of size class goes to freelist, shrinked one is just freed */
+static void tnt_buf_data_free(struct tnt_stream *s) {
+	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
+	if (s->mem != NULL)
+		tnt_mem_ctx_free(s->mem, sb->data);
+	else
+		tnt_mem_pool_free_data(sb->data, sb->alloc);
+}
+
 static void tnt_buf_free(struct tnt_stream *s) {
 	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
-	if (!sb->as && sb->data)
-		tnt_mem_free(sb->data);
+	if (!sb->as && sb->data && sb->data != sb->storage)
+		tnt_buf_data_free(s);
 	if (sb->free)
 		sb->free(s);
-	tnt_mem_free(s->data);
+	/* substructure of inline buffer is caller's */
+	if (sb->storage == NULL)
+		tnt_mem_pool_free(s->data, sizeof(struct tnt_stream_buf));
 	s->data = NULL;
 }
 
@@ -63,15 +77,28 @@ tnt_buf_read(struct tnt_stream *s, char *buf, size_t size) {
 	return size;
 }
 
+/* buffer grows geometrically, so writes are amortized O(1) */
 static char* tnt_buf_resize(struct tnt_stream *s, size_t size) {
 	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
 	size_t off = sb->size;
-	size_t nsize = off + size;
-	char *nd = tnt_mem_realloc(sb->data, nsize);
-	if (nd == NULL) {
-		tnt_mem_free(sb->data);
-		return NULL;
+	if (off + size <= sb->alloc)
+		return sb->data + off;
+	size_t nsize = sb->alloc < TNT_BUF_MIN ? TNT_BUF_MIN : sb->alloc;
+	while (nsize < off + size)
+		nsize *= 2;
+	char *nd;
+	if (sb->data != NULL && sb->data == sb->storage) {
+		/* inline storage is exceeded, move to heap */
+		nd = tnt_mem_ctx_alloc(s->mem, nsize);
+		if (nd != NULL)
+			memcpy(nd, sb->data, off);
+	} else if (sb->data == NULL && s->mem == NULL) {
+		nd = tnt_mem_pool_alloc_data(nsize, &nsize);
+	} else {
+		nd = tnt_mem_ctx_realloc(s->mem, sb->data, nsize);
 	}
+	if (nd == NULL)
+		return NULL;
 	sb->data = nd;
 	sb->alloc = nsize;
 	return sb->data + off;
@@ -108,6 +135,16 @@ tnt_buf_writev(struct tnt_stream *s, struct iovec *iov, int count) {
 	return size;
 }
 
+static ssize_t
+tnt_buf_write_batch(struct tnt_stream *s, const char *buf, size_t size,
+		    int count) {
+	ssize_t rc = tnt_buf_write(s, buf, size);
+	/* every request is counted */
+	if (rc != -1)
+		s->wrcnt += count - 1;
+	return rc;
+}
+
 static int
 tnt_buf_reply(struct tnt_stream *s, struct tnt_reply *r) {
 	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
@@ -116,29 +153,21 @@ tnt_buf_reply(struct tnt_stream *s, struct tnt_reply *r) {
 	if (sb->size == sb->rdoff)
 		return 1;
 	size_t off = 0;
-	int rc = tnt_reply(r, sb->data + sb->rdoff, sb->size - sb->rdoff, &off);
+	int rc = tnt_reply_mem(r, sb->data + sb->rdoff, sb->size - sb->rdoff,
+			       &off, s->mem);
 	if (rc == 0)
 		sb->rdoff += off;
 	return rc;
 }
 
-struct tnt_stream *tnt_buf(struct tnt_stream *s) {
-	int allocated = s == NULL;
-	s = tnt_stream_init(s);
-	if (s == NULL)
-		return NULL;
-	/* allocating stream data */
-	s->data = tnt_mem_alloc(sizeof(struct tnt_stream_buf));
-	if (s->data == NULL) {
-		if (allocated)
-			tnt_stream_free(s);
-		return NULL;
-	}
+static void
+tnt_buf_setup(struct tnt_stream *s) {
 	/* initializing interfaces */
 	s->read       = tnt_buf_read;
 	s->read_reply = tnt_buf_reply;
 	s->write      = tnt_buf_write;
 	s->writev     = tnt_buf_writev;
+	s->write_batch = tnt_buf_write_batch;
 	s->free       = tnt_buf_free;
 	/* initializing internal data */
 	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
@@ -150,6 +179,37 @@ struct tnt_stream *tnt_buf(struct tnt_stream *s) {
 	sb->free    = NULL;
 	sb->subdata = NULL;
 	sb->as      = 0;
+	sb->storage = NULL;
+}
+
+struct tnt_stream *tnt_buf(struct tnt_stream *s) {
+	int allocated = s == NULL;
+	s = tnt_stream_init(s);
+	if (s == NULL)
+		return NULL;
+	/* allocating stream data */
+	s->data = tnt_mem_pool_alloc(sizeof(struct tnt_stream_buf));
+	if (s->data == NULL) {
+		if (allocated)
+			tnt_stream_free(s);
+		return NULL;
+	}
+	tnt_buf_setup(s);
+	return s;
+}
+
+struct tnt_stream *
+tnt_buf_inline(struct tnt_stream *s, struct tnt_stream_buf *sb,
+	       char *storage, size_t size)
+{
+	if (s == NULL)
+		return NULL;
+	tnt_stream_init(s);
+	s->data = sb;
+	tnt_buf_setup(s);
+	sb->data    = storage;
+	sb->alloc   = size;
+	sb->storage = storage;
 	return s;
 }
 
@@ -169,3 +229,33 @@ struct tnt_stream *tnt_buf_as(struct tnt_stream *s, char *buf, size_t buf_len)
 
 	return s;
 }
+
+int tnt_buf_reserve(struct tnt_stream *s, size_t size)
+{
+	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
+	if (sb->size + size <= sb->alloc)
+		return 0;
+	if (sb->as)
+		return -1;
+	return sb->resize(s, size) == NULL ? -1 : 0;
+}
+
+int tnt_buf_shrink(struct tnt_stream *s)
+{
+	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
+	if (sb->as || sb->alloc == sb->size || sb->data == sb->storage)
+		return 0;
+	if (sb->size == 0) {
+		tnt_buf_data_free(s);
+		sb->data = NULL;
+		sb->alloc = 0;
+		sb->rdoff = 0;
+		return 0;
+	}
+	char *nd = tnt_mem_ctx_realloc(s->mem, sb->data, sb->size);
+	if (nd == NULL)
+		return -1;
+	sb->data = nd;
+	sb->alloc = sb->size;
+	return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <tarantool/tnt_mem.h>
+#include <tarantool/tnt_proto.h>
+#include <tarantool/tnt_reply.h>
+#include <tarantool/tnt_stream.h>
+#include <tarantool/tnt_net.h>
+#include <tarantool/tnt_expect.h>
+
+#include "tnt_sync.h"
+#include "pmatomic.h"
+
+int
+tnt_expect(struct tnt_stream *s, uint64_t sync, tnt_expect_t cb, void *arg)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->expect == NULL && (sn->expect = mh_sync_new()) == NULL)
+		goto error;
+	if (tnt_sync_put(sn->expect, sync, (void *)cb, arg) == -1)
+		goto error;
+	return 0;
+error:
+	sn->error = TNT_EMEMORY;
+	return -1;
+}
+
+void
+tnt_future_init(struct tnt_future *f)
+{
+	tnt_reply_init(&f->reply);
+	f->ready = 0;
+}
+
+static void
+tnt_future_cb(struct tnt_stream *s, struct tnt_reply *r, void *arg)
+{
+	(void)s;
+	struct tnt_future *f = arg;
+	if (r->code & TNT_CHUNK)
+		return;
+	/* reply is moved into future */
+	memcpy(&f->reply, r, sizeof(struct tnt_reply));
+	f->reply.alloc = 0;
+	r->buf = NULL;
+	r->pin = NULL;
+	f->ready = 1;
+}
+
+int
+tnt_expect_future(struct tnt_stream *s, uint64_t sync, struct tnt_future *f)
+{
+	return tnt_expect(s, sync, tnt_future_cb, f);
+}
+
+int
+tnt_future_wait(struct tnt_stream *s, struct tnt_future *f)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	while (!f->ready) {
+		int rc = tnt_poll_replies(s);
+		if (rc == -1)
+			return -1;
+		if (rc == 0 && sn->opt.nonblock) {
+			sn->error = TNT_EAGAIN;
+			return -1;
+		}
+		if (rc == 0 && pm_atomic_load(&s->wrcnt) == 0) {
+			/* reply will never come */
+			sn->error = TNT_EFAIL;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+void
+tnt_future_free(struct tnt_future *f)
+{
+	tnt_reply_free(&f->reply);
+	f->ready = 0;
+}
+
+/* reply is completely received, it can be read without blocking */
+static int
+tnt_expect_buffered(struct tnt_stream_net *sn)
+{
+	struct tnt_iob *b = &sn->rbuf;
+	size_t off = 0;
+	return b->buf != NULL &&
+	       tnt_reply(NULL, b->buf + b->off, b->top - b->off, &off) == 0;
+}
+
+static void
+tnt_expect_dispatch(struct tnt_stream *s, struct tnt_reply *r)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->expect == NULL)
+		return;
+	struct tnt_sync_entry *e = tnt_sync_find(sn->expect, r->sync);
+	if (e == NULL)
+		return;
+	tnt_expect_t cb = (tnt_expect_t)e->data;
+	void *arg = e->arg;
+	/* callback may register new requests, table may be resized */
+	if ((r->code & TNT_CHUNK) == 0)
+		tnt_sync_take(sn->expect, r->sync);
+	cb(s, r, arg);
+}
+
+int
+tnt_poll_replies(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	int count = 0;
+	while (count == 0 || tnt_expect_buffered(sn)) {
+		struct tnt_reply r;
+		tnt_reply_init(&r);
+		int rc = s->read_reply(s, &r);
+		if (rc == 1)
+			break;
+		if (rc == -1) {
+			tnt_reply_free(&r);
+			if (sn->error == TNT_EAGAIN)
+				break;
+			return -1;
+		}
+		tnt_expect_dispatch(s, &r);
+		tnt_reply_free(&r);
+		count++;
+	}
+	return count;
+}
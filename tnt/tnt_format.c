@@ -0,0 +1,342 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <msgpuck.h>
+
+#include <tarantool/tnt_mem.h>
+#include <tarantool/tnt_stream.h>
+#include <tarantool/tnt_buf.h>
+#include <tarantool/tnt_object.h>
+#include <tarantool/tnt_format.h>
+
+enum tnt_format_opcode {
+	TNT_FOP_ARRAY = 0,
+	TNT_FOP_MAP,
+	TNT_FOP_NIL,
+	TNT_FOP_INT,       /* int, short, char */
+	TNT_FOP_LONG,
+	TNT_FOP_LLONG,
+	TNT_FOP_UINT,      /* unsigned int, short, char */
+	TNT_FOP_ULONG,
+	TNT_FOP_ULLONG,
+	TNT_FOP_FLOAT,
+	TNT_FOP_DOUBLE,
+	TNT_FOP_BOOL,
+	TNT_FOP_STR,       /* zero-end string */
+	TNT_FOP_STRL,      /* length and string */
+};
+
+struct tnt_format_op {
+	uint8_t  code;
+	uint32_t size; /* items of array, pairs of map */
+};
+
+struct tnt_format {
+	struct tnt_format_op *ops;
+	uint32_t count;
+	uint32_t argc;
+	uint32_t items; /* top level values */
+};
+
+/* maximal depth of containers in compiled format */
+#define TNT_FORMAT_DEPTH 64
+
+static int
+tnt_format_add(struct tnt_format *f, uint32_t *alloc, uint8_t code)
+{
+	if (f->count == *alloc) {
+		uint32_t nalloc = *alloc ? 2 * *alloc : 16;
+		struct tnt_format_op *ops = tnt_mem_realloc(f->ops,
+				nalloc * sizeof(struct tnt_format_op));
+		if (ops == NULL)
+			return -1;
+		f->ops = ops;
+		*alloc = nalloc;
+	}
+	f->ops[f->count].code = code;
+	f->ops[f->count].size = 0;
+	f->count++;
+	if (code != TNT_FOP_ARRAY && code != TNT_FOP_MAP && code != TNT_FOP_NIL)
+		f->argc++;
+	return 0;
+}
+
+/* specifier after '%', returns its length or -1 */
+static int
+tnt_format_spec(const char *f, uint8_t *code)
+{
+	static const struct {
+		const char *spec;
+		uint8_t code;
+	} specs[] = {
+		{ "d", TNT_FOP_INT }, { "i", TNT_FOP_INT },
+		{ "u", TNT_FOP_UINT }, { "s", TNT_FOP_STR },
+		{ ".*s", TNT_FOP_STRL }, { "f", TNT_FOP_FLOAT },
+		{ "lf", TNT_FOP_DOUBLE }, { "b", TNT_FOP_BOOL },
+		{ "ld", TNT_FOP_LONG }, { "li", TNT_FOP_LONG },
+		{ "lu", TNT_FOP_ULONG },
+		{ "lld", TNT_FOP_LLONG }, { "lli", TNT_FOP_LLONG },
+		{ "llu", TNT_FOP_ULLONG },
+		{ "hd", TNT_FOP_INT }, { "hi", TNT_FOP_INT },
+		{ "hu", TNT_FOP_UINT },
+		{ "hhd", TNT_FOP_INT }, { "hhi", TNT_FOP_INT },
+		{ "hhu", TNT_FOP_UINT },
+	};
+	int best = -1;
+	for (size_t i = 0; i < sizeof(specs) / sizeof(specs[0]); ++i) {
+		int len = strlen(specs[i].spec);
+		if (len > best && strncmp(f, specs[i].spec, len) == 0) {
+			best = len;
+			*code = specs[i].code;
+		}
+	}
+	return best;
+}
+
+struct tnt_format *
+tnt_format_compile(const char *fmt)
+{
+	struct tnt_format *f = tnt_mem_alloc(sizeof(struct tnt_format));
+	if (f == NULL)
+		return NULL;
+	memset(f, 0, sizeof(struct tnt_format));
+	uint32_t alloc = 0;
+	/* open containers, their items are counted in op size */
+	uint32_t stack[TNT_FORMAT_DEPTH];
+	int depth = 0;
+	for (const char *p = fmt; *p; p++) {
+		uint8_t code;
+		if (p[0] == ']' || p[0] == '}') {
+			if (depth == 0)
+				goto error;
+			struct tnt_format_op *op = &f->ops[stack[--depth]];
+			if (op->code != (p[0] == ']' ? TNT_FOP_ARRAY : TNT_FOP_MAP))
+				goto error;
+			if (op->code == TNT_FOP_MAP) {
+				if (op->size % 2)
+					goto error;
+				op->size /= 2;
+			}
+			continue;
+		} else if (p[0] == '[' || p[0] == '{') {
+			code = p[0] == '[' ? TNT_FOP_ARRAY : TNT_FOP_MAP;
+		} else if (p[0] == '%') {
+			if (p[1] == '%') {
+				p++;
+				continue;
+			}
+			int len = tnt_format_spec(p + 1, &code);
+			if (len == -1)
+				goto error;
+			p += len;
+		} else if (p[0] == 'N' && p[1] == 'I' && p[2] == 'L') {
+			code = TNT_FOP_NIL;
+			p += 2;
+		} else {
+			continue;
+		}
+		if (depth > 0)
+			f->ops[stack[depth - 1]].size++;
+		else
+			f->items++;
+		if (tnt_format_add(f, &alloc, code) == -1)
+			goto error;
+		if (code == TNT_FOP_ARRAY || code == TNT_FOP_MAP) {
+			if (depth == TNT_FORMAT_DEPTH)
+				goto error;
+			stack[depth++] = f->count - 1;
+		}
+	}
+	if (depth > 0)
+		goto error;
+	return f;
+error:
+	tnt_format_free(f);
+	return NULL;
+}
+
+void
+tnt_format_free(struct tnt_format *f)
+{
+	if (f == NULL)
+		return;
+	if (f->ops)
+		tnt_mem_free(f->ops);
+	tnt_mem_free(f);
+}
+
+uint32_t
+tnt_format_argc(const struct tnt_format *f)
+{
+	return f->argc;
+}
+
+static inline bool
+tnt_format_signed(uint8_t code)
+{
+	return code == TNT_FOP_INT || code == TNT_FOP_LONG ||
+	       code == TNT_FOP_LLONG;
+}
+
+ssize_t
+tnt_format_encode_args(struct tnt_stream *s, const struct tnt_format *f,
+		       const union tnt_format_arg *args)
+{
+	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
+	if (sb->as)
+		return -1;
+	/* exact size first, then everything is encoded in place */
+	size_t size = 0;
+	const union tnt_format_arg *arg = args;
+	const struct tnt_format_op *op = f->ops, *end = f->ops + f->count;
+	for (; op < end; op++) {
+		switch (op->code) {
+		case TNT_FOP_ARRAY:
+			size += mp_sizeof_array(op->size);
+			continue;
+		case TNT_FOP_MAP:
+			size += mp_sizeof_map(op->size);
+			continue;
+		case TNT_FOP_NIL:
+			size += mp_sizeof_nil();
+			continue;
+		case TNT_FOP_FLOAT:
+			size += mp_sizeof_float(arg->d);
+			break;
+		case TNT_FOP_DOUBLE:
+			size += mp_sizeof_double(arg->d);
+			break;
+		case TNT_FOP_BOOL:
+			size += mp_sizeof_bool(arg->b);
+			break;
+		case TNT_FOP_STR:
+		case TNT_FOP_STRL:
+			size += mp_sizeof_str(arg->str.len);
+			break;
+		default:
+			if (tnt_format_signed(op->code) && arg->i < 0)
+				size += mp_sizeof_int(arg->i);
+			else
+				size += mp_sizeof_uint(arg->u);
+			break;
+		}
+		arg++;
+	}
+	if (size == 0)
+		return 0;
+	char *data = sb->resize(s, size);
+	if (data == NULL)
+		return -1;
+	for (arg = args, op = f->ops; op < end; op++) {
+		switch (op->code) {
+		case TNT_FOP_ARRAY:
+			data = mp_encode_array(data, op->size);
+			continue;
+		case TNT_FOP_MAP:
+			data = mp_encode_map(data, op->size);
+			continue;
+		case TNT_FOP_NIL:
+			data = mp_encode_nil(data);
+			continue;
+		case TNT_FOP_FLOAT:
+			data = mp_encode_float(data, arg->d);
+			break;
+		case TNT_FOP_DOUBLE:
+			data = mp_encode_double(data, arg->d);
+			break;
+		case TNT_FOP_BOOL:
+			data = mp_encode_bool(data, arg->b != 0);
+			break;
+		case TNT_FOP_STR:
+		case TNT_FOP_STRL:
+			data = mp_encode_str(data, arg->str.data, arg->str.len);
+			break;
+		default:
+			if (tnt_format_signed(op->code) && arg->i < 0)
+				data = mp_encode_int(data, arg->i);
+			else
+				data = mp_encode_uint(data, arg->u);
+			break;
+		}
+		arg++;
+	}
+	sb->size += size;
+	s->wrcnt++;
+	/* values are items of innermost open container of object */
+	struct tnt_sbuf_object *sbo = TNT_OBJ_CAST(sb);
+	if (sbo != NULL && sbo->stack_size > 0)
+		sbo->stack[sbo->stack_size - 1].size += f->items;
+	return size;
+}
+
+ssize_t
+tnt_format_vencode(struct tnt_stream *s, const struct tnt_format *f,
+		   va_list vl)
+{
+	union tnt_format_arg local[16], *args = local;
+	if (f->argc > sizeof(local) / sizeof(local[0])) {
+		args = tnt_mem_alloc(f->argc * sizeof(union tnt_format_arg));
+		if (args == NULL)
+			return -1;
+	}
+	union tnt_format_arg *arg = args;
+	const struct tnt_format_op *op = f->ops, *end = f->ops + f->count;
+	for (; op < end; op++) {
+		switch (op->code) {
+		case TNT_FOP_ARRAY:
+		case TNT_FOP_MAP:
+		case TNT_FOP_NIL:
+			continue;
+		case TNT_FOP_INT:
+			arg->i = va_arg(vl, int);
+			break;
+		case TNT_FOP_LONG:
+			arg->i = va_arg(vl, long);
+			break;
+		case TNT_FOP_LLONG:
+			arg->i = va_arg(vl, long long);
+			break;
+		case TNT_FOP_UINT:
+			arg->u = va_arg(vl, unsigned int);
+			break;
+		case TNT_FOP_ULONG:
+			arg->u = va_arg(vl, unsigned long);
+			break;
+		case TNT_FOP_ULLONG:
+			arg->u = va_arg(vl, unsigned long long);
+			break;
+		case TNT_FOP_FLOAT:
+		case TNT_FOP_DOUBLE:
+			arg->d = va_arg(vl, double);
+			break;
+		case TNT_FOP_BOOL:
+			arg->b = va_arg(vl, int);
+			break;
+		case TNT_FOP_STR:
+			arg->str.data = va_arg(vl, const char *);
+			arg->str.len = strlen(arg->str.data);
+			break;
+		case TNT_FOP_STRL:
+			arg->str.len = va_arg(vl, uint32_t);
+			arg->str.data = va_arg(vl, const char *);
+			break;
+		}
+		arg++;
+	}
+	ssize_t rc = tnt_format_encode_args(s, f, args);
+	if (args != local)
+		tnt_mem_free(args);
+	return rc;
+}
+
+ssize_t
+tnt_format_encode(struct tnt_stream *s, const struct tnt_format *f, ...)
+{
+	va_list args;
+	va_start(args, f);
+	ssize_t res = tnt_format_vencode(s, f, args);
+	va_end(args);
+	return res;
+}
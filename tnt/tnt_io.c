@@ -40,6 +40,7 @@
 #include <stdbool.h>
 
 #include <sys/time.h>
+#include <time.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
@@ -51,41 +52,55 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#endif
 
+#include <tarantool/tnt_mem.h>
 #include <tarantool/tnt_net.h>
 #include <tarantool/tnt_io.h>
+#include <tarantool/tnt_uring.h>
 
 #include <uri.h>
 
+#include "tnt_resolve.h"
+
 #if !defined(MIN)
 #	define MIN(a, b) (a) < (b) ? (a) : (b)
 #endif /* !defined(MIN) */
 
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY) && \
+    defined(SO_EE_ORIGIN_ZEROCOPY)
+#	define TNT_IO_ZEROCOPY 1
+#endif
+
 #define TIMEVAL_TO_MSEC(tv) ((tv).tv_sec * 1000 + (tv).tv_usec / 1000)
+#define TIMEVAL_TO_USEC(tv) ((int64_t)(tv).tv_sec * 1000000 + (tv).tv_usec)
 #define TIMEVAL_DIFF_MSEC(tv1, tv2) (((tv1).tv_sec - (tv2).tv_sec) * 1000 + \
 	((tv1).tv_usec - (tv2).tv_usec) / 1000)
 
 static enum tnt_error
 tnt_io_setopts(struct tnt_stream_net *s);
 
-static enum tnt_error
-tnt_io_resolve(struct addrinfo **addr_info_p,
-	       const char *hostname, const char *port)
-{
-	struct addrinfo *addr_info = NULL;
-	struct addrinfo hints;
-	memset(&hints, 0, sizeof(hints));
-	hints.ai_socktype = SOCK_STREAM;
-	hints.ai_protocol = IPPROTO_TCP;
-	if (getaddrinfo(hostname, port, &hints, &addr_info) == 0 &&
-	    addr_info != NULL) {
-		*addr_info_p = addr_info;
-		return TNT_EOK;
-	}
-	return TNT_ERESOLVE;
+static inline int
+tnt_io_wouldblock(struct tnt_stream_net *s, int err)
+{
+	return s->opt.nonblock && (err == EAGAIN || err == EWOULDBLOCK);
 }
 
-static enum tnt_error
+/* io_uring operation, completed since stream was connected, failed */
+static inline int
+tnt_io_uring_failed(struct tnt_stream_net *s)
+{
+	if (s->uring_errno == 0)
+		return 0;
+	s->error = TNT_ESYSTEM;
+	s->errno_ = s->uring_errno;
+	return 1;
+}
+
+enum tnt_error
 tnt_io_nonblock(struct tnt_stream_net *s, int set)
 {
 	int flags = fcntl(s->fd, F_GETFL);
@@ -115,8 +130,11 @@ tnt_io_connect_do(struct tnt_stream_net *s, struct sockaddr *addr,
 		return result;
 
 	if (connect(s->fd, (struct sockaddr*)addr, addr_size) != -1)
-		return TNT_EOK;
-	if (errno == EINPROGRESS) {
+		goto done;
+	if (errno == EINPROGRESS && s->opt.nonblock) {
+		/* finished by tnt_io_connect_finish() */
+		return TNT_EAGAIN;
+	} else if (errno == EINPROGRESS) {
 		/* get start connect time */
 		struct timeval start_connect;
 		if (gettimeofday(&start_connect, NULL) == -1) {
@@ -170,6 +188,9 @@ tnt_io_connect_do(struct tnt_stream_net *s, struct sockaddr *addr,
 		return TNT_ESYSTEM;
 	}
 
+done:
+	if (s->opt.nonblock)
+		return TNT_EOK;
 	/* setting block */
 	result = tnt_io_nonblock(s, 0);
 	if (result != TNT_EOK)
@@ -177,43 +198,186 @@ tnt_io_connect_do(struct tnt_stream_net *s, struct sockaddr *addr,
 	return TNT_EOK;
 }
 
+/*
+ * Start non-blocking connect to address. Returns socket, which
+ * connection is in progress (or is established, then *connected is set),
+ * or -1.
+ */
+static int
+tnt_io_connect_start(struct tnt_stream_net *s, struct tnt_addr *addr,
+		     int *connected)
+{
+	s->fd = socket(addr->family, addr->socktype, addr->protocol);
+	if (s->fd < 0) {
+		s->errno_ = errno;
+		s->fd = -1;
+		return -1;
+	}
+	if (tnt_io_setopts(s) != TNT_EOK ||
+	    tnt_io_nonblock(s, 1) != TNT_EOK)
+		goto error;
+	*connected = connect(s->fd, (struct sockaddr *)&addr->addr,
+			     addr->len) == 0;
+	if (!*connected && errno != EINPROGRESS) {
+		s->errno_ = errno;
+		goto error;
+	}
+	int fd = s->fd;
+	s->fd = -1;
+	return fd;
+error:
+	close(s->fd);
+	s->fd = -1;
+	return -1;
+}
+
+/*
+ * Connect to all addresses concurrently (RFC 8305): next attempt is
+ * started every TNT_OPT_CONNECT_STAGGER or as soon as all started ones
+ * fail. The first established connection is kept.
+ */
 static enum tnt_error
-tnt_io_connect_tcp(struct tnt_stream_net *s, const char *host, const char *port)
+tnt_io_connect_race(struct tnt_stream_net *s, struct tnt_addr *addrs,
+		    int count)
 {
-	/* resolving address */
-	struct addrinfo *addr_info = NULL;
-	enum tnt_error result = tnt_io_resolve(&addr_info, host, port);
-	if (result != TNT_EOK)
+	struct pollfd *fds = tnt_mem_alloc(count * sizeof(struct pollfd));
+	if (fds == NULL)
+		return TNT_EMEMORY;
+	enum tnt_error result = TNT_ESYSTEM;
+	int timeout = TIMEVAL_TO_MSEC(s->opt.tmout_connect);
+	int stagger = TIMEVAL_TO_MSEC(s->opt.connect_stagger);
+	int i, nfds = 0, next = 0, next_at = 0;
+	struct timeval start, now;
+	if (gettimeofday(&start, NULL) == -1) {
+		s->errno_ = errno;
 		goto out;
+	}
+	while (s->fd == -1) {
+		if (gettimeofday(&now, NULL) == -1) {
+			s->errno_ = errno;
+			break;
+		}
+		int passed = TIMEVAL_DIFF_MSEC(now, start);
+		if (timeout > 0 && passed >= timeout) {
+			result = TNT_ETMOUT;
+			break;
+		}
+		if (next < count && (passed >= next_at || nfds == 0)) {
+			int connected = 0;
+			int fd = tnt_io_connect_start(s, &addrs[next++],
+						      &connected);
+			next_at = passed + stagger;
+			if (fd != -1 && connected)
+				s->fd = fd;
+			else if (fd != -1) {
+				fds[nfds].fd = fd;
+				fds[nfds].events = POLLOUT;
+				fds[nfds++].revents = 0;
+			}
+			continue;
+		}
+		/* all attempts failed */
+		if (nfds == 0)
+			break;
+		int wait = timeout > 0 ? timeout - passed : -1;
+		if (next < count && (wait == -1 || next_at - passed < wait))
+			wait = next_at - passed;
+		int ret = poll(fds, nfds, wait);
+		if (ret == -1 && errno != EINTR && errno != EAGAIN) {
+			s->errno_ = errno;
+			break;
+		}
+		for (i = 0; ret > 0 && i < nfds && s->fd == -1; ) {
+			if (fds[i].revents == 0) {
+				i++;
+				continue;
+			}
+			int err = 0;
+			socklen_t len = sizeof(err);
+			if (getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR,
+				       &err, &len) == -1)
+				err = errno;
+			if (err == 0)
+				s->fd = fds[i].fd;
+			else
+				close(fds[i].fd);
+			s->errno_ = err;
+			fds[i] = fds[--nfds];
+		}
+	}
+	/* attempts, that are still in progress, lose */
+	for (i = 0; i < nfds; ++i)
+		close(fds[i].fd);
+	if (s->fd != -1)
+		result = tnt_io_nonblock(s, 0);
+out:
+	tnt_mem_free(fds);
+	return result;
+}
+
+static void
+tnt_io_addrs_free(struct tnt_stream_net *s)
+{
+	tnt_mem_free(s->addrs);
+	s->addrs = NULL;
+	s->addrs_count = 0;
+	s->addrs_next = 0;
+}
 
-	struct addrinfo *addr;
-	for (addr = addr_info; addr != NULL; addr = addr->ai_next) {
-		s->fd = socket(addr->ai_family, addr->ai_socktype,
-			       addr->ai_protocol);
+/*
+ * Connect to addresses of stream one by one. Connection, that is in
+ * progress in non-blocking mode, keeps the rest of them, so that
+ * tnt_io_connect_finish() can move to the next one on failure.
+ */
+static enum tnt_error
+tnt_io_connect_next(struct tnt_stream_net *s)
+{
+	enum tnt_error result = TNT_ESYSTEM;
+	while (s->addrs_next < s->addrs_count) {
+		struct tnt_addr *addr = &s->addrs[s->addrs_next++];
+		s->fd = socket(addr->family, addr->socktype, addr->protocol);
 		if (s->fd < 0) {
 			s->errno_ = errno;
+			s->fd = -1;
 			result = TNT_ESYSTEM;
 			continue;
 		}
 		result = tnt_io_setopts(s);
-		if (result != TNT_EOK) {
-			tnt_io_close(s);
-			continue;
-		}
-		result = tnt_io_connect_do(s, addr->ai_addr, addr->ai_addrlen);
-		if (result != TNT_EOK) {
-			tnt_io_close(s);
-			continue;
-		}
-		break;
+		if (result == TNT_EOK)
+			result = tnt_io_connect_do(s,
+				(struct sockaddr *)&addr->addr, addr->len);
+		if (result == TNT_EAGAIN && s->addrs_next < s->addrs_count)
+			return result;
+		if (result == TNT_EOK || result == TNT_EAGAIN)
+			break;
+		close(s->fd);
+		s->fd = -1;
 	}
-
-out:
-	if (addr_info != NULL)
-		freeaddrinfo(addr_info);
+	tnt_io_addrs_free(s);
 	return result;
 }
 
+static enum tnt_error
+tnt_io_connect_tcp(struct tnt_stream_net *s, const char *host, const char *port)
+{
+	/* resolving address */
+	struct tnt_addr *addrs = NULL;
+	int count = tnt_resolve(host, port, s->opt.resolve_ttl, &addrs);
+	if (count == -1)
+		return TNT_ERESOLVE;
+	if (count > 1 && !s->opt.nonblock) {
+		enum tnt_error result = tnt_io_connect_race(s, addrs, count);
+		if (result != TNT_EOK)
+			tnt_io_close(s);
+		tnt_mem_free(addrs);
+		return result;
+	}
+	tnt_io_addrs_free(s);
+	s->addrs = addrs;
+	s->addrs_count = count;
+	return tnt_io_connect_next(s);
+}
+
 static enum tnt_error
 tnt_io_connect_unix(struct tnt_stream_net *s, const char *path)
 {
@@ -233,26 +397,78 @@ tnt_io_connect_unix(struct tnt_stream_net *s, const char *path)
 	memset(&addr, 0, sizeof(struct sockaddr_un));
 	addr.sun_family = AF_UNIX;
 	strcpy(addr.sun_path, path);
-	if (connect(s->fd, (struct sockaddr*)&addr, sizeof(addr)) != -1)
+	if (connect(s->fd, (struct sockaddr*)&addr, sizeof(addr)) != -1) {
+		if (s->opt.nonblock &&
+		    (result = tnt_io_nonblock(s, 1)) != TNT_EOK) {
+			tnt_io_close(s);
+			return result;
+		}
 		return TNT_EOK;
+	}
 	s->errno_ = errno;
 	tnt_io_close(s);
 	return TNT_ESYSTEM;
 }
 
-static enum tnt_error tnt_io_xbufmax(struct tnt_stream_net *s, int opt, int min) {
+/* Sizes found by TNT_SOCKBUF_PROBE_ONCE (SO_SNDBUF, SO_RCVBUF),
+ * 0 - not probed yet */
+static int tnt_io_sockbuf_max[2];
+static pthread_mutex_t tnt_io_sockbuf_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int tnt_io_xbufmax(struct tnt_stream_net *s, int opt, int min) {
 	int max = 128 * 1024 * 1024;
 	if (min == 0)
 		min = 16384;
 	unsigned int avg = 0;
+	int found = 0;
 	while (min <= max) {
 		avg = ((unsigned int)(min + max)) / 2;
-		if (setsockopt(s->fd, SOL_SOCKET, opt, &avg, sizeof(avg)) == 0)
+		s->sockbuf_calls++;
+		if (setsockopt(s->fd, SOL_SOCKET, opt, &avg, sizeof(avg)) == 0) {
+			found = avg;
 			min = avg + 1;
-		else
+		} else {
 			max = avg - 1;
+		}
 	}
-	return TNT_EOK;
+	return found;
+}
+
+static void tnt_io_xbuf(struct tnt_stream_net *s, int opt, int min, int size) {
+	int *cached = &tnt_io_sockbuf_max[opt == SO_SNDBUF ? 0 : 1];
+	switch (s->opt.sockbuf) {
+	case TNT_SOCKBUF_PROBE:
+		tnt_io_xbufmax(s, opt, min);
+		return;
+	case TNT_SOCKBUF_PROBE_ONCE:
+		pthread_mutex_lock(&tnt_io_sockbuf_lock);
+		size = *cached;
+		if (size == 0)
+			*cached = tnt_io_xbufmax(s, opt, min);
+		pthread_mutex_unlock(&tnt_io_sockbuf_lock);
+		if (size == 0)
+			return;
+		break;
+	case TNT_SOCKBUF_FIXED:
+		break;
+	default:
+		return;
+	}
+	if (size > 0) {
+		s->sockbuf_calls++;
+		setsockopt(s->fd, SOL_SOCKET, opt, &size, sizeof(size));
+	}
+}
+
+static void tnt_io_xbuf_stat(struct tnt_stream_net *s) {
+	socklen_t len = sizeof(int);
+	if (getsockopt(s->fd, SOL_SOCKET, SO_SNDBUF,
+		       &s->sockbuf_send, &len) == -1)
+		s->sockbuf_send = 0;
+	len = sizeof(int);
+	if (getsockopt(s->fd, SOL_SOCKET, SO_RCVBUF,
+		       &s->sockbuf_recv, &len) == -1)
+		s->sockbuf_recv = 0;
 }
 
 static enum tnt_error tnt_io_setopts(struct tnt_stream_net *s) {
@@ -262,8 +478,30 @@ static enum tnt_error tnt_io_setopts(struct tnt_stream_net *s) {
 			goto error;
 	}
 
-	tnt_io_xbufmax(s, SO_SNDBUF, s->opt.send_buf);
-	tnt_io_xbufmax(s, SO_RCVBUF, s->opt.recv_buf);
+	tnt_io_xbuf(s, SO_SNDBUF, s->opt.send_buf, s->opt.sockbuf_send);
+	tnt_io_xbuf(s, SO_RCVBUF, s->opt.recv_buf, s->opt.sockbuf_recv);
+
+	s->zerocopy = 0;
+#if defined(TNT_IO_ZEROCOPY)
+	/* unix sockets and send callbacks fall back to copy */
+	if (s->opt.send_zerocopy > 0 && s->opt.uri->host_hint != URI_UNIX &&
+	    s->sbuf.txv == NULL &&
+	    setsockopt(s->fd, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)) == 0)
+		s->zerocopy = 1;
+#endif
+
+	s->low_latency = 0;
+	s->busy_poll = 0;
+	if (s->opt.low_latency && s->opt.uri->host_hint != URI_UNIX) {
+		s->low_latency = 1;
+#if defined(SO_BUSY_POLL)
+		/* raising it above net.core.busy_read needs CAP_NET_ADMIN */
+		if (s->opt.busy_poll > 0 &&
+		    setsockopt(s->fd, SOL_SOCKET, SO_BUSY_POLL,
+			       &s->opt.busy_poll, sizeof(int)) == 0)
+			s->busy_poll = s->opt.busy_poll;
+#endif
+	}
 
 	if (setsockopt(s->fd, SOL_SOCKET, SO_SNDTIMEO,
 		       &s->opt.tmout_send, sizeof(s->opt.tmout_send)) == -1)
@@ -277,11 +515,29 @@ error:
 	return TNT_ESYSTEM;
 }
 
+/* registered memory has changed, after buffer was reallocated */
+static void
+tnt_io_rbuf_moved(struct tnt_stream_net *s)
+{
+	if (s->opt.uring != NULL && s->uring_buf != -1) {
+		tnt_uring_detach(s->opt.uring, s);
+		tnt_uring_attach(s->opt.uring, s);
+	}
+}
+
 enum tnt_error
 tnt_io_connect(struct tnt_stream_net *s)
 {
 	enum tnt_error result;
 	struct uri *uri = s->opt.uri;
+	/* buffers are dropped on close, if pinned memory can't be replaced */
+	char *sbuf = s->sbuf.buf, *rbuf = s->rbuf.buf;
+	if (tnt_iob_restore(&s->sbuf) == -1 ||
+	    tnt_iob_restore(&s->rbuf) == -1)
+		return TNT_EMEMORY;
+	if (s->sbuf.buf != sbuf || s->rbuf.buf != rbuf)
+		tnt_io_rbuf_moved(s);
+	s->sockbuf_calls = 0;
 	switch (uri->host_hint) {
 	case URI_NAME:
 	case URI_IPV4:
@@ -304,28 +560,532 @@ tnt_io_connect(struct tnt_stream_net *s)
 	default:
 		result = TNT_EFAIL;
 	}
+	if (s->fd >= 0)
+		tnt_io_xbuf_stat(s);
 	if (result != TNT_EOK)
 		return result;
 	s->connected = 1;
 	return TNT_EOK;
 }
 
+enum tnt_error
+tnt_io_connect_finish(struct tnt_stream_net *s)
+{
+	if (s->opt.uring != NULL && (s->uring_ops & TNT_URING_POLL))
+		return TNT_EAGAIN;
+	for (;;) {
+		struct pollfd fds[1];
+		fds[0].fd = s->fd;
+		fds[0].events = POLLOUT;
+		int ret = poll(fds, 1, 0);
+		if (ret == 0 ||
+		    (ret == -1 && (errno == EINTR || errno == EAGAIN))) {
+			if (s->opt.uring != NULL &&
+			    tnt_uring_poll(s->opt.uring, s, POLLOUT) == -1)
+				return TNT_ESYSTEM;
+			return TNT_EAGAIN;
+		}
+		if (ret == -1) {
+			s->errno_ = errno;
+			return TNT_ESYSTEM;
+		}
+		/* checking error status */
+		int opt = 0;
+		socklen_t len = sizeof(opt);
+		if (getsockopt(s->fd, SOL_SOCKET, SO_ERROR, &opt, &len) == 0 &&
+		    opt == 0)
+			break;
+		s->errno_ = (opt) ? opt : errno;
+		if (s->addrs_next >= s->addrs_count)
+			return TNT_ESYSTEM;
+		/* the next address is tried */
+		close(s->fd);
+		s->fd = -1;
+		enum tnt_error result = tnt_io_connect_next(s);
+		if (s->fd >= 0)
+			tnt_io_xbuf_stat(s);
+		if (result == TNT_EOK)
+			break;
+		if (result != TNT_EAGAIN)
+			return result;
+	}
+	tnt_io_addrs_free(s);
+	s->connected = 1;
+	return TNT_EOK;
+}
+
+/*
+ * MSG_ZEROCOPY (TNT_OPT_SEND_ZEROCOPY). Big borrowed payloads are sent by
+ * separate send(2) calls, every successful call gets the next number
+ * from kernel, and it reports ranges of completed numbers through socket
+ * error queue. TCP completes them in order, so payload is released, when
+ * zc_done reaches number of the last call, that has sent its bytes.
+ */
+
+static inline int64_t
+tnt_io_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* payload of sendq, that is sent with MSG_ZEROCOPY */
+static inline int
+tnt_io_zerocopy_payload(struct tnt_stream_net *s, int i)
+{
+	/* resent requests are borrowed from library own memory */
+	if (s->opt.send_zerocopy <= 0 || s->recovering)
+		return 0;
+	size_t size = s->sendq[i].iov_len + (i == 0 ? s->sendq_head_sent : 0);
+	return size >= (size_t)s->opt.send_zerocopy;
+}
+
+static int
+tnt_io_zerocopy_reserve(struct tnt_stream_net *s, int count)
+{
+	if (s->zc_count + count <= s->zc_size)
+		return 0;
+	int size = s->zc_size ? s->zc_size : 16;
+	while (size < s->zc_count + count)
+		size *= 2;
+	struct iovec *zc_iov = tnt_mem_realloc(s->zc_iov,
+					       size * sizeof(struct iovec));
+	if (zc_iov == NULL)
+		return -1;
+	s->zc_iov = zc_iov;
+	uint32_t *zc_need = tnt_mem_realloc(s->zc_need,
+					    size * sizeof(uint32_t));
+	if (zc_need == NULL)
+		return -1;
+	s->zc_need = zc_need;
+	s->zc_size = size;
+	return 0;
+}
+
+/* release completed payloads (all - regardless of completions) */
+static void
+tnt_io_zerocopy_release(struct tnt_stream_net *s, int all)
+{
+	zerocopy_cb_t cb = (zerocopy_cb_t)s->opt.send_zerocopy_cb;
+	int i;
+	for (i = 0; i < s->zc_count; i++) {
+		if (!all && (int32_t)(s->zc_done - s->zc_need[i]) < 0)
+			break;
+		if (cb != NULL)
+			cb(s->zc_iov[i].iov_base, s->zc_iov[i].iov_len,
+			   s->opt.send_zerocopy_cb_arg);
+	}
+	s->zc_count -= i;
+	memmove(s->zc_iov, s->zc_iov + i, s->zc_count * sizeof(struct iovec));
+	memmove(s->zc_need, s->zc_need + i, s->zc_count * sizeof(uint32_t));
+}
+
+int
+tnt_io_zerocopy_reap(struct tnt_stream_net *s)
+{
+#if defined(TNT_IO_ZEROCOPY)
+	char control[CMSG_SPACE(sizeof(struct sock_extended_err)) +
+		     CMSG_SPACE(sizeof(struct sockaddr_in6))];
+	while (s->zerocopy && s->zc_next != s->zc_done) {
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if (recvmsg(s->fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			s->error = TNT_ESYSTEM;
+			s->errno_ = errno;
+			return -1;
+		}
+		struct cmsghdr *cm;
+		for (cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+		     cm = CMSG_NXTHDR(&msg, cm)) {
+			if (!(cm->cmsg_level == SOL_IP &&
+			      cm->cmsg_type == IP_RECVERR) &&
+			    !(cm->cmsg_level == SOL_IPV6 &&
+			      cm->cmsg_type == IPV6_RECVERR))
+				continue;
+			struct sock_extended_err *ee =
+				(struct sock_extended_err *)CMSG_DATA(cm);
+			if (ee->ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+				s->error = TNT_ESYSTEM;
+				s->errno_ = ee->ee_errno;
+				return -1;
+			}
+			if (ee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				s->zc_copied++;
+			/* calls [ee_info, ee_data] are completed */
+			if ((int32_t)(ee->ee_data + 1 - s->zc_done) > 0)
+				s->zc_done = ee->ee_data + 1;
+		}
+	}
+#endif /* defined(TNT_IO_ZEROCOPY) */
+	tnt_io_zerocopy_release(s, 0);
+	return s->zc_count;
+}
+
+/* wait, until kernel releases all payloads (blocking mode) */
+static int
+tnt_io_zerocopy_wait(struct tnt_stream_net *s)
+{
+	int tmout = timerisset(&s->opt.tmout_send) ?
+		    TIMEVAL_TO_MSEC(s->opt.tmout_send) : -1;
+	while (tnt_io_zerocopy_reap(s) > 0) {
+		/* error queue isn't empty, when POLLERR is reported */
+		struct pollfd pfd = { s->fd, 0, 0 };
+		int rc = poll(&pfd, 1, tmout);
+		if (rc == 0) {
+			s->error = TNT_ETMOUT;
+			return -1;
+		}
+		if (rc == -1 && errno != EINTR) {
+			s->error = TNT_ESYSTEM;
+			s->errno_ = errno;
+			return -1;
+		}
+	}
+	return s->zc_count == 0 ? 0 : -1;
+}
+
+void
+tnt_io_sendq_drop(struct tnt_stream_net *s)
+{
+	zerocopy_cb_t cb = (zerocopy_cb_t)s->opt.send_zerocopy_cb;
+	int i;
+	for (i = 0; i < s->sendq_count && cb != NULL; i++) {
+		if (!tnt_io_zerocopy_payload(s, i))
+			continue;
+		size_t sent = i == 0 ? s->sendq_head_sent : 0;
+		cb((char *)s->sendq[i].iov_base - sent,
+		   s->sendq[i].iov_len + sent, s->opt.send_zerocopy_cb_arg);
+	}
+	s->sendq_count = 0;
+	s->sendq_head_sent = 0;
+}
+
+/* wait for MSG_ZEROCOPY completions on close, if send timeout isn't set */
+#define TNT_IO_ZEROCOPY_LINGER 1000
+
+/*
+ * Kernel reads payloads, sent with MSG_ZEROCOPY, until their completions,
+ * even after close (while data is queued or retransmitted). Completions
+ * are waited for up to send timeout. If some payloads are still in use,
+ * the connection is reset, so its send queue is dropped.
+ */
+static void
+tnt_io_zerocopy_close(struct tnt_stream_net *s)
+{
+	int64_t tmout = timerisset(&s->opt.tmout_send) ?
+			TIMEVAL_TO_MSEC(s->opt.tmout_send) :
+			TNT_IO_ZEROCOPY_LINGER;
+	int64_t deadline = tnt_io_now() + tmout * 1000;
+	/* error, that closes connection, is kept */
+	enum tnt_error error = s->error;
+	int errno_ = s->errno_;
+	while (tnt_io_zerocopy_reap(s) > 0) {
+		int left = (deadline - tnt_io_now()) / 1000;
+		if (left <= 0)
+			break;
+		/* error queue isn't empty, when POLLERR is reported */
+		struct pollfd pfd = { s->fd, 0, 0 };
+		int rc = poll(&pfd, 1, left);
+		if (rc == -1 && errno != EINTR)
+			break;
+		if (rc > 0 && !(pfd.revents & POLLERR))
+			poll(NULL, 0, 1); /* hung up, queue is being purged */
+	}
+	if (s->zc_count > 0) {
+		struct linger l = { 1, 0 };
+		setsockopt(s->fd, SOL_SOCKET, SO_LINGER, &l, sizeof(l));
+	}
+	s->error = error;
+	s->errno_ = errno_;
+}
+
 void tnt_io_close(struct tnt_stream_net *s)
 {
+	if (s->opt.uring != NULL && s->uring_ops != 0)
+		tnt_uring_cancel(s->opt.uring, s);
+	s->uring_errno = 0;
 	if (s->fd > 0) {
+		if (s->zerocopy && s->zc_count > 0)
+			tnt_io_zerocopy_close(s);
 		close(s->fd);
 		s->fd = -1;
 	}
 	s->connected = 0;
+	tnt_io_addrs_free(s);
+	/* payloads are completed or dropped with send queue */
+	tnt_io_zerocopy_release(s, 1);
+	s->zerocopy = 0;
+	s->zc_next = 0;
+	s->zc_done = 0;
+}
+
+/* drop sent bytes from send buffer and from borrowed payloads */
+static void
+tnt_io_sendq_consume(struct tnt_stream_net *s, size_t sent)
+{
+	size_t pos = 0, head_sent = 0;
+	int i;
+	for (i = 0; i < s->sendq_count; i++) {
+		size_t chunk = s->sendq_off[i] - pos;
+		if (sent < chunk)
+			break;
+		sent -= chunk;
+		pos = s->sendq_off[i];
+		struct iovec *v = &s->sendq[i];
+		if (sent < v->iov_len) {
+			v->iov_base = (char *)v->iov_base + sent;
+			v->iov_len -= sent;
+			head_sent = (i == 0 ? s->sendq_head_sent : 0) + sent;
+			sent = 0;
+			break;
+		}
+		sent -= v->iov_len;
+	}
+	if (i > 0 || head_sent > 0)
+		s->sendq_head_sent = head_sent;
+	pos += sent;
+	memmove(s->sbuf.buf, s->sbuf.buf + pos, s->sbuf.off - pos);
+	s->sbuf.off -= pos;
+	s->sendq_count -= i;
+	memmove(s->sendq, s->sendq + i, s->sendq_count * sizeof(struct iovec));
+	memmove(s->sendq_off, s->sendq_off + i,
+		s->sendq_count * sizeof(size_t));
+	for (i = 0; i < s->sendq_count; i++)
+		s->sendq_off[i] -= pos;
+}
+
+/* send buffer, interleaved with borrowed payloads, by writev(2) */
+static ssize_t
+tnt_io_sendq_flush(struct tnt_stream_net *s)
+{
+	struct iovec *v = s->sendq_vec;
+	int count = 0, i;
+	size_t pos = 0;
+	for (i = 0; i < s->sendq_count; i++) {
+		if (s->sendq_off[i] > pos) {
+			v[count].iov_base = s->sbuf.buf + pos;
+			v[count++].iov_len = s->sendq_off[i] - pos;
+			pos = s->sendq_off[i];
+		}
+		v[count++] = s->sendq[i];
+	}
+	if (s->sbuf.off > pos) {
+		v[count].iov_base = s->sbuf.buf + pos;
+		v[count++].iov_len = s->sbuf.off - pos;
+	}
+	ssize_t rc = tnt_io_sendv_raw(s, v, count, 1);
+	if (rc == -1)
+		return -1;
+	tnt_io_sendq_consume(s, rc);
+	return rc;
+}
+
+/* send payload, falls back to copy without MSG_ZEROCOPY support */
+static ssize_t
+tnt_io_send_zerocopy(struct tnt_stream_net *s, const char *buf, size_t size)
+{
+	if (!s->zerocopy) {
+		struct iovec v = { (void *)buf, size };
+		return tnt_io_sendv_raw(s, &v, 1, 1);
+	}
+	size_t off = 0;
+#if defined(TNT_IO_ZEROCOPY)
+	int flags = MSG_ZEROCOPY;
+	do {
+		ssize_t r;
+		do {
+			r = send(s->fd, buf + off, size - off, flags);
+		} while (r == -1 && (errno == EINTR));
+		if (r == -1 && errno == ENOBUFS && flags != 0) {
+			/* socket is out of memory for notifications */
+			flags = 0;
+			continue;
+		}
+		if (r == -1 && tnt_io_wouldblock(s, errno)) {
+			if (off > 0)
+				break;
+			s->error = TNT_EAGAIN;
+			return -1;
+		}
+		if (r <= 0) {
+			s->error = TNT_ESYSTEM;
+			s->errno_ = errno;
+			return -1;
+		}
+		if (flags != 0) {
+			s->zc_next++;
+			s->zc_bytes += r;
+		}
+		off += r;
+	} while (off != size);
+#endif /* defined(TNT_IO_ZEROCOPY) */
+	return off;
+}
+
+/*
+ * Send buffer, interleaved with borrowed payloads, when MSG_ZEROCOPY is
+ * enabled. Copied parts are written by writev(2), they mustn't be pinned
+ * by kernel, as send buffer is reused right away, big payloads are sent
+ * by their own send(2) calls.
+ */
+static ssize_t
+tnt_io_sendq_flush_zerocopy(struct tnt_stream_net *s)
+{
+	if (tnt_io_zerocopy_reserve(s, s->sendq_count) == -1) {
+		s->error = TNT_EMEMORY;
+		return -1;
+	}
+	struct iovec *v = s->sendq_vec;
+	int count = 0, i;
+	size_t pos = 0, size = 0, total = 0;
+	ssize_t rc = 0;
+	for (i = 0; i <= s->sendq_count; i++) {
+		size_t end = i < s->sendq_count ? s->sendq_off[i] : s->sbuf.off;
+		if (end > pos) {
+			v[count].iov_base = s->sbuf.buf + pos;
+			v[count++].iov_len = end - pos;
+			size += end - pos;
+			pos = end;
+		}
+		if (i < s->sendq_count && !tnt_io_zerocopy_payload(s, i)) {
+			v[count++] = s->sendq[i];
+			size += s->sendq[i].iov_len;
+			continue;
+		}
+		if (count > 0) {
+			rc = tnt_io_sendv_raw(s, v, count, 1);
+			if (rc == -1)
+				break;
+			total += rc;
+			if ((size_t)rc < size)
+				break;
+			count = 0;
+			size = 0;
+		}
+		if (i == s->sendq_count)
+			break;
+		struct iovec *p = &s->sendq[i];
+		rc = tnt_io_send_zerocopy(s, p->iov_base, p->iov_len);
+		if (rc == -1)
+			break;
+		total += rc;
+		if ((size_t)rc < p->iov_len)
+			break;
+		size_t sent = i == 0 ? s->sendq_head_sent : 0;
+		s->zc_iov[s->zc_count].iov_base = (char *)p->iov_base - sent;
+		s->zc_iov[s->zc_count].iov_len = p->iov_len + sent;
+		s->zc_need[s->zc_count++] = s->zc_next;
+	}
+	tnt_io_sendq_consume(s, total);
+	/* payloads, sent by copy, are released right away */
+	tnt_io_zerocopy_release(s, 0);
+	if (rc == -1 && (total == 0 || s->error != TNT_EAGAIN))
+		return -1;
+	return total;
+}
+
+/*
+ * Low latency profile (TNT_OPT_LOW_LATENCY). Delayed acks are switched
+ * off again after every read, as kernel drops TCP_QUICKACK by itself.
+ * A flush, that takes several send calls, is corked, so only full
+ * segments leave, until the last call is done.
+ */
+
+static inline void
+tnt_io_quickack(struct tnt_stream_net *s)
+{
+#if defined(TCP_QUICKACK)
+	int opt = 1;
+	setsockopt(s->fd, IPPROTO_TCP, TCP_QUICKACK, &opt, sizeof(opt));
+#else
+	(void)s;
+#endif
+}
+
+static inline int
+tnt_io_cork_flush(struct tnt_stream_net *s)
+{
+#if defined(TCP_CORK)
+	/* payloads are sent apart or don't fit into one writev */
+	return s->low_latency && s->sendq_count > 0 &&
+	       (s->opt.send_zerocopy > 0 ||
+		2 * s->sendq_count + 1 > getiovmax());
+#else
+	(void)s;
+	return 0;
+#endif
+}
+
+static inline void
+tnt_io_cork(struct tnt_stream_net *s, int set)
+{
+#if defined(TCP_CORK)
+	setsockopt(s->fd, IPPROTO_TCP, TCP_CORK, &set, sizeof(set));
+#else
+	(void)s;
+	(void)set;
+#endif
+}
+
+/* spin on non-blocking socket, then block (TNT_OPT_RECV_SPIN) */
+static ssize_t
+tnt_io_recv_spin(struct tnt_stream_net *s, char *buf, size_t size)
+{
+	int64_t deadline = tnt_io_now() + TIMEVAL_TO_USEC(s->opt.recv_spin);
+	do {
+		ssize_t r = recv(s->fd, buf, size, MSG_DONTWAIT);
+		if (r != -1 || (errno != EAGAIN && errno != EWOULDBLOCK &&
+				errno != EINTR))
+			return r;
+	} while (tnt_io_now() < deadline);
+	return recv(s->fd, buf, size, 0);
 }
 
 ssize_t tnt_io_flush(struct tnt_stream_net *s) {
+	s->flush_pending = 0;
+	if (s->opt.uring != NULL) {
+		/* sbuf is shifted, when completion is processed */
+		if (tnt_io_uring_failed(s) ||
+		    tnt_uring_send(s->opt.uring, s) == -1)
+			return -1;
+		return 0;
+	}
+	if (s->opt.send_zerocopy > 0 && s->zc_count > 0 &&
+	    tnt_io_zerocopy_reap(s) == -1)
+		return -1;
+	if (s->sendq_count > 0) {
+		int cork = tnt_io_cork_flush(s);
+		if (cork)
+			tnt_io_cork(s, 1);
+		ssize_t rc = s->opt.send_zerocopy > 0 ?
+			     tnt_io_sendq_flush_zerocopy(s) :
+			     tnt_io_sendq_flush(s);
+		if (cork)
+			tnt_io_cork(s, 0);
+		/* without callback borrowed memory is kept by caller until
+		 * flush returns */
+		if (rc != -1 && s->opt.send_zerocopy > 0 && !s->opt.nonblock &&
+		    s->opt.send_zerocopy_cb == NULL &&
+		    tnt_io_zerocopy_wait(s) == -1)
+			return -1;
+		return rc;
+	}
 	if (s->sbuf.off == 0)
 		return 0;
 	ssize_t rc = tnt_io_send_raw(s, s->sbuf.buf, s->sbuf.off, 1);
 	if (rc == -1)
 		return -1;
-	s->sbuf.off = 0;
+	/* non-blocking socket may accept only a part of buffer */
+	if ((size_t)rc < s->sbuf.off)
+		memmove(s->sbuf.buf, s->sbuf.buf + rc, s->sbuf.off - rc);
+	s->sbuf.off -= rc;
 	return rc;
 }
 
@@ -342,6 +1102,12 @@ tnt_io_send_raw(struct tnt_stream_net *s, const char *buf, size_t size, int all)
 				r = send(s->fd, buf + off, size - off, 0);
 			} while (r == -1 && (errno == EINTR));
 		}
+		if (r == -1 && tnt_io_wouldblock(s, errno)) {
+			if (off > 0)
+				break;
+			s->error = TNT_EAGAIN;
+			return -1;
+		}
 		if (r <= 0) {
 			s->error = TNT_ESYSTEM;
 			s->errno_ = errno;
@@ -362,9 +1128,15 @@ tnt_io_sendv_raw(struct tnt_stream_net *s, struct iovec *iov, int count, int all
 			r = s->sbuf.txv(&s->sbuf, iov, MIN(count, getiovmax()));
 		} else {
 			do {
-				r = writev(s->fd, iov, count);
+				r = writev(s->fd, iov, MIN(count, getiovmax()));
 			} while (r == -1 && (errno == EINTR));
 		}
+		if (r == -1 && tnt_io_wouldblock(s, errno)) {
+			if (total > 0)
+				break;
+			s->error = TNT_EAGAIN;
+			return -1;
+		}
 		if (r <= 0) {
 			s->error = TNT_ESYSTEM;
 			s->errno_ = errno;
@@ -388,26 +1160,52 @@ tnt_io_sendv_raw(struct tnt_stream_net *s, struct iovec *iov, int count, int all
 	return total;
 }
 
-ssize_t
-tnt_io_send(struct tnt_stream_net *s, const char *buf, size_t size)
+/*
+ * Headers, that are encoded by requests, live on stack and are always
+ * copied, only payloads of at least this size are borrowed.
+ */
+#define TNT_IO_BORROW_MIN 128
+
+static inline int
+tnt_io_borrow(struct tnt_stream_net *s, size_t size)
 {
-	if (s->sbuf.buf == NULL)
-		return tnt_io_send_raw(s, buf, size, 1);
-	if (size > s->sbuf.size) {
-		s->error = TNT_EBIG;
+	/* io_uring and plain send callback work with send buffer only */
+	if (s->opt.uring != NULL || (s->sbuf.tx != NULL && s->sbuf.txv == NULL))
+		return 0;
+	if (size < TNT_IO_BORROW_MIN)
+		return 0;
+	return (s->opt.send_borrow > 0 &&
+		size >= (size_t)s->opt.send_borrow) ||
+	       (s->opt.send_zerocopy > 0 &&
+		size >= (size_t)s->opt.send_zerocopy);
+}
+
+static int
+tnt_io_sendq_reserve(struct tnt_stream_net *s, int count)
+{
+	if (s->sendq_count + count <= s->sendq_size)
+		return 0;
+	int size = s->sendq_size ? s->sendq_size : 16;
+	while (size < s->sendq_count + count)
+		size *= 2;
+	struct iovec *sendq = tnt_mem_realloc(s->sendq,
+					      size * sizeof(struct iovec));
+	if (sendq == NULL)
 		return -1;
-	}
-	if ((s->sbuf.off + size) <= s->sbuf.size) {
-		memcpy(s->sbuf.buf + s->sbuf.off, buf, size);
-		s->sbuf.off += size;
-		return size;
-	}
-	ssize_t r = tnt_io_send_raw(s, s->sbuf.buf, s->sbuf.off, 1);
-	if (r == -1)
+	s->sendq = sendq;
+	size_t *sendq_off = tnt_mem_realloc(s->sendq_off,
+					    size * sizeof(size_t));
+	if (sendq_off == NULL)
 		return -1;
-	s->sbuf.off = size;
-	memcpy(s->sbuf.buf, buf, size);
-	return size;
+	s->sendq_off = sendq_off;
+	/* every payload may be surrounded by send buffer parts */
+	struct iovec *sendq_vec = tnt_mem_realloc(s->sendq_vec,
+		(2 * size + 1) * sizeof(struct iovec));
+	if (sendq_vec == NULL)
+		return -1;
+	s->sendq_vec = sendq_vec;
+	s->sendq_size = size;
+	return 0;
 }
 
 inline static void
@@ -421,29 +1219,111 @@ tnt_io_sendv_put(struct tnt_stream_net *s, struct iovec *iov, int count) {
 	}
 }
 
+/*
+ * Data, that doesn't fit into send buffer, is written to socket right
+ * after the buffer, parts that fit are still copied. Blocking mode only,
+ * in non-blocking mode unsent rest would have nowhere to be kept.
+ */
+static ssize_t
+tnt_io_sendv_direct(struct tnt_stream_net *s, struct iovec *iov, int count)
+{
+	if (s->opt.nonblock) {
+		s->error = TNT_EBIG;
+		return -1;
+	}
+	size_t total = 0;
+	int i;
+	for (i = 0; i < count; i++) {
+		if (s->sbuf.off + iov[i].iov_len <= s->sbuf.size) {
+			tnt_io_sendv_put(s, &iov[i], 1);
+		} else {
+			if (tnt_io_flush(s) == -1 ||
+			    tnt_io_send_raw(s, iov[i].iov_base,
+					    iov[i].iov_len, 1) == -1)
+				return -1;
+		}
+		total += iov[i].iov_len;
+	}
+	return total;
+}
+
+ssize_t
+tnt_io_send(struct tnt_stream_net *s, const char *buf, size_t size)
+{
+	if (s->sbuf.buf == NULL)
+		return tnt_io_send_raw(s, buf, size, 1);
+	if (tnt_io_borrow(s, size)) {
+		struct iovec iov = { (void *)buf, size };
+		return tnt_io_sendv(s, &iov, 1);
+	}
+	return tnt_io_send_copy(s, buf, size);
+}
+
+ssize_t
+tnt_io_send_copy(struct tnt_stream_net *s, const char *buf, size_t size)
+{
+	if (s->sbuf.buf == NULL)
+		return tnt_io_send_raw(s, buf, size, 1);
+	if (size > s->sbuf.size) {
+		struct iovec iov = { (void *)buf, size };
+		return tnt_io_sendv_direct(s, &iov, 1);
+	}
+	if ((s->sbuf.off + size) > s->sbuf.size) {
+		if (tnt_io_flush(s) == -1)
+			return -1;
+		if ((s->sbuf.off + size) > s->sbuf.size) {
+			s->error = TNT_EAGAIN;
+			return -1;
+		}
+	}
+	memcpy(s->sbuf.buf + s->sbuf.off, buf, size);
+	s->sbuf.off += size;
+	return size;
+}
+
 ssize_t
 tnt_io_sendv(struct tnt_stream_net *s, struct iovec *iov, int count)
 {
 	if (s->sbuf.buf == NULL)
 		return tnt_io_sendv_raw(s, iov, count, 1);
-	size_t size = 0;
-	int i;
-	for (i = 0 ; i < count ; i++)
-		size += iov[i].iov_len;
-	if (size > s->sbuf.size) {
-		s->error = TNT_EBIG;
-		return -1;
+	size_t size = 0, borrowed = 0;
+	int i, nborrowed = 0;
+	for (i = 0 ; i < count ; i++) {
+		if (tnt_io_borrow(s, iov[i].iov_len)) {
+			borrowed += iov[i].iov_len;
+			nborrowed++;
+		} else {
+			size += iov[i].iov_len;
+		}
+	}
+	/* only copied part has to fit into send buffer */
+	if (size > s->sbuf.size)
+		return tnt_io_sendv_direct(s, iov, count);
+	if ((s->sbuf.off + size) > s->sbuf.size) {
+		if (tnt_io_flush(s) == -1)
+			return -1;
+		if ((s->sbuf.off + size) > s->sbuf.size) {
+			s->error = TNT_EAGAIN;
+			return -1;
+		}
 	}
-	if ((s->sbuf.off + size) <= s->sbuf.size) {
+	if (nborrowed == 0) {
 		tnt_io_sendv_put(s, iov, count);
 		return size;
 	}
-	ssize_t r = tnt_io_send_raw(s, s->sbuf.buf, s->sbuf.off, 1);
-	if (r == -1)
+	if (tnt_io_sendq_reserve(s, nborrowed) == -1) {
+		s->error = TNT_EMEMORY;
 		return -1;
-	s->sbuf.off = 0;
-	tnt_io_sendv_put(s, iov, count);
-	return size;
+	}
+	for (i = 0 ; i < count ; i++) {
+		if (!tnt_io_borrow(s, iov[i].iov_len)) {
+			tnt_io_sendv_put(s, &iov[i], 1);
+			continue;
+		}
+		s->sendq[s->sendq_count] = iov[i];
+		s->sendq_off[s->sendq_count++] = s->sbuf.off;
+	}
+	return size + borrowed;
 }
 
 ssize_t
@@ -456,8 +1336,22 @@ tnt_io_recv_raw(struct tnt_stream_net *s, char *buf, size_t size, int all)
 			r = s->rbuf.tx(&s->rbuf, buf + off, size - off);
 		} else {
 			do {
-				r = recv(s->fd, buf + off, size - off, 0);
+				if (timerisset(&s->opt.recv_spin) &&
+				    !s->opt.nonblock)
+					r = tnt_io_recv_spin(s, buf + off,
+							     size - off);
+				else
+					r = recv(s->fd, buf + off, size - off,
+						 0);
 			} while (r == -1 && (errno == EINTR));
+			if (r > 0 && s->low_latency)
+				tnt_io_quickack(s);
+		}
+		if (r == -1 && tnt_io_wouldblock(s, errno)) {
+			if (off > 0)
+				break;
+			s->error = TNT_EAGAIN;
+			return -1;
 		}
 		if (r <= 0) {
 			s->error = TNT_ESYSTEM;
@@ -469,43 +1363,93 @@ tnt_io_recv_raw(struct tnt_stream_net *s, char *buf, size_t size, int all)
 	return off;
 }
 
-ssize_t
-tnt_io_recv(struct tnt_stream_net *s, char *buf, size_t size)
+static size_t
+tnt_io_rbuf_max(struct tnt_stream_net *s)
 {
-	if (s->rbuf.buf == NULL)
-		return tnt_io_recv_raw(s, buf, size, 1);
-	size_t lv, rv, off = 0, left = size;
-	while (1) {
-		if ((s->rbuf.off + left) <= s->rbuf.top) {
-			memcpy(buf + off, s->rbuf.buf + s->rbuf.off, left);
-			s->rbuf.off += left;
-			return size;
-		}
+	size_t max = s->opt.recv_buf_max;
+	return max > s->rbuf.size ? max : s->rbuf.size;
+}
 
-		lv = s->rbuf.top - s->rbuf.off;
-		rv = left - lv;
-		if (lv) {
-			memcpy(buf + off, s->rbuf.buf + s->rbuf.off, lv);
-			off += lv;
+ssize_t
+tnt_io_recv_fill(struct tnt_stream_net *s, size_t size)
+{
+	struct tnt_iob *b = &s->rbuf;
+	if (s->opt.uring != NULL) {
+		if (tnt_io_uring_failed(s))
+			return -1;
+		/* buffer tail is owned by kernel */
+		if (s->uring_ops & TNT_URING_RECV) {
+			s->error = TNT_EAGAIN;
+			return -1;
 		}
-
-		s->rbuf.off = 0;
-		ssize_t top = tnt_io_recv_raw(s, s->rbuf.buf, s->rbuf.size, 0);
-		if (top <= 0) {
-			s->errno_ = errno;
-			s->error = TNT_ESYSTEM;
+	}
+	if (size > tnt_io_rbuf_max(s)) {
+		s->error = TNT_EBIG;
+		return -1;
+	}
+	size_t unread = b->top - b->off;
+	if (size <= unread)
+		size = unread + 1;
+	char *buf = b->buf;
+	if (unread == 0 && b->size > (size_t)s->opt.recv_buf &&
+	    size <= (size_t)s->opt.recv_buf) {
+		/* buffer was grown for a big reply, give memory back */
+		b->off = b->top = 0;
+		if (tnt_iob_resize(b, s->opt.recv_buf) == -1) {
+			s->error = TNT_EMEMORY;
 			return -1;
 		}
+	} else if (!tnt_iob_pinned(b) && b->off > 0) {
+		/* move unread data to the beginning of buffer */
+		memmove(b->buf, b->buf + b->off, unread);
+		b->top = unread;
+		b->off = 0;
+	}
+	/* replies, pointing into pinned buffer, aren't moved */
+	if (tnt_iob_reserve(b, size, tnt_io_rbuf_max(s)) == -1) {
+		s->error = TNT_EMEMORY;
+		return -1;
+	}
+	if (b->buf != buf)
+		tnt_io_rbuf_moved(s);
+	if (s->opt.uring != NULL) {
+		if (tnt_uring_recv(s->opt.uring, s) == -1)
+			return -1;
+		s->error = TNT_EAGAIN;
+		return -1;
+	}
+	/* read everything, socket has, at once */
+	ssize_t r = tnt_io_recv_raw(s, b->buf + b->top, b->size - b->top, 0);
+	if (r == -1)
+		return -1;
+	b->top += r;
+	return r;
+}
 
-		s->rbuf.top = top;
-		if (rv <= s->rbuf.top) {
-			memcpy(buf + off, s->rbuf.buf, rv);
-			s->rbuf.off = rv;
-			return size;
-		}
-		left -= lv;
+ssize_t
+tnt_io_recv(struct tnt_stream_net *s, char *buf, size_t size)
+{
+	if (s->rbuf.buf == NULL)
+		return tnt_io_recv_raw(s, buf, size, 1);
+	struct tnt_iob *b = &s->rbuf;
+	/* nothing is consumed, until whole chunk is here */
+	while (b->top - b->off < size) {
+		if (tnt_io_recv_fill(s, size) != -1)
+			continue;
+		if (s->error != TNT_EBIG || s->opt.nonblock)
+			return -1;
+		/* chunk is bigger, than buffer may grow, read it directly */
+		size_t lv = b->top - b->off;
+		memcpy(buf, b->buf + b->off, lv);
+		b->off = b->top;
+		s->error = TNT_EOK;
+		if (tnt_io_recv_raw(s, buf + lv, size - lv, 1) == -1)
+			return -1;
+		return size;
 	}
-	return -1;
+	memcpy(buf, b->buf + b->off, size);
+	b->off += size;
+	return size;
 }
 
 int getiovmax()
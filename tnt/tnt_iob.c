@@ -39,6 +39,19 @@
 #include <tarantool/tnt_mem.h>
 #include <tarantool/tnt_iob.h>
 
+#include "pmatomic.h"
+
+static char *
+tnt_iob_alloc(size_t size)
+{
+	struct tnt_iob_chunk *chunk =
+		tnt_mem_alloc(sizeof(struct tnt_iob_chunk) + size);
+	if (chunk == NULL)
+		return NULL;
+	chunk->refs = 1;
+	return chunk->data;
+}
+
 int
 tnt_iob_init(struct tnt_iob *iob, size_t size,
 	     tnt_iob_tx_t tx,
@@ -52,7 +65,7 @@ tnt_iob_init(struct tnt_iob *iob, size_t size,
 	iob->top = 0;
 	iob->buf = NULL;
 	if (size > 0) {
-		iob->buf = tnt_mem_alloc(size);
+		iob->buf = tnt_iob_alloc(size);
 		if (iob->buf == NULL)
 			return -1;
 		memset(iob->buf, 0, size);
@@ -65,11 +78,105 @@ tnt_iob_clear(struct tnt_iob *iob)
 {
 	iob->top = 0;
 	iob->off = 0;
+	/* pinned replies must survive reuse of buffer */
+	if (tnt_iob_unshare(iob) == 0)
+		return;
+	/* memory is left to replies, tnt_iob_restore() allocates new one */
+	tnt_iob_unpin(TNT_IOB_CHUNK(iob->buf));
+	iob->buf = NULL;
+}
+
+int
+tnt_iob_restore(struct tnt_iob *iob)
+{
+	if (iob->buf != NULL || iob->size == 0)
+		return 0;
+	iob->buf = tnt_iob_alloc(iob->size);
+	return iob->buf == NULL ? -1 : 0;
 }
 
 void
 tnt_iob_free(struct tnt_iob *iob)
 {
 	if (iob->buf)
-		tnt_mem_free(iob->buf);
+		tnt_iob_unpin(TNT_IOB_CHUNK(iob->buf));
+	iob->buf = NULL;
+}
+
+struct tnt_iob_chunk *
+tnt_iob_pin(struct tnt_iob *iob)
+{
+	struct tnt_iob_chunk *chunk = TNT_IOB_CHUNK(iob->buf);
+	pm_atomic_fetch_add(&chunk->refs, 1);
+	return chunk;
+}
+
+void
+tnt_iob_unpin(struct tnt_iob_chunk *chunk)
+{
+	if (pm_atomic_fetch_sub(&chunk->refs, 1) == 1)
+		tnt_mem_free(chunk);
+}
+
+int
+tnt_iob_pinned(struct tnt_iob *iob)
+{
+	return iob->buf != NULL &&
+	       pm_atomic_load(&TNT_IOB_CHUNK(iob->buf)->refs) > 1;
+}
+
+int
+tnt_iob_resize(struct tnt_iob *iob, size_t size)
+{
+	size_t unread = iob->top - iob->off;
+	if (!tnt_iob_pinned(iob) && iob->off == 0) {
+		/* nobody else looks into memory, it may be moved */
+		struct tnt_iob_chunk *chunk = tnt_mem_realloc(
+			TNT_IOB_CHUNK(iob->buf),
+			sizeof(struct tnt_iob_chunk) + size);
+		if (chunk == NULL)
+			return -1;
+		iob->buf = chunk->data;
+		iob->size = size;
+		return 0;
+	}
+	char *buf = tnt_iob_alloc(size);
+	if (buf == NULL)
+		return -1;
+	memcpy(buf, iob->buf + iob->off, unread);
+	tnt_iob_unpin(TNT_IOB_CHUNK(iob->buf));
+	iob->buf = buf;
+	iob->size = size;
+	iob->off = 0;
+	iob->top = unread;
+	return 0;
+}
+
+int
+tnt_iob_reserve(struct tnt_iob *iob, size_t size, size_t max)
+{
+	if (iob->off + size <= iob->size)
+		return 0;
+	if (size <= iob->size && !tnt_iob_pinned(iob)) {
+		memmove(iob->buf, iob->buf + iob->off, iob->top - iob->off);
+		iob->top -= iob->off;
+		iob->off = 0;
+		return 0;
+	}
+	size_t new_size = iob->size;
+	while (new_size < size)
+		new_size *= 2;
+	if (new_size > max)
+		new_size = max;
+	if (new_size < size)
+		return -1;
+	return tnt_iob_resize(iob, new_size);
+}
+
+int
+tnt_iob_unshare(struct tnt_iob *iob)
+{
+	if (!tnt_iob_pinned(iob))
+		return 0;
+	return tnt_iob_resize(iob, iob->size);
 }
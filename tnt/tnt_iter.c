@@ -44,7 +44,7 @@
 static struct tnt_iter *tnt_iter_init(struct tnt_iter *i) {
 	int alloc = (i == NULL);
 	if (alloc) {
-		i = tnt_mem_alloc(sizeof(struct tnt_iter));
+		i = tnt_mem_pool_alloc(sizeof(struct tnt_iter));
 		if (i == NULL)
 			return NULL;
 	}
@@ -279,7 +279,7 @@ void tnt_iter_free(struct tnt_iter *i) {
 	if (i->free)
 		i->free(i);
 	if (i->alloc)
-		tnt_mem_free(i);
+		tnt_mem_pool_free(i, sizeof(struct tnt_iter));
 }
 
 int tnt_next(struct tnt_iter *i) {
@@ -30,10 +30,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <string.h>
 
 #include <tarantool/tnt_mem.h>
 
+#include "pmatomic.h"
+
 static void *custom_realloc(void *ptr, size_t size) {
 	if (!ptr) {
 		if (!size)
@@ -53,18 +56,65 @@ static void *(*_tnt_realloc)(void *ptr, size_t size) =
 
 static void *(*_tnt_realloc)(void *ptr, size_t size) = custom_realloc;
 
+/*
+ * Freelists of the thread: blocks of size classes by 16 bytes up to 256
+ * and powers of two up to TNT_MEM_POOL_MAX, next free block is stored in
+ * the first word of block.
+ */
+#define TNT_MEM_POOL_MAX 65536
+#define TNT_MEM_POOL_CLASSES 24
+
+struct tnt_mem_pool {
+	void *free[TNT_MEM_POOL_CLASSES];
+	size_t high_water;
+};
+
+static __thread struct tnt_mem_pool pool;
+static __thread struct tnt_mem_stat stat;
+/* threads with enabled freelists, they keep blocks of the allocator */
+static int pool_threads;
+
+static inline int tnt_mem_pool_class(size_t size) {
+	if (size <= 256)
+		return size <= 16 ? 0 : (size + 15) / 16 - 1;
+	int bits = 9;
+	while (((size_t)1 << bits) < size)
+		bits++;
+	return bits + 7;
+}
+
+static inline size_t tnt_mem_pool_class_size(int idx) {
+	if (idx < 16)
+		return (idx + 1) * 16;
+	return (size_t)1 << (idx - 7);
+}
+
 void *tnt_mem_init(tnt_allocator_t alloc) {
 	void *ptr = _tnt_realloc;
-	if (alloc)
+	if (alloc) {
+		/* blocks cached by other threads can't be released here */
+		if (pm_atomic_load(&pool_threads) > (pool.high_water != 0))
+			return NULL;
+		/* cached blocks belong to previous allocator */
+		tnt_mem_pool_trim(0);
 		_tnt_realloc = alloc;
+	}
 	return ptr;
 }
 
 void *tnt_mem_alloc(size_t size) {
+	if (size)
+		stat.alloc++;
 	return _tnt_realloc(NULL, size);
 }
 
 void *tnt_mem_realloc(void *ptr, size_t size) {
+	if (ptr == NULL && size)
+		stat.alloc++;
+	else if (ptr != NULL && size)
+		stat.realloc++;
+	else if (ptr != NULL)
+		stat.free++;
 	return _tnt_realloc(ptr, size);
 }
 
@@ -78,5 +128,115 @@ char *tnt_mem_dup(char *sz) {
 }
 
 void tnt_mem_free(void *ptr) {
+	if (ptr)
+		stat.free++;
 	_tnt_realloc(ptr, 0);
 }
+
+void *tnt_mem_ctx_alloc(struct tnt_mem_ctx *ctx, size_t size) {
+	if (ctx == NULL)
+		return tnt_mem_alloc(size);
+	return ctx->realloc(ctx, NULL, size);
+}
+
+void *tnt_mem_ctx_realloc(struct tnt_mem_ctx *ctx, void *ptr, size_t size) {
+	if (ctx == NULL)
+		return tnt_mem_realloc(ptr, size);
+	return ctx->realloc(ctx, ptr, size);
+}
+
+void tnt_mem_ctx_free(struct tnt_mem_ctx *ctx, void *ptr) {
+	if (ctx == NULL)
+		tnt_mem_free(ptr);
+	else if (ptr != NULL)
+		ctx->realloc(ctx, ptr, 0);
+}
+
+size_t tnt_mem_pool_size(size_t size) {
+	if (size > TNT_MEM_POOL_MAX)
+		return size;
+	return tnt_mem_pool_class_size(tnt_mem_pool_class(size));
+}
+
+void *tnt_mem_pool_alloc(size_t size) {
+	if (size > TNT_MEM_POOL_MAX)
+		return tnt_mem_alloc(size);
+	int idx = tnt_mem_pool_class(size);
+	void *ptr = pool.free[idx];
+	if (ptr == NULL) {
+		if (pool.high_water)
+			stat.pool_miss++;
+		return tnt_mem_alloc(tnt_mem_pool_class_size(idx));
+	}
+	pool.free[idx] = *(void **)ptr;
+	stat.pool_hit++;
+	stat.pool_cached -= tnt_mem_pool_class_size(idx);
+	return ptr;
+}
+
+void *tnt_mem_pool_alloc_data(size_t size, size_t *alloc) {
+	/* rounding to size class is paid only if block may be cached */
+	if (size > TNT_MEM_POOL_MAX || (pool.high_water == 0 &&
+	    pool.free[tnt_mem_pool_class(size)] == NULL)) {
+		*alloc = size;
+		return tnt_mem_alloc(size);
+	}
+	*alloc = tnt_mem_pool_size(size);
+	return tnt_mem_pool_alloc(size);
+}
+
+void tnt_mem_pool_free_data(void *ptr, size_t alloc) {
+	if (tnt_mem_pool_size(alloc) == alloc)
+		tnt_mem_pool_free(ptr, alloc);
+	else
+		tnt_mem_free(ptr);
+}
+
+void tnt_mem_pool_free(void *ptr, size_t size) {
+	if (ptr == NULL)
+		return;
+	if (size > TNT_MEM_POOL_MAX) {
+		tnt_mem_free(ptr);
+		return;
+	}
+	int idx = tnt_mem_pool_class(size);
+	size_t csize = tnt_mem_pool_class_size(idx);
+	if (stat.pool_cached + csize > pool.high_water) {
+		tnt_mem_free(ptr);
+		return;
+	}
+	*(void **)ptr = pool.free[idx];
+	pool.free[idx] = ptr;
+	stat.pool_cached += csize;
+}
+
+void tnt_mem_pool(size_t high_water) {
+	if (pool.high_water == 0 && high_water != 0)
+		pm_atomic_fetch_add(&pool_threads, 1);
+	else if (pool.high_water != 0 && high_water == 0)
+		pm_atomic_fetch_sub(&pool_threads, 1);
+	pool.high_water = high_water;
+	tnt_mem_pool_trim(high_water);
+}
+
+void tnt_mem_pool_trim(size_t keep) {
+	/* large blocks are released first */
+	for (int idx = TNT_MEM_POOL_CLASSES - 1; idx >= 0; --idx) {
+		while (stat.pool_cached > keep && pool.free[idx] != NULL) {
+			void *ptr = pool.free[idx];
+			pool.free[idx] = *(void **)ptr;
+			stat.pool_cached -= tnt_mem_pool_class_size(idx);
+			tnt_mem_free(ptr);
+		}
+	}
+}
+
+void tnt_mem_stat(struct tnt_mem_stat *st) {
+	memcpy(st, &stat, sizeof(struct tnt_mem_stat));
+}
+
+void tnt_mem_stat_reset(void) {
+	size_t cached = stat.pool_cached;
+	memset(&stat, 0, sizeof(struct tnt_mem_stat));
+	stat.pool_cached = cached;
+}
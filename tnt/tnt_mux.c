@@ -0,0 +1,399 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include <tarantool/tnt_mem.h>
+#include <tarantool/tnt_proto.h>
+#include <tarantool/tnt_reply.h>
+#include <tarantool/tnt_stream.h>
+#include <tarantool/tnt_buf.h>
+#include <tarantool/tnt_request.h>
+#include <tarantool/tnt_net.h>
+#include <tarantool/tnt_mux.h>
+
+#include "tnt_sync.h"
+#include "pmatomic.h"
+
+#define TIMEVAL_TO_MSEC(tv) ((tv).tv_sec * 1000 + (tv).tv_usec / 1000)
+
+/* request of a thread, that waits for reply */
+struct tnt_mux_slot {
+	struct tnt_mux_slot *next; /* queue link */
+	struct tnt_stream buf; /* encoded request */
+	uint64_t sync;
+	struct tnt_reply *reply;
+	enum tnt_error error;
+	int done;
+	pthread_cond_t cond;
+};
+
+struct tnt_mux {
+	struct tnt_stream *s;
+	/* lock-free stack, that is filled by callers */
+	struct tnt_mux_slot *queue;
+	/* requests, that aren't written yet (owned by I/O thread) */
+	struct tnt_mux_slot *pending;
+	struct tnt_mux_slot **pending_tail;
+	/* requests, that wait for reply, by sync (owned by I/O thread) */
+	struct mh_sync_t *inflight;
+	uint64_t reqid;
+	enum tnt_error error;
+	int stop;
+	int wake[2];
+	pthread_t thread;
+	pthread_mutex_t lock;
+};
+
+static void
+tnt_mux_complete(struct tnt_mux *m, struct tnt_mux_slot *slot,
+		 enum tnt_error error)
+{
+	pthread_mutex_lock(&m->lock);
+	slot->error = error;
+	slot->done = 1;
+	pthread_cond_signal(&slot->cond);
+	pthread_mutex_unlock(&m->lock);
+}
+
+/* connection is broken, fail every request */
+static void
+tnt_mux_fail(struct tnt_mux *m, enum tnt_error error)
+{
+	if (m->error == TNT_EOK) {
+		pm_atomic_store(&m->error, error);
+		/* borrowed payloads are dropped, before callers are woken */
+		tnt_close(m->s);
+	}
+	while (m->pending != NULL) {
+		struct tnt_mux_slot *slot = m->pending;
+		m->pending = slot->next;
+		tnt_mux_complete(m, slot, m->error);
+	}
+	m->pending_tail = &m->pending;
+	uint32_t k;
+	mh_foreach(m->inflight, k)
+		tnt_mux_complete(m, mh_sync_node(m->inflight, k)->data,
+				 m->error);
+	mh_sync_clear(m->inflight);
+}
+
+static void
+tnt_mux_wakeup(struct tnt_mux *m)
+{
+	char c = 0;
+	/* full pipe wakes I/O thread anyway */
+	while (write(m->wake[1], &c, 1) == -1 && errno == EINTR)
+		;
+}
+
+static void
+tnt_mux_push(struct tnt_mux *m, struct tnt_mux_slot *slot)
+{
+	struct tnt_mux_slot *head = pm_atomic_load(&m->queue);
+	do {
+		slot->next = head;
+	} while (!pm_atomic_compare_exchange_weak(&m->queue, &head, slot));
+	/* I/O thread takes whole queue, so it's woken up once per batch */
+	if (head == NULL)
+		tnt_mux_wakeup(m);
+}
+
+/* move queued requests to pending list, in order of submission */
+static void
+tnt_mux_drain(struct tnt_mux *m)
+{
+	struct tnt_mux_slot *slot = pm_atomic_exchange(&m->queue, NULL);
+	struct tnt_mux_slot *fifo = NULL;
+	while (slot != NULL) {
+		struct tnt_mux_slot *next = slot->next;
+		slot->next = fifo;
+		fifo = slot;
+		slot = next;
+	}
+	*m->pending_tail = fifo;
+	while (*m->pending_tail != NULL)
+		m->pending_tail = &(*m->pending_tail)->next;
+}
+
+static struct tnt_mux_slot *
+tnt_mux_pending_pop(struct tnt_mux *m)
+{
+	struct tnt_mux_slot *slot = m->pending;
+	m->pending = slot->next;
+	if (m->pending == NULL)
+		m->pending_tail = &m->pending;
+	return slot;
+}
+
+static void
+tnt_mux_send(struct tnt_mux *m)
+{
+	struct tnt_stream *s = m->s;
+	while (m->pending != NULL) {
+		struct tnt_mux_slot *slot = m->pending;
+		/* slot is registered first: write may borrow its buffer */
+		if (tnt_sync_put(m->inflight, slot->sync, slot, NULL) == -1) {
+			tnt_mux_complete(m, tnt_mux_pending_pop(m),
+					 TNT_EMEMORY);
+			continue;
+		}
+		if (s->write(s, TNT_SBUF_DATA(&slot->buf),
+			     TNT_SBUF_SIZE(&slot->buf)) != -1) {
+			tnt_mux_pending_pop(m);
+			continue;
+		}
+		tnt_sync_take(m->inflight, slot->sync);
+		enum tnt_error error = tnt_error(s);
+		/* full window is retried once replies are read */
+		if (error == TNT_EAGAIN || error == TNT_EWINDOW)
+			break;
+		if (error != TNT_EBIG) {
+			tnt_mux_fail(m, error);
+			return;
+		}
+		tnt_mux_complete(m, tnt_mux_pending_pop(m), error);
+	}
+	if (tnt_flush(s) == -1 && tnt_error(s) != TNT_EAGAIN)
+		tnt_mux_fail(m, tnt_error(s));
+}
+
+static void
+tnt_mux_recv(struct tnt_mux *m)
+{
+	struct tnt_stream *s = m->s;
+	while (1) {
+		struct tnt_reply r;
+		tnt_reply_init(&r);
+		int rc = s->read_reply(s, &r);
+		if (rc == 1)
+			return; /* nothing is in flight */
+		if (rc == -1) {
+			if (tnt_error(s) != TNT_EAGAIN)
+				tnt_mux_fail(m, tnt_error(s));
+			return;
+		}
+		struct tnt_mux_slot *slot = NULL;
+		/* pushes aren't delivered, caller waits for final reply */
+		if ((r.code & TNT_CHUNK) == 0)
+			slot = tnt_sync_take(m->inflight, r.sync);
+		if (slot == NULL) {
+			tnt_reply_free(&r);
+			continue;
+		}
+		int alloc = slot->reply->alloc;
+		*slot->reply = r;
+		slot->reply->alloc = alloc;
+		tnt_mux_complete(m, slot, TNT_EOK);
+	}
+}
+
+static void *
+tnt_mux_loop(void *arg)
+{
+	struct tnt_mux *m = arg;
+	while (!pm_atomic_load(&m->stop)) {
+		tnt_mux_drain(m);
+		if (m->error != TNT_EOK) {
+			tnt_mux_fail(m, m->error);
+		} else {
+			tnt_mux_send(m);
+			if (m->error == TNT_EOK)
+				tnt_mux_recv(m);
+			/* replies could free window, nothing else wakes us */
+			if (m->error == TNT_EOK && m->pending != NULL)
+				tnt_mux_send(m);
+		}
+		struct pollfd fds[2];
+		int nfds = 1;
+		fds[0].fd = m->wake[0];
+		fds[0].events = POLLIN;
+		if (m->error == TNT_EOK) {
+			fds[1].fd = tnt_fd(m->s);
+			fds[1].events = tnt_events(m->s);
+			nfds++;
+		}
+		if (poll(fds, nfds, -1) <= 0)
+			continue;
+		if (fds[0].revents) {
+			char buf[64];
+			while (read(m->wake[0], buf, sizeof(buf)) > 0)
+				;
+		}
+	}
+	return NULL;
+}
+
+/* connect stream in non-blocking mode, waiting for every step */
+static int
+tnt_mux_connect(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->state == TNT_STATE_READY)
+		return 0;
+	if (sn->state == TNT_STATE_CLOSED)
+		tnt_set(s, TNT_OPT_NONBLOCK, 1);
+	int timeout = TIMEVAL_TO_MSEC(sn->opt.tmout_connect);
+	if (timeout <= 0)
+		timeout = -1;
+	while (tnt_connect(s) == -1) {
+		if (tnt_error(s) != TNT_EAGAIN)
+			return -1;
+		struct pollfd pfd;
+		pfd.fd = tnt_fd(s);
+		pfd.events = tnt_events(s);
+		if (poll(&pfd, 1, timeout) == 0) {
+			tnt_close(s);
+			sn->error = TNT_ETMOUT;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+static int
+tnt_mux_pipe(struct tnt_mux *m)
+{
+	if (pipe(m->wake) == -1)
+		return -1;
+	int i;
+	for (i = 0; i < 2; ++i) {
+		int flags = fcntl(m->wake[i], F_GETFL);
+		if (flags == -1 ||
+		    fcntl(m->wake[i], F_SETFL, flags | O_NONBLOCK) == -1)
+			return -1;
+	}
+	return 0;
+}
+
+struct tnt_mux *
+tnt_mux_new(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->opt.uring != NULL ||
+	    (sn->state != TNT_STATE_CLOSED && !sn->opt.nonblock)) {
+		sn->error = TNT_EFAIL;
+		return NULL;
+	}
+	if (tnt_mux_connect(s) == -1)
+		return NULL;
+	struct tnt_mux *m = tnt_mem_alloc(sizeof(struct tnt_mux));
+	if (m == NULL) {
+		sn->error = TNT_EMEMORY;
+		return NULL;
+	}
+	memset(m, 0, sizeof(struct tnt_mux));
+	m->s = s;
+	m->pending_tail = &m->pending;
+	/* syncs, that were used while connecting, aren't reused */
+	m->reqid = s->reqid;
+	m->wake[0] = m->wake[1] = -1;
+	m->inflight = mh_sync_new();
+	if (m->inflight == NULL) {
+		sn->error = TNT_EMEMORY;
+		goto error;
+	}
+	pthread_mutex_init(&m->lock, NULL);
+	if (tnt_mux_pipe(m) == -1) {
+		sn->error = TNT_ESYSTEM;
+		sn->errno_ = errno;
+		goto error_lock;
+	}
+	int rc = pthread_create(&m->thread, NULL, tnt_mux_loop, m);
+	if (rc != 0) {
+		sn->error = TNT_ESYSTEM;
+		sn->errno_ = rc;
+		goto error_lock;
+	}
+	return m;
+error_lock:
+	pthread_mutex_destroy(&m->lock);
+	mh_sync_delete(m->inflight);
+error:
+	if (m->wake[0] != -1)
+		close(m->wake[0]);
+	if (m->wake[1] != -1)
+		close(m->wake[1]);
+	tnt_mem_free(m);
+	return NULL;
+}
+
+void
+tnt_mux_free(struct tnt_mux *m)
+{
+	pm_atomic_store(&m->stop, 1);
+	tnt_mux_wakeup(m);
+	pthread_join(m->thread, NULL);
+	close(m->wake[0]);
+	close(m->wake[1]);
+	mh_sync_delete(m->inflight);
+	pthread_mutex_destroy(&m->lock);
+	tnt_mem_free(m);
+}
+
+int
+tnt_mux_call(struct tnt_mux *m, struct tnt_request *req,
+	     struct tnt_reply *reply)
+{
+	if (pm_atomic_load(&m->error) != TNT_EOK)
+		return -1;
+	struct tnt_mux_slot slot;
+	memset(&slot, 0, sizeof(struct tnt_mux_slot));
+	if (tnt_buf(&slot.buf) == NULL)
+		return -1;
+	slot.buf.reqid = pm_atomic_fetch_add(&m->reqid, 1);
+	if (tnt_request_writeout(&slot.buf, req, &slot.sync) == -1) {
+		tnt_stream_free(&slot.buf);
+		return -1;
+	}
+	slot.reply = reply;
+	pthread_cond_init(&slot.cond, NULL);
+	tnt_mux_push(m, &slot);
+	pthread_mutex_lock(&m->lock);
+	while (!slot.done)
+		pthread_cond_wait(&slot.cond, &m->lock);
+	pthread_mutex_unlock(&m->lock);
+	pthread_cond_destroy(&slot.cond);
+	tnt_stream_free(&slot.buf);
+	return slot.error == TNT_EOK ? 0 : -1;
+}
+
+enum tnt_error
+tnt_mux_error(struct tnt_mux *m)
+{
+	return pm_atomic_load(&m->error);
+}
@@ -33,11 +33,16 @@
 #include <stdarg.h>
 #include <string.h>
 #include <stdint.h>
+#include <limits.h>
 #include <stdbool.h>
 
 #include <sys/uio.h>
+#include <sys/time.h>
+#include <poll.h>
+#include <time.h>
 
 #include <uri.h>
+#include <msgpuck.h>
 
 #include <tarantool/tnt_proto.h>
 #include <tarantool/tnt_reply.h>
@@ -51,18 +56,82 @@
 
 #include <tarantool/tnt_net.h>
 #include <tarantool/tnt_io.h>
+#include <tarantool/tnt_uring.h>
 
+#include "tnt_sync.h"
+#include "tnt_wheel.h"
+#include "tnt_proto_internal.h"
 #include "pmatomic.h"
 
+static void
+tnt_net_retain(struct tnt_stream *s, struct iovec *iov, int count);
+static int
+tnt_net_recover(struct tnt_stream *s);
+static void
+tnt_net_retain_clear(struct tnt_stream_net *sn);
+static void
+tnt_net_reply_lost(struct tnt_stream *s, struct tnt_reply *r);
+static void
+tnt_net_reply_remap(struct tnt_stream_net *sn, struct tnt_reply *r);
+static void
+tnt_net_autoflush(struct tnt_stream *s);
+static int
+tnt_net_window_wait(struct tnt_stream *s);
+static void
+tnt_net_window_sent(struct tnt_stream *s, struct iovec *iov, int count);
+static int
+tnt_net_window_room(struct tnt_stream *s);
+static void
+tnt_net_window_reply(struct tnt_stream_net *sn, struct tnt_reply *r);
+static int
+tnt_net_iov_header(struct iovec *iov, int count, uint64_t *code,
+		   uint64_t *sync, size_t *body);
+static void
+tnt_net_deadline_sent(struct tnt_stream *s, struct iovec *iov, int count);
+static void
+tnt_net_deadline_expire(struct tnt_stream *s);
+static int
+tnt_net_deadline_poll(struct tnt_stream *s);
+static int
+tnt_net_deadline_reply(struct tnt_stream *s, struct tnt_reply *r);
+static void
+tnt_net_deadline_clear(struct tnt_stream_net *sn);
+static void
+tnt_net_reply_timedout(struct tnt_stream *s, struct tnt_reply *r);
+
 static void tnt_net_free(struct tnt_stream *s) {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
 	tnt_io_close(sn);
+	tnt_io_sendq_drop(sn);
+	if (sn->opt.uring != NULL)
+		tnt_uring_detach(sn->opt.uring, sn);
+	if (sn->schema_reply)
+		tnt_reply_free(sn->schema_reply);
 	tnt_mem_free(sn->greeting);
 	tnt_iob_free(&sn->sbuf);
 	tnt_iob_free(&sn->rbuf);
+	tnt_mem_free(sn->sendq);
+	tnt_mem_free(sn->sendq_off);
+	tnt_mem_free(sn->sendq_vec);
+	tnt_mem_free(sn->zc_iov);
+	tnt_mem_free(sn->zc_need);
+	if (sn->expect)
+		mh_sync_delete(sn->expect);
+	if (sn->retain) {
+		tnt_net_retain_clear(sn);
+		mh_sync_delete(sn->retain);
+	}
+	tnt_mem_free(sn->lost);
+	tnt_net_deadline_clear(sn);
+	if (sn->deadlines)
+		mh_sync_delete(sn->deadlines);
+	if (sn->wheel)
+		tnt_wheel_free(sn->wheel);
 	tnt_opt_free(&sn->opt);
-	tnt_schema_free(sn->schema);
-	tnt_mem_free(sn->schema);
+	if (sn->schema != sn->opt.schema) {
+		tnt_schema_free(sn->schema);
+		tnt_mem_free(sn->schema);
+	}
 	tnt_mem_free(s->data);
 	s->data = NULL;
 }
@@ -74,39 +143,255 @@ tnt_net_read(struct tnt_stream *s, char *buf, size_t size) {
 	return tnt_io_recv(sn, buf, size);
 }
 
+/* account request, that is written into send buffer */
+static void
+tnt_net_sent(struct tnt_stream *s, struct iovec *iov, int count)
+{
+	tnt_net_window_sent(s, iov, count);
+	tnt_net_deadline_sent(s, iov, count);
+	tnt_net_retain(s, iov, count);
+	pm_atomic_fetch_add(&s->wrcnt, 1);
+	tnt_net_autoflush(s);
+}
+
 static ssize_t
 tnt_net_write(struct tnt_stream *s, const char *buf, size_t size) {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (tnt_net_window_wait(s) == -1) {
+		sn->idempotent = 0;
+		sn->deadline_next = 0;
+		return -1;
+	}
 	ssize_t rc = tnt_io_send(sn, buf, size);
-	if (rc != -1)
-		pm_atomic_fetch_add(&s->wrcnt, 1);
+	if (rc == -1 && tnt_net_recover(s) == 0)
+		rc = tnt_io_send(sn, buf, size);
+	if (rc != -1) {
+		struct iovec iov = { (void *)buf, size };
+		tnt_net_sent(s, &iov, 1);
+	}
+	sn->idempotent = 0;
+	sn->deadline_next = 0;
 	return rc;
 }
 
 static ssize_t
 tnt_net_writev(struct tnt_stream *s, struct iovec *iov, int count) {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (tnt_net_window_wait(s) == -1) {
+		sn->idempotent = 0;
+		sn->deadline_next = 0;
+		return -1;
+	}
 	ssize_t rc = tnt_io_sendv(sn, iov, count);
+	if (rc == -1 && tnt_net_recover(s) == 0)
+		rc = tnt_io_sendv(sn, iov, count);
 	if (rc != -1)
-		pm_atomic_fetch_add(&s->wrcnt, 1);
+		tnt_net_sent(s, iov, count);
+	sn->idempotent = 0;
+	sn->deadline_next = 0;
 	return rc;
 }
 
+/*
+ * Batch (tnt_batch()) is copied into send buffer by chunks of whole
+ * requests, that fit into window and send buffer, the buffer is released
+ * by caller right away, so it's never borrowed. Request larger than send
+ * buffer goes alone and is written past the buffer in blocking mode.
+ * Requests are accounted one by one, as if they were written separately.
+ */
+static ssize_t
+tnt_net_write_batch(struct tnt_stream *s, const char *buf, size_t size,
+		    int count) {
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	const char *p = buf, *end = buf + size;
+	while (count > 0 && p < end) {
+		if (tnt_net_window_wait(s) == -1)
+			break;
+		int room = tnt_net_window_room(s);
+		size_t max = sn->sbuf.buf != NULL ? sn->sbuf.size : SIZE_MAX;
+		const char *chunk = p;
+		int n = 0;
+		while (n < count && n < room && p < end) {
+			const char *q = p;
+			uint64_t len = mp_decode_uint(&q);
+			if (n > 0 && (size_t)(q + len - chunk) > max)
+				break;
+			p = q + len;
+			n++;
+		}
+		ssize_t rc = tnt_io_send_copy(sn, chunk, p - chunk);
+		if (rc == -1 && tnt_net_recover(s) == 0)
+			rc = tnt_io_send_copy(sn, chunk, p - chunk);
+		if (rc == -1) {
+			p = chunk;
+			break;
+		}
+		const char *frame = chunk;
+		while (frame < p) {
+			const char *q = frame;
+			uint64_t len = mp_decode_uint(&q);
+			struct iovec iov = { (void *)frame, q + len - frame };
+			tnt_net_sent(s, &iov, 1);
+			frame = q + len;
+		}
+		count -= n;
+	}
+	sn->idempotent = 0;
+	sn->deadline_next = 0;
+	/* part of batch is written, the error is reported by next call */
+	return p == buf ? -1 : p - buf;
+}
+
 static ssize_t
 tnt_net_recv_cb(struct tnt_stream *s, char *buf, ssize_t size) {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
 	return tnt_io_recv(sn, buf, size);
 }
 
+/*
+ * Parse reply in place, reply keeps receive buffer memory pinned.
+ */
+static int
+tnt_net_reply_pin(struct tnt_stream_net *sn, struct tnt_reply *r, size_t len)
+{
+	struct tnt_iob *b = &sn->rbuf;
+	int alloc = r->alloc;
+	struct tnt_mem_ctx *mem = r->mem;
+	memset(r, 0, sizeof(struct tnt_reply));
+	r->alloc = alloc;
+	r->mem = mem;
+	if (tnt_reply0(r, b->buf + b->off, len, &len) != 0) {
+		memset(r, 0, sizeof(struct tnt_reply));
+		r->alloc = alloc;
+		r->mem = mem;
+		return -1;
+	}
+	r->buf = b->buf + b->off + TNT_REPLY_IPROTO_HDR_SIZE;
+	r->buf_size = len - TNT_REPLY_IPROTO_HDR_SIZE;
+	r->pin = tnt_iob_pin(b);
+	b->off += len;
+	return 0;
+}
+
+/*
+ * Buffered reply reading: reply is parsed only when it's fully
+ * received into rbuf, which grows up to TNT_OPT_RECV_BUF_MAX to keep
+ * reply contiguous. In non-blocking mode -1 is returned with
+ * TNT_EAGAIN otherwise.
+ */
+static int
+tnt_net_reply_buf(struct tnt_stream *s, struct tnt_reply *r) {
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	struct tnt_iob *b = &sn->rbuf;
+	while (1) {
+		size_t off = 0;
+		int rc = tnt_reply(NULL, b->buf + b->off, b->top - b->off, &off);
+		if (rc == -1) {
+			sn->error = TNT_EFAIL;
+			return -1;
+		}
+		if (rc == 0 && sn->opt.reply_zerocopy)
+			return tnt_net_reply_pin(sn, r, off);
+		if (rc == 0) {
+			rc = tnt_reply_mem(r, b->buf + b->off, off, &off,
+					   s->mem);
+			if (rc == 0)
+				b->off += off;
+			return rc;
+		}
+		if (tnt_net_deadline_poll(s) == 0) {
+			sn->error = TNT_ETMOUT;
+			return -1;
+		}
+		if (tnt_io_recv_fill(sn, b->top - b->off + off) != -1)
+			continue;
+		if (sn->error != TNT_EBIG || sn->opt.nonblock)
+			return -1;
+		/* reply is bigger, than buffer may grow, it's copied */
+		sn->error = TNT_EOK;
+		return tnt_reply_from_mem(r, (tnt_reply_t)tnt_net_recv_cb, s,
+					  s->mem);
+	}
+}
+
 static int
 tnt_net_reply(struct tnt_stream *s, struct tnt_reply *r) {
-	if (pm_atomic_load(&s->wrcnt) == 0)
-		return 1;
-	int rv = tnt_reply_from(r, (tnt_reply_t)tnt_net_recv_cb, s);
-	if (r->error || (r->code & TNT_CHUNK) == 0) {
-		pm_atomic_fetch_sub(&s->wrcnt, 1);
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	/* expired and late replies are skipped without recursion */
+	for (;;) {
+		if (pm_atomic_load(&s->wrcnt) == 0)
+			return 1;
+		if (!sn->recovering) {
+			tnt_net_deadline_expire(s);
+			if (sn->timedout != NULL) {
+				tnt_net_reply_timedout(s, r);
+				return 0;
+			}
+			/* only late replies to expired requests are left */
+			if ((int)pm_atomic_load(&s->wrcnt) == sn->expired)
+				return 1;
+		}
+		if (sn->lost_count > 0 && !sn->recovering) {
+			tnt_net_reply_lost(s, r);
+			if (tnt_net_deadline_reply(s, r) == 1)
+				continue;
+			return 0;
+		}
+		/* blocking reader has no timer to send buffered requests */
+		if (sn->flush_pending > 0 && !sn->opt.nonblock &&
+		    !sn->recovering && tnt_flush(s) == -1)
+			return -1;
+		int rv;
+		if (sn->rbuf.buf != NULL) {
+			size_t off = sn->rbuf.off;
+			rv = tnt_net_reply_buf(s, r);
+			/* reply, read ahead, is complete and isn't moved */
+			if (rv == 0 && sn->window_ahead > 0) {
+				sn->window_ahead--;
+				sn->window_ahead_size -= sn->rbuf.off - off;
+			}
+			if (rv == -1 && sn->error == TNT_EAGAIN)
+				return -1;
+		} else if (tnt_net_deadline_poll(s) == 0) {
+			sn->error = TNT_ETMOUT;
+			rv = -1;
+		} else {
+			rv = tnt_reply_from_mem(r,
+					(tnt_reply_t)tnt_net_recv_cb, s, s->mem);
+		}
+		/* a deadline is reached, while waiting for reply */
+		if (rv == -1 && sn->error == TNT_ETMOUT) {
+			sn->error = TNT_EOK;
+			continue;
+		}
+		if (rv == -1) {
+			int rc = tnt_net_recover(s);
+			if (rc == 0)
+				continue;
+			/* failed reconnect has dropped requests in flight */
+			if (rc == -1)
+				return -1;
+		}
+		int late = 0;
+		if (rv == 0 && !sn->recovering) {
+			sn->reconnects = 0;
+			tnt_net_reply_remap(sn, r);
+			tnt_net_window_reply(sn, r);
+			late = tnt_net_deadline_reply(s, r);
+		}
+		if (r->error || (r->code & TNT_CHUNK) == 0) {
+			pm_atomic_fetch_sub(&s->wrcnt, 1);
+		}
+		if (late) {
+			/* reply struct is reused, only its buffers are freed */
+			int alloc = r->alloc;
+			r->alloc = 0;
+			tnt_reply_free(r);
+			r->alloc = alloc;
+			continue;
+		}
+		return rv;
 	}
-	return rv;
 }
 
 struct tnt_stream *tnt_net(struct tnt_stream *s) {
@@ -125,10 +410,12 @@ struct tnt_stream *tnt_net(struct tnt_stream *s) {
 	s->read_reply = tnt_net_reply;
 	s->write = tnt_net_write;
 	s->writev = tnt_net_writev;
+	s->write_batch = tnt_net_write_batch;
 	s->free = tnt_net_free;
 	/* initializing internal data */
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
 	sn->fd = -1;
+	sn->uring_buf = -1;
 	sn->greeting = tnt_mem_alloc(TNT_GREETING_SIZE);
 	if (sn->greeting == NULL) {
 		tnt_stream_free(s);
@@ -150,7 +437,25 @@ int tnt_set(struct tnt_stream *s, int opt, ...) {
 
 int tnt_init(struct tnt_stream *s) {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
-	if ((sn->schema = tnt_schema_new(NULL)) == NULL) {
+	if (sn->opt.uring != NULL) {
+		/* custom send/recv callbacks can't be used with io_uring */
+		if (sn->opt.send_cb || sn->opt.send_cbv || sn->opt.recv_cb)
+			sn->opt.uring = NULL;
+		else
+			sn->opt.nonblock = 1;
+	}
+	if (sn->opt.nonblock) {
+		/* partially sent/received data must be kept somewhere */
+		if (sn->opt.send_buf == 0)
+			sn->opt.send_buf = 16384;
+		if (sn->opt.recv_buf == 0)
+			sn->opt.recv_buf = 16384;
+	}
+	if (sn->opt.reply_zerocopy && sn->opt.recv_buf == 0)
+		sn->opt.recv_buf = 16384;
+	if (sn->opt.schema != NULL) {
+		sn->schema = sn->opt.schema;
+	} else if ((sn->schema = tnt_schema_new(NULL)) == NULL) {
 		sn->error = TNT_EMEMORY;
 		return -1;
 	}
@@ -164,15 +469,43 @@ int tnt_init(struct tnt_stream *s) {
 		sn->error = TNT_EMEMORY;
 		return -1;
 	}
+	if (sn->opt.uring != NULL)
+		tnt_uring_attach(sn->opt.uring, sn);
 	sn->inited = 1;
 	return 0;
 }
 
+static int
+tnt_connect_nb(struct tnt_stream *s);
+
+static void
+tnt_schema_request(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	uint64_t oldsync = tnt_stream_reqid(s, 127);
+	tnt_get_space(s);
+	tnt_get_index(s);
+	tnt_stream_reqid(s, oldsync);
+	sn->schema_loaded = 0;
+	sn->state = TNT_STATE_SCHEMA;
+}
+
 int tnt_reload_schema(struct tnt_stream *s)
 {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
 	if (!sn->connected || pm_atomic_load(&s->wrcnt) != 0)
 		return -1;
+	/* borrowed schema is loaded by its owner only */
+	if (sn->opt.schema != NULL) {
+		sn->error = TNT_EFAIL;
+		return -1;
+	}
+	if (sn->opt.nonblock) {
+		if (sn->state != TNT_STATE_READY)
+			return -1;
+		tnt_schema_request(s);
+		return tnt_connect_nb(s);
+	}
 	uint64_t oldsync = tnt_stream_reqid(s, 127);
 	tnt_get_space(s);
 	tnt_get_index(s);
@@ -187,6 +520,8 @@ int tnt_reload_schema(struct tnt_stream *s)
 		case(127):
 			if (r->error)
 				goto error;
+			/* spaces of previous connection are dropped */
+			tnt_schema_flush(sn->schema);
 			tnt_schema_add_spaces(sn->schema, r);
 			sloaded += 1;
 			break;
@@ -196,6 +531,7 @@ int tnt_reload_schema(struct tnt_stream *s)
 			if (!(sloaded & 1)) {
 				memcpy(&bkp, r, sizeof(struct tnt_reply));
 				r->buf = NULL;
+				r->pin = NULL;
 				break;
 			}
 			sloaded += 2;
@@ -239,16 +575,158 @@ tnt_authenticate(struct tnt_stream *s)
 		return -1;
 	}
 	tnt_reply_free(&rep);
-	tnt_reload_schema(s);
+	if (sn->opt.schema == NULL)
+		tnt_reload_schema(s);
 	return 0;
 }
 
+/*
+ * Process schema reply in non-blocking mode. Index reply may come
+ * before spaces reply, then it's kept until spaces are loaded.
+ */
+static int
+tnt_schema_reply(struct tnt_stream *s, struct tnt_reply *r)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (r->error)
+		return -1;
+	switch (r->sync) {
+	case(127):
+		tnt_schema_flush(sn->schema);
+		tnt_schema_add_spaces(sn->schema, r);
+		sn->schema_loaded |= 1;
+		if (sn->schema_reply) {
+			tnt_schema_add_indexes(sn->schema, sn->schema_reply);
+			tnt_reply_free(sn->schema_reply);
+			sn->schema_reply = NULL;
+			sn->schema_loaded |= 2;
+		}
+		break;
+	case(128):
+		if (sn->schema_loaded & 1) {
+			tnt_schema_add_indexes(sn->schema, r);
+			sn->schema_loaded |= 2;
+			break;
+		}
+		sn->schema_reply = tnt_reply_init(NULL);
+		if (sn->schema_reply == NULL)
+			return -1;
+		memcpy(sn->schema_reply, r, sizeof(struct tnt_reply));
+		sn->schema_reply->alloc = 1;
+		r->buf = NULL;
+		r->pin = NULL;
+		break;
+	default:
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Connection state machine for non-blocking mode. Returns -1 with
+ * TNT_EAGAIN, when socket isn't ready for the next step.
+ */
+static int
+tnt_connect_nb(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	struct uri *uri = sn->opt.uri;
+	struct tnt_reply rep;
+	while (sn->state != TNT_STATE_READY) {
+		switch (sn->state) {
+		case TNT_STATE_CLOSED:
+			sn->error = tnt_io_connect(sn);
+			if (sn->error == TNT_EAGAIN) {
+				sn->state = TNT_STATE_CONNECTING;
+				break;
+			}
+			if (sn->error != TNT_EOK)
+				return -1;
+			sn->state = TNT_STATE_GREETING;
+			break;
+		case TNT_STATE_CONNECTING:
+			sn->error = tnt_io_connect_finish(sn);
+			if (sn->error == TNT_EAGAIN)
+				return -1;
+			if (sn->error != TNT_EOK)
+				goto error;
+			sn->state = TNT_STATE_GREETING;
+			break;
+		case TNT_STATE_GREETING:
+			if (tnt_io_recv(sn, sn->greeting, TNT_GREETING_SIZE) == -1)
+				goto error;
+			if (uri->login && uri->password) {
+				tnt_auth(s, uri->login, uri->login_len,
+					 uri->password, uri->password_len);
+				sn->state = TNT_STATE_AUTH;
+			} else {
+				sn->state = TNT_STATE_READY;
+			}
+			break;
+		case TNT_STATE_AUTH:
+			if (tnt_io_flush(sn) == -1)
+				goto error;
+			tnt_reply_init(&rep);
+			int rc = s->read_reply(s, &rep);
+			if (rc == 1)
+				sn->error = TNT_EFAIL;
+			if (rc != 0)
+				goto error;
+			if (rep.error != NULL) {
+				sn->error = TNT_EFAIL;
+				if (TNT_REPLY_ERR(&rep) == TNT_ER_PASSWORD_MISMATCH)
+					sn->error = TNT_ELOGIN;
+				tnt_reply_free(&rep);
+				goto error;
+			}
+			tnt_reply_free(&rep);
+			if (sn->opt.schema != NULL)
+				sn->state = TNT_STATE_READY;
+			else
+				tnt_schema_request(s);
+			break;
+		case TNT_STATE_SCHEMA:
+			if (tnt_io_flush(sn) == -1)
+				goto error;
+			while (sn->schema_loaded != 3) {
+				tnt_reply_init(&rep);
+				int rc = s->read_reply(s, &rep);
+				if (rc == 1)
+					sn->error = TNT_EFAIL;
+				if (rc != 0)
+					goto error;
+				rc = tnt_schema_reply(s, &rep);
+				tnt_reply_free(&rep);
+				if (rc == -1) {
+					sn->error = TNT_EFAIL;
+					goto error;
+				}
+			}
+			sn->state = TNT_STATE_READY;
+			break;
+		default:
+			sn->error = TNT_EFAIL;
+			return -1;
+		}
+	}
+	return 0;
+error:
+	if (sn->error != TNT_EAGAIN)
+		tnt_close(s);
+	return -1;
+}
+
 int tnt_connect(struct tnt_stream *s)
 {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
 	if (!sn->inited) tnt_init(s);
+	if (sn->opt.nonblock && sn->state != TNT_STATE_CLOSED &&
+	    sn->state != TNT_STATE_READY)
+		return tnt_connect_nb(s);
 	if (sn->connected)
 		tnt_close(s);
+	if (sn->opt.nonblock)
+		return tnt_connect_nb(s);
 	sn->error = tnt_io_connect(sn);
 	if (sn->error != TNT_EOK)
 		return -1;
@@ -258,21 +736,715 @@ int tnt_connect(struct tnt_stream *s)
 	if (sn->opt.uri->login && sn->opt.uri->password)
 		if (tnt_authenticate(s) == -1)
 			return -1;
+	sn->state = TNT_STATE_READY;
 	return 0;
 }
 
-void tnt_close(struct tnt_stream *s) {
-	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+/* drop socket and buffered data, requests in flight are kept */
+static void
+tnt_net_reset(struct tnt_stream_net *sn)
+{
+	/* operations in flight are cancelled before buffers are reset */
+	tnt_io_close(sn);
 	tnt_iob_clear(&sn->sbuf);
 	tnt_iob_clear(&sn->rbuf);
-	tnt_io_close(sn);
+	/* borrowed payloads are released unsent */
+	tnt_io_sendq_drop(sn);
+	sn->flush_pending = 0;
+	sn->rtt_timing = 0;
+	sn->window_ahead = 0;
+	sn->window_ahead_size = 0;
+	if (sn->schema_reply) {
+		tnt_reply_free(sn->schema_reply);
+		sn->schema_reply = NULL;
+	}
+	sn->state = TNT_STATE_CLOSED;
+}
+
+void tnt_close(struct tnt_stream *s) {
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	tnt_net_reset(sn);
+	/* replies won't come */
+	if (sn->expect)
+		mh_sync_clear(sn->expect);
+	if (sn->retain)
+		tnt_net_retain_clear(sn);
+	tnt_net_deadline_clear(sn);
+	sn->lost_count = 0;
+	sn->reconnects = 0;
 	s->wrcnt = 0;
 	s->reqid = 0;
 }
 
 ssize_t tnt_flush(struct tnt_stream *s) {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
-	return tnt_io_flush(sn);
+	ssize_t rc = tnt_io_flush(sn);
+	/* retained requests are flushed by reconnect */
+	if (rc == -1 && tnt_net_recover(s) == 0)
+		return 0;
+	return rc;
+}
+
+/*
+ * Resilient mode (TNT_OPT_RECONNECT). Every request in flight is
+ * remembered by its sync, idempotent ones together with their body. After
+ * connection loss the stream is reconnected, idempotent requests are
+ * resent with fresh syncs (replies get original syncs back), and other
+ * ones are answered with TNT_ER_NO_CONNECTION.
+ */
+
+#define TNT_RECONNECT_DELAY_MAX_MSEC 5000
+#define TIMEVAL_TO_MSEC(tv) ((tv).tv_sec * 1000 + (tv).tv_usec / 1000)
+
+struct tnt_retained {
+	uint64_t sync; /* sync, that is known to caller */
+	uint32_t code;
+	size_t size;
+	char body[];
+};
+
+static const char tnt_net_lost_msg[] =
+	"Connection was lost, request isn't idempotent";
+
+void tnt_idempotent(struct tnt_stream *s) {
+	TNT_SNET_CAST(s)->idempotent = 1;
+}
+
+static void
+tnt_net_retain_clear(struct tnt_stream_net *sn)
+{
+	uint32_t k;
+	mh_foreach(sn->retain, k)
+		tnt_mem_free(mh_sync_node(sn->retain, k)->data);
+	mh_sync_clear(sn->retain);
+}
+
+/* gather size bytes, starting from offset, of iovec into buf */
+static void
+tnt_net_iov_copy(char *buf, struct iovec *iov, int count, size_t off,
+		 size_t size)
+{
+	int i;
+	for (i = 0; i < count && size > 0; ++i) {
+		if (off >= iov[i].iov_len) {
+			off -= iov[i].iov_len;
+			continue;
+		}
+		size_t n = iov[i].iov_len - off;
+		if (n > size)
+			n = size;
+		memcpy(buf, (char *)iov[i].iov_base + off, n);
+		buf += n;
+		size -= n;
+		off = 0;
+	}
+}
+
+/*
+ * Decode IPROTO header map, return CODE and SYNC. Other keys are
+ * skipped.
+ */
+static int
+tnt_net_header(const char **p, const char *end, uint64_t *code,
+	       uint64_t *sync)
+{
+	if (*p >= end || mp_typeof(**p) != MP_MAP ||
+	    mp_check_map(*p, end) > 0)
+		return -1;
+	uint32_t n = mp_decode_map(p);
+	int found = 0;
+	while (n-- > 0) {
+		if (*p >= end || mp_typeof(**p) != MP_UINT ||
+		    mp_check_uint(*p, end) > 0)
+			return -1;
+		uint64_t key = mp_decode_uint(p);
+		if (*p >= end || mp_typeof(**p) != MP_UINT ||
+		    mp_check_uint(*p, end) > 0)
+			return -1;
+		if (key == TNT_CODE) {
+			*code = mp_decode_uint(p);
+			found |= 1;
+		} else if (key == TNT_SYNC) {
+			*sync = mp_decode_uint(p);
+			found |= 2;
+		} else {
+			mp_decode_uint(p);
+		}
+	}
+	return found == 3 ? 0 : -1;
+}
+
+/*
+ * Decode header of request, written as iovec. body is set to offset of
+ * request body.
+ */
+static int
+tnt_net_iov_header(struct iovec *iov, int count, uint64_t *code,
+		   uint64_t *sync, size_t *body)
+{
+	/* length and {CODE, SYNC} header fit into 32 bytes */
+	char hdr[32];
+	size_t size = 0;
+	int i;
+	for (i = 0; i < count; ++i)
+		size += iov[i].iov_len;
+	size_t hdr_size = size < sizeof(hdr) ? size : sizeof(hdr);
+	tnt_net_iov_copy(hdr, iov, count, 0, hdr_size);
+	const char *p = hdr, *end = hdr + hdr_size;
+	if (mp_check_uint(p, end) > 0)
+		return -1;
+	mp_decode_uint(&p);
+	if (tnt_net_header(&p, end, code, sync) == -1)
+		return -1;
+	*body = p - hdr;
+	return 0;
+}
+
+static void
+tnt_net_retain(struct tnt_stream *s, struct iovec *iov, int count)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->opt.reconnect <= 0 || sn->opt.nonblock ||
+	    sn->state != TNT_STATE_READY)
+		return;
+	if (sn->retain == NULL && (sn->retain = mh_sync_new()) == NULL)
+		return;
+	uint64_t code, sync;
+	size_t body, size = 0;
+	int i;
+	for (i = 0; i < count; ++i)
+		size += iov[i].iov_len;
+	if (tnt_net_iov_header(iov, count, &code, &sync, &body) == -1)
+		return;
+	struct tnt_retained *r = NULL;
+	if (sn->idempotent || code == TNT_OP_SELECT || code == TNT_OP_PING) {
+		r = tnt_mem_alloc(sizeof(struct tnt_retained) + size - body);
+		if (r == NULL)
+			return;
+		r->sync = sync;
+		r->code = code;
+		r->size = size - body;
+		tnt_net_iov_copy(r->body, iov, count, body, r->size);
+	}
+	if (tnt_sync_put(sn->retain, sync, r, NULL) == -1)
+		tnt_mem_free(r);
+}
+
+static void
+tnt_net_reply_remap(struct tnt_stream_net *sn, struct tnt_reply *r)
+{
+	if (sn->retain == NULL || mh_size(sn->retain) == 0)
+		return;
+	struct tnt_retained *f;
+	if (r->error || (r->code & TNT_CHUNK) == 0) {
+		f = tnt_sync_take(sn->retain, r->sync);
+		if (f != NULL)
+			r->sync = f->sync;
+		tnt_mem_free(f);
+	} else {
+		struct tnt_sync_entry *e = tnt_sync_find(sn->retain, r->sync);
+		if (e != NULL && e->data != NULL)
+			r->sync = ((struct tnt_retained *)e->data)->sync;
+	}
+}
+
+static void
+tnt_net_reply_lost(struct tnt_stream *s, struct tnt_reply *r)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	int alloc = r->alloc;
+	memset(r, 0, sizeof(struct tnt_reply));
+	r->alloc = alloc;
+	r->sync = sn->lost[--sn->lost_count];
+	r->code = TNT_ER_NO_CONNECTION;
+	r->error = tnt_net_lost_msg;
+	r->error_end = tnt_net_lost_msg + sizeof(tnt_net_lost_msg) - 1;
+	pm_atomic_fetch_sub(&s->wrcnt, 1);
+}
+
+/*
+ * Resend idempotent requests with fresh syncs, remember other ones as
+ * lost. Entries of old table are moved on success only.
+ */
+static int
+tnt_net_replay(struct tnt_stream *s, struct mh_sync_t *old)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	uint32_t k;
+	mh_foreach(old, k) {
+		struct tnt_sync_entry *e = mh_sync_node(old, k);
+		struct tnt_retained *f = e->data;
+		if (f == NULL) {
+			if (sn->lost_count == sn->lost_size) {
+				int size = sn->lost_size ? sn->lost_size * 2 : 16;
+				uint64_t *lost = tnt_mem_realloc(sn->lost,
+						size * sizeof(uint64_t));
+				if (lost == NULL) {
+					sn->error = TNT_EMEMORY;
+					return -1;
+				}
+				sn->lost = lost;
+				sn->lost_size = size;
+			}
+			sn->lost[sn->lost_count++] = e->sync;
+			continue;
+		}
+		struct tnt_iheader hdr;
+		uint64_t sync = s->reqid++;
+		encode_header(&hdr, f->code, sync);
+		size_t hdr_size = hdr.end - hdr.header;
+		char len[9];
+		char *len_end = mp_encode_luint32(len, hdr_size + f->size);
+		struct iovec v[3] = {
+			{ len, len_end - len },
+			{ hdr.header, hdr_size },
+			{ f->body, f->size }
+		};
+		if (tnt_sync_put(sn->retain, sync, f, NULL) == -1) {
+			sn->error = TNT_EMEMORY;
+			return -1;
+		}
+		if (tnt_io_sendv(sn, v, 3) == -1)
+			return -1;
+	}
+	return tnt_io_flush(sn) == -1 ? -1 : 0;
+}
+
+/*
+ * Reconnect after connection loss. Returns 1, if resilient mode isn't
+ * enabled or error isn't caused by connection loss, and -1, if all
+ * attempts failed (the stream is closed then).
+ */
+static int
+tnt_net_recover(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->opt.reconnect <= 0 || sn->opt.nonblock || sn->recovering ||
+	    sn->state != TNT_STATE_READY || sn->error != TNT_ESYSTEM)
+		return 1;
+	/* requests in flight are moved aside, until they are resent */
+	struct mh_sync_t *old = sn->retain;
+	if (old == NULL && (old = mh_sync_new()) == NULL)
+		return 1;
+	if ((sn->retain = mh_sync_new()) == NULL) {
+		sn->retain = old;
+		return 1;
+	}
+	sn->recovering = 1;
+	int lost_count = sn->lost_count;
+	int rc = -1;
+	/* attempts are counted until a reply is received */
+	while (rc == -1 && sn->reconnects < sn->opt.reconnect) {
+		if (sn->reconnects++ > 0) {
+			int delay = TIMEVAL_TO_MSEC(sn->opt.reconnect_delay);
+			int i;
+			for (i = 1; i < sn->reconnects - 1 &&
+			     delay < TNT_RECONNECT_DELAY_MAX_MSEC; ++i)
+				delay *= 2;
+			if (delay > TNT_RECONNECT_DELAY_MAX_MSEC)
+				delay = TNT_RECONNECT_DELAY_MAX_MSEC;
+			struct timespec ts = { delay / 1000,
+					       (delay % 1000) * 1000000 };
+			nanosleep(&ts, NULL);
+		}
+		tnt_net_reset(sn);
+		/* entries of failed attempt are still owned by old table */
+		mh_sync_clear(sn->retain);
+		sn->lost_count = lost_count;
+		/* authentication and schema loading need empty pipeline */
+		s->wrcnt = 0;
+		if (tnt_connect(s) == -1)
+			continue;
+		rc = tnt_net_replay(s, old);
+		if (rc == -1 && sn->error == TNT_EMEMORY)
+			break;
+	}
+	sn->recovering = 0;
+	if (rc == -1) {
+		mh_sync_delete(sn->retain);
+		sn->retain = old;
+		tnt_close(s);
+		return -1;
+	}
+	mh_sync_delete(old);
+	s->wrcnt = mh_size(sn->retain) + sn->lost_count;
+	return 0;
+}
+
+/*
+ * Auto-flush (TNT_OPT_FLUSH_BYTES, TNT_OPT_FLUSH_COUNT,
+ * TNT_OPT_FLUSH_DELAY). Thresholds are checked after every written
+ * request, the delay is also reported to event loop by
+ * tnt_flush_timeout(). A blocking read_reply flushes buffered requests
+ * before waiting. flush_pending is reset by tnt_io_flush().
+ */
+
+#define TIMEVAL_TO_USEC(tv) ((int64_t)(tv).tv_sec * 1000000 + (tv).tv_usec)
+
+static int64_t
+tnt_net_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int
+tnt_net_autoflush_on(struct tnt_stream_net *sn)
+{
+	return sn->sbuf.buf != NULL &&
+	       (sn->opt.flush_bytes > 0 || sn->opt.flush_count > 0 ||
+		timerisset(&sn->opt.flush_delay));
+}
+
+static int
+tnt_net_flush_due(struct tnt_stream_net *sn)
+{
+	if (sn->flush_pending == 0)
+		return 0;
+	if (sn->opt.flush_count > 0 &&
+	    sn->flush_pending >= sn->opt.flush_count)
+		return 1;
+	if (sn->opt.flush_bytes > 0) {
+		size_t size = sn->sbuf.off;
+		int i;
+		for (i = 0; i < sn->sendq_count; i++)
+			size += sn->sendq[i].iov_len;
+		if (size >= (size_t)sn->opt.flush_bytes)
+			return 1;
+	}
+	return timerisset(&sn->opt.flush_delay) &&
+	       tnt_net_now() >= sn->flush_deadline;
+}
+
+static void
+tnt_net_autoflush(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (!tnt_net_autoflush_on(sn))
+		return;
+	if (sn->flush_pending++ == 0 && timerisset(&sn->opt.flush_delay))
+		sn->flush_deadline = tnt_net_now() +
+				     TIMEVAL_TO_USEC(sn->opt.flush_delay);
+	/* error is kept in stream and returned by next operation */
+	if (tnt_net_flush_due(sn))
+		tnt_flush(s);
+}
+
+int tnt_zerocopy_pending(struct tnt_stream *s) {
+	return tnt_io_zerocopy_reap(TNT_SNET_CAST(s));
+}
+
+int tnt_flush_timeout(struct tnt_stream *s) {
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->flush_pending == 0 || !tnt_net_autoflush_on(sn) ||
+	    !timerisset(&sn->opt.flush_delay))
+		return -1;
+	int64_t left = sn->flush_deadline - tnt_net_now();
+	if (left <= 0)
+		return 0;
+	/* round up, poll() mustn't wake up before deadline */
+	return (int)((left + 999) / 1000);
+}
+
+/*
+ * Window of requests in flight (TNT_OPT_WINDOW). In blocking mode a
+ * full window is waited for by reading replies ahead into rbuf, they
+ * are returned by read_reply later. Adaptive window starts with one
+ * request, doubles on every round trip, until the first RTT sample
+ * exceeds twice the minimal one, then it's halved on such samples and
+ * grows by one request on others. One request at a time is timed.
+ */
+
+/* jitter, that isn't treated as queueing (usec) */
+#define TNT_WINDOW_RTT_SLACK 100
+
+static int
+tnt_net_window_size(struct tnt_stream_net *sn)
+{
+	if (!sn->opt.window_adaptive)
+		return sn->opt.window;
+	if (sn->window == 0)
+		sn->window = 1;
+	return sn->window;
+}
+
+static void
+tnt_net_window_sample(struct tnt_stream_net *sn)
+{
+	int64_t rtt = tnt_net_now() - sn->rtt_start;
+	sn->rtt_timing = 0;
+	sn->rtt = rtt;
+	if (sn->rtt_min == 0 || rtt < sn->rtt_min)
+		sn->rtt_min = rtt;
+	int window = tnt_net_window_size(sn);
+	if (rtt > sn->rtt_min * 2 + TNT_WINDOW_RTT_SLACK) {
+		window /= 2;
+		sn->window_cut = 1;
+	} else {
+		window = sn->window_cut ? window + 1 : window * 2;
+	}
+	if (window > sn->opt.window)
+		window = sn->opt.window;
+	sn->window = window > 0 ? window : 1;
+}
+
+/*
+ * Count replies, that are fully received into rbuf, but aren't read
+ * yet. Only new data is scanned, timed reply is sampled, when found.
+ */
+static int
+tnt_net_window_received(struct tnt_stream_net *sn)
+{
+	struct tnt_iob *b = &sn->rbuf;
+	const char *p = b->buf + b->off + sn->window_ahead_size;
+	const char *end = b->buf + b->top;
+	while (p < end) {
+		if (mp_typeof(*p) != MP_UINT || mp_check_uint(p, end) > 0)
+			break;
+		const char *hdr = p;
+		uint64_t len = mp_decode_uint(&hdr);
+		if ((uint64_t)(end - hdr) < len)
+			break;
+		p = hdr + len;
+		uint64_t code, sync;
+		if (sn->rtt_timing &&
+		    tnt_net_header(&hdr, p, &code, &sync) == 0 &&
+		    sync == sn->rtt_sync)
+			tnt_net_window_sample(sn);
+		sn->window_ahead++;
+	}
+	sn->window_ahead_size = p - (b->buf + b->off);
+	return sn->window_ahead;
+}
+
+static int
+tnt_net_window_wait(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->opt.window <= 0 || sn->state != TNT_STATE_READY ||
+	    sn->recovering)
+		return 0;
+	/* lost requests are answered without server */
+	int inflight = pm_atomic_load(&s->wrcnt) - sn->lost_count;
+	if (inflight < tnt_net_window_size(sn))
+		return 0;
+	switch (sn->opt.window_mode) {
+	case TNT_WINDOW_FAIL:
+		sn->error = TNT_EWINDOW;
+		return -1;
+	case TNT_WINDOW_EAGAIN:
+		sn->error = TNT_EAGAIN;
+		return -1;
+	default:
+		break;
+	}
+	if (sn->opt.nonblock || sn->rbuf.buf == NULL) {
+		sn->error = TNT_EAGAIN;
+		return -1;
+	}
+	while (inflight - tnt_net_window_received(sn) >=
+	       tnt_net_window_size(sn)) {
+		if (tnt_flush(s) == -1 || tnt_io_recv_fill(sn, 0) == -1)
+			return -1;
+	}
+	return 0;
+}
+
+/* requests, that may be written after tnt_net_window_wait() */
+static int
+tnt_net_window_room(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->opt.window <= 0 || sn->state != TNT_STATE_READY ||
+	    sn->recovering)
+		return INT_MAX;
+	int inflight = pm_atomic_load(&s->wrcnt) - sn->lost_count -
+		       sn->window_ahead;
+	int room = tnt_net_window_size(sn) - inflight;
+	return room > 0 ? room : 1;
+}
+
+static void
+tnt_net_window_sent(struct tnt_stream *s, struct iovec *iov, int count)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (!sn->opt.window_adaptive || sn->opt.window <= 0 ||
+	    sn->rtt_timing || sn->state != TNT_STATE_READY)
+		return;
+	uint64_t code;
+	size_t body;
+	if (tnt_net_iov_header(iov, count, &code, &sn->rtt_sync, &body) == -1)
+		return;
+	sn->rtt_timing = 1;
+	sn->rtt_start = tnt_net_now();
+}
+
+static void
+tnt_net_window_reply(struct tnt_stream_net *sn, struct tnt_reply *r)
+{
+	if (sn->rtt_timing && r->sync == sn->rtt_sync)
+		tnt_net_window_sample(sn);
+}
+
+/*
+ * Request deadlines (TNT_OPT_REQUEST_TIMEOUT, tnt_deadline). Timers are
+ * kept in hierarchical timing wheel and are found by sync on reply. An
+ * expired request is answered with TNT_ER_TIMEOUT by read_reply, but
+ * stays in wrcnt (and in expired), until its late reply is read and
+ * skipped.
+ */
+
+static const char tnt_net_timeout_msg[] = "Request timed out";
+
+void tnt_deadline(struct tnt_stream *s, const struct timeval *timeout) {
+	TNT_SNET_CAST(s)->deadline_next = TIMEVAL_TO_USEC(*timeout);
+}
+
+static void
+tnt_net_deadline_sent(struct tnt_stream *s, struct iovec *iov, int count)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	int64_t timeout = sn->deadline_next;
+	if (timeout == 0)
+		timeout = TIMEVAL_TO_USEC(sn->opt.request_timeout);
+	if (timeout <= 0 || sn->state != TNT_STATE_READY || sn->recovering)
+		return;
+	uint64_t code, sync;
+	size_t body;
+	if (tnt_net_iov_header(iov, count, &code, &sync, &body) == -1)
+		return;
+	int64_t now = tnt_net_now();
+	if (sn->deadlines == NULL && (sn->deadlines = mh_sync_new()) == NULL)
+		return;
+	if (sn->wheel == NULL &&
+	    (sn->wheel = tnt_wheel_new(now / 1000)) == NULL)
+		return;
+	/* msec are rounded up, request mustn't expire early */
+	struct tnt_timer *t = tnt_wheel_add(sn->wheel, sync,
+					    (now + timeout + 999) / 1000);
+	if (t == NULL)
+		return;
+	if (tnt_sync_put(sn->deadlines, sync, t, NULL) == -1)
+		tnt_wheel_del(sn->wheel, t);
+}
+
+static void
+tnt_net_deadline_expire(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->wheel == NULL || sn->wheel->count == 0)
+		return;
+	struct tnt_timer *t = tnt_wheel_advance(sn->wheel,
+						tnt_net_now() / 1000);
+	while (t != NULL) {
+		struct tnt_timer *next = t->next;
+		struct tnt_sync_entry *e = tnt_sync_find(sn->deadlines,
+							 t->sync);
+		if (e != NULL)
+			e->data = NULL;
+		t->next = sn->timedout;
+		sn->timedout = t;
+		sn->timedout_count++;
+		sn->expired++;
+		t = next;
+	}
+}
+
+static void
+tnt_net_reply_timedout(struct tnt_stream *s, struct tnt_reply *r)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	struct tnt_timer *t = sn->timedout;
+	sn->timedout = t->next;
+	sn->timedout_count--;
+	int alloc = r->alloc;
+	memset(r, 0, sizeof(struct tnt_reply));
+	r->alloc = alloc;
+	r->sync = t->sync;
+	r->code = TNT_ER_TIMEOUT;
+	r->error = tnt_net_timeout_msg;
+	r->error_end = tnt_net_timeout_msg + sizeof(tnt_net_timeout_msg) - 1;
+	tnt_wheel_release(sn->wheel, t);
+}
+
+/*
+ * Wait for data until the nearest deadline in blocking mode. Returns
+ * 0, if the deadline is reached.
+ */
+static int
+tnt_net_deadline_poll(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->opt.nonblock || sn->recovering || sn->wheel == NULL ||
+	    sn->wheel->count == 0)
+		return 1;
+	tnt_net_deadline_expire(s);
+	if (sn->timedout != NULL)
+		return 0;
+	int64_t next = tnt_wheel_next(sn->wheel);
+	if (next == -1)
+		return 1;
+	int64_t left = next - tnt_net_now() / 1000;
+	if (left <= 0)
+		return 0;
+	struct pollfd pfd = { sn->fd, POLLIN, 0 };
+	return poll(&pfd, 1, left > INT_MAX ? INT_MAX : (int)left) == 0 ? 0 : 1;
+}
+
+/*
+ * Remove deadline of answered request. Returns 1, if reply is late and
+ * has to be skipped.
+ */
+static int
+tnt_net_deadline_reply(struct tnt_stream *s, struct tnt_reply *r)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->deadlines == NULL || mh_size(sn->deadlines) == 0)
+		return 0;
+	struct tnt_sync_entry *e = tnt_sync_find(sn->deadlines, r->sync);
+	if (e == NULL)
+		return 0;
+	struct tnt_timer *t = e->data;
+	/* pushes don't finish request */
+	if (!r->error && (r->code & TNT_CHUNK) != 0)
+		return t == NULL;
+	tnt_sync_take(sn->deadlines, r->sync);
+	if (t != NULL) {
+		tnt_wheel_del(sn->wheel, t);
+		return 0;
+	}
+	sn->expired--;
+	return 1;
+}
+
+static void
+tnt_net_deadline_clear(struct tnt_stream_net *sn)
+{
+	if (sn->wheel != NULL) {
+		tnt_wheel_clear(sn->wheel);
+		while (sn->timedout != NULL) {
+			struct tnt_timer *t = sn->timedout;
+			sn->timedout = t->next;
+			tnt_wheel_release(sn->wheel, t);
+		}
+	}
+	if (sn->deadlines != NULL)
+		mh_sync_clear(sn->deadlines);
+	sn->timedout_count = 0;
+	sn->expired = 0;
+}
+
+int tnt_deadline_timeout(struct tnt_stream *s) {
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->timedout != NULL)
+		return 0;
+	if (sn->wheel == NULL || sn->wheel->count == 0)
+		return -1;
+	int64_t left = tnt_wheel_next(sn->wheel) - tnt_net_now() / 1000;
+	if (left <= 0)
+		return 0;
+	return left > INT_MAX ? INT_MAX : (int)left;
 }
 
 int tnt_fd(struct tnt_stream *s) {
@@ -280,6 +1452,32 @@ int tnt_fd(struct tnt_stream *s) {
 	return sn->fd;
 }
 
+int tnt_events(struct tnt_stream *s) {
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	switch (sn->state) {
+	case TNT_STATE_CLOSED:
+		return 0;
+	case TNT_STATE_CONNECTING:
+		return POLLOUT;
+	default:
+		break;
+	}
+	int events = 0;
+	/* buffered requests wait for auto-flush thresholds */
+	if ((sn->sbuf.off > 0 || sn->sendq_count > 0) &&
+	    (sn->flush_pending == 0 || !tnt_net_autoflush_on(sn) ||
+	     tnt_net_flush_due(sn)))
+		events |= POLLOUT;
+	if (sn->state != TNT_STATE_READY || pm_atomic_load(&s->wrcnt) > 0)
+		events |= POLLIN;
+	return events;
+}
+
+enum tnt_state tnt_state(struct tnt_stream *s) {
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	return sn->state;
+}
+
 enum tnt_error tnt_error(struct tnt_stream *s) {
 	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
 	return sn->error;
@@ -304,6 +1502,8 @@ static struct tnt_error_desc tnt_error_list[] =
 	{ TNT_ETMOUT,   "operation timeout"        },
 	{ TNT_EBADVAL,  "bad argument"             },
 	{ TNT_ELOGIN,   "failed to login"          },
+	{ TNT_EAGAIN,   "operation would block"    },
+	{ TNT_EWINDOW,  "too many requests in flight" },
 	{ TNT_LAST,      NULL                      }
 };
 
@@ -15,9 +15,15 @@ static void
 tnt_sbuf_object_free(struct tnt_stream *s)
 {
 	struct tnt_sbuf_object *sbo = TNT_SOBJ_CAST(s);
-	if (sbo->stack) tnt_mem_free(sbo->stack);
+	if (sbo->stack && sbo->stack != sbo->stack_storage)
+		tnt_mem_pool_free(sbo->stack, sbo->stack_alloc *
+				  sizeof(struct tnt_sbo_stack));
 	sbo->stack = NULL;
-	tnt_mem_free(sbo);
+	if (sbo->pending) tnt_mem_free(sbo->pending);
+	sbo->pending = NULL;
+	/* inline object lives in caller's storage */
+	if (sbo->stack_storage == NULL)
+		tnt_mem_pool_free(sbo, sizeof(struct tnt_sbuf_object));
 }
 
 int
@@ -33,30 +39,27 @@ tnt_sbuf_object_grow_stack(struct tnt_sbuf_object *sbo)
 {
 	if (sbo->stack_alloc == 128) return -1;
 	uint8_t new_stack_alloc = 2 * sbo->stack_alloc;
-	struct tnt_sbo_stack *stack = tnt_mem_alloc(new_stack_alloc * sizeof(
-				struct tnt_sbo_stack));
+	struct tnt_sbo_stack *stack = tnt_mem_pool_alloc(new_stack_alloc *
+			sizeof(struct tnt_sbo_stack));
 	if (!stack) return -1;
+	memcpy(stack, sbo->stack, sbo->stack_size *
+	       sizeof(struct tnt_sbo_stack));
+	if (sbo->stack != sbo->stack_storage)
+		tnt_mem_pool_free(sbo->stack, sbo->stack_alloc *
+				  sizeof(struct tnt_sbo_stack));
 	sbo->stack_alloc = new_stack_alloc;
 	sbo->stack = stack;
 	return 0;
 }
 
-static char *
-tnt_sbuf_object_resize(struct tnt_stream *s, size_t size) {
-	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
-	if (sb->size + size > sb->alloc) {
-		size_t newsize = 2 * (sb->alloc);
-		if (newsize < sb->size + size)
-			newsize = sb->size + size;
-		char *nd = tnt_mem_realloc(sb->data, newsize);
-		if (nd == NULL) {
-			tnt_mem_free(sb->data);
-			return NULL;
-		}
-		sb->data = nd;
-		sb->alloc = newsize;
-	}
-	return sb->data + sb->size;
+static void
+tnt_sbuf_object_init(struct tnt_sbuf_object *sbo)
+{
+	sbo->stack_size = 0;
+	sbo->pending = NULL;
+	sbo->pending_size = 0;
+	sbo->pending_alloc = 0;
+	sbo->stack_storage = NULL;
 }
 
 struct tnt_stream *
@@ -66,16 +69,16 @@ tnt_object(struct tnt_stream *s)
 		goto error;
 
 	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
-	sb->resize = tnt_sbuf_object_resize;
 	sb->free = tnt_sbuf_object_free;
 
-	struct tnt_sbuf_object *sbo = tnt_mem_alloc(sizeof(struct tnt_sbuf_object));
+	struct tnt_sbuf_object *sbo = tnt_mem_pool_alloc(
+			sizeof(struct tnt_sbuf_object));
 	if (sbo == NULL)
 		goto error;
 	sb->subdata = sbo;
-	sbo->stack_size = 0;
+	tnt_sbuf_object_init(sbo);
 	sbo->stack_alloc = 8;
-	sbo->stack = tnt_mem_alloc(sbo->stack_alloc *
+	sbo->stack = tnt_mem_pool_alloc(sbo->stack_alloc *
 			sizeof(struct tnt_sbo_stack));
 	if (sbo->stack == NULL)
 		goto error;
@@ -87,6 +90,22 @@ error:
 	return NULL;
 }
 
+struct tnt_stream *
+tnt_object_inline(struct tnt_object_inline *o)
+{
+	struct tnt_stream *s = tnt_buf_inline(&o->stream, &o->buf, o->data,
+					      sizeof(o->data));
+	struct tnt_stream_buf *sb = TNT_SBUF_CAST(s);
+	sb->free = tnt_sbuf_object_free;
+	sb->subdata = &o->obj;
+	tnt_sbuf_object_init(&o->obj);
+	o->obj.stack_alloc = TNT_OBJECT_INLINE_DEPTH;
+	o->obj.stack = o->stack;
+	o->obj.stack_storage = o->stack;
+	tnt_object_type(s, TNT_SBO_SIMPLE);
+	return s;
+}
+
 ssize_t
 tnt_object_add_nil (struct tnt_stream *s)
 {
@@ -215,6 +234,7 @@ tnt_object_add_array (struct tnt_stream *s, uint32_t size)
 	sbo->stack[sbo->stack_size].size = 0;
 	sbo->stack[sbo->stack_size].offset = sb->size;
 	sbo->stack[sbo->stack_size].type = MP_ARRAY;
+	sbo->stack[sbo->stack_size].pending = sbo->pending_size;
 	sbo->stack_size += 1;
 	if (TNT_SOBJ_CAST(s)->type == TNT_SBO_SIMPLE) {
 		end = mp_encode_array(data, size);
@@ -250,6 +270,7 @@ tnt_object_add_map (struct tnt_stream *s, uint32_t size)
 	sbo->stack[sbo->stack_size].size = 0;
 	sbo->stack[sbo->stack_size].offset = sb->size;
 	sbo->stack[sbo->stack_size].type = MP_MAP;
+	sbo->stack[sbo->stack_size].pending = sbo->pending_size;
 	sbo->stack_size += 1;
 	if (TNT_SOBJ_CAST(s)->type == TNT_SBO_SIMPLE) {
 		end = mp_encode_map(data, size);
@@ -264,6 +285,81 @@ tnt_object_add_map (struct tnt_stream *s, uint32_t size)
 	return rv;
 }
 
+/*
+ * Header of packed container, that doesn't fit into 1 byte placeholder, is
+ * expanded later, when the outermost container is closed, so data is moved
+ * once instead of on every close.
+ */
+static int
+tnt_sbuf_object_defer(struct tnt_sbuf_object *sbo, uint32_t pos,
+		      size_t offset, uint32_t size, int8_t type)
+{
+	if (sbo->pending_size == sbo->pending_alloc) {
+		uint32_t alloc = sbo->pending_alloc ? 2 * sbo->pending_alloc : 8;
+		struct tnt_sbo_pending *pending = tnt_mem_realloc(sbo->pending,
+				alloc * sizeof(struct tnt_sbo_pending));
+		if (pending == NULL)
+			return -1;
+		sbo->pending = pending;
+		sbo->pending_alloc = alloc;
+	}
+	/* pending headers of nested containers follow the parent */
+	struct tnt_sbo_pending *p = &sbo->pending[pos];
+	memmove(p + 1, p, (sbo->pending_size - pos) *
+		sizeof(struct tnt_sbo_pending));
+	sbo->pending_size++;
+	p->offset = offset;
+	p->size = size;
+	p->type = type;
+	return 0;
+}
+
+static char *
+tnt_sbo_pending_encode(char *data, struct tnt_sbo_pending *p)
+{
+	if (p->type == MP_MAP)
+		return mp_encode_map(data, p->size/2);
+	return mp_encode_array(data, p->size);
+}
+
+static size_t
+tnt_sbo_pending_extra(struct tnt_sbo_pending *p)
+{
+	if (p->type == MP_MAP)
+		return mp_sizeof_map(p->size/2) - 1;
+	return mp_sizeof_array(p->size) - 1;
+}
+
+/*
+ * Expand all deferred headers: every byte after a placeholder is moved once
+ * by its final shift, going from the end of buffer backwards.
+ */
+static int
+tnt_sbuf_object_expand(struct tnt_stream *s)
+{
+	struct tnt_stream_buf   *sb = TNT_SBUF_CAST(s);
+	struct tnt_sbuf_object *sbo = TNT_SOBJ_CAST(s);
+	struct tnt_sbo_pending *pending = sbo->pending;
+	uint32_t count = sbo->pending_size;
+	size_t shift = 0;
+	for (uint32_t i = 0; i < count; ++i)
+		shift += tnt_sbo_pending_extra(&pending[i]);
+	if (!sb->resize(s, shift))
+		return -1;
+	size_t end = sb->size;
+	sb->size += shift;
+	for (uint32_t i = count; i > 0; --i) {
+		struct tnt_sbo_pending *p = &pending[i - 1];
+		size_t from = p->offset + 1;
+		memmove(sb->data + from + shift, sb->data + from, end - from);
+		shift -= tnt_sbo_pending_extra(p);
+		tnt_sbo_pending_encode(sb->data + p->offset + shift, p);
+		end = p->offset;
+	}
+	sbo->pending_size = 0;
+	return 0;
+}
+
 ssize_t
 tnt_object_container_close (struct tnt_stream *s)
 {
@@ -273,6 +369,7 @@ tnt_object_container_close (struct tnt_stream *s)
 	size_t       size   = sbo->stack[sbo->stack_size - 1].size;
 	enum mp_type type   = sbo->stack[sbo->stack_size - 1].type;
 	size_t       offset = sbo->stack[sbo->stack_size - 1].offset;
+	uint32_t     pending = sbo->stack[sbo->stack_size - 1].pending;
 	if (type == MP_MAP && size % 2) return -1;
 	sbo->stack_size -= 1;
 	char *lenp = sb->data + offset;
@@ -290,18 +387,17 @@ tnt_object_container_close (struct tnt_stream *s)
 			sz = mp_sizeof_map(size/2);
 		else
 			sz = mp_sizeof_array(size);
-		if (sz > 1) {
-			if (!sb->resize(s, sz - 1))
-				return -1;
-			lenp = sb->data + offset;
-			memmove(lenp + sz, lenp + 1, sb->size - offset - 1);
-		}
-		if (type == MP_MAP) {
-			mp_encode_map(sb->data + offset, size/2);
-		} else {
-			mp_encode_array(sb->data + offset, size);
+		if (sz == 1) {
+			if (type == MP_MAP)
+				mp_encode_map(lenp, size/2);
+			else
+				mp_encode_array(lenp, size);
+		} else if (tnt_sbuf_object_defer(sbo, pending, offset, size,
+						 type) == -1) {
+			return -1;
 		}
-		sb->size += (sz - 1);
+		if (sbo->stack_size == 0 && sbo->pending_size > 0)
+			return tnt_sbuf_object_expand(s);
 		return 0;
 	}
 	return -1;
@@ -476,6 +572,7 @@ int tnt_object_reset(struct tnt_stream *s)
 	sb->size = 0;
 	sb->rdoff = 0;
 	sbo->stack_size = 0;
+	sbo->pending_size = 0;
 	sbo->type = TNT_SBO_SIMPLE;
 
 	return 0;
@@ -48,9 +48,16 @@ tnt_opt_init(struct tnt_opt *opt)
 {
 	memset(opt, 0, sizeof(struct tnt_opt));
 	opt->recv_buf = 16384;
+	opt->recv_buf_max = 64 * 1024 * 1024;
 	opt->send_buf = 16384;
 	opt->tmout_connect.tv_sec = 16;
 	opt->tmout_connect.tv_usec = 0;
+	opt->reconnect_delay.tv_sec = 0;
+	opt->reconnect_delay.tv_usec = 100000;
+	opt->connect_stagger.tv_sec = 0;
+	opt->connect_stagger.tv_usec = 250000;
+	opt->sockbuf = TNT_SOCKBUF_PROBE_ONCE;
+	opt->busy_poll = 50;
 	opt->uri = tnt_mem_alloc(sizeof(struct uri));
 	if (!opt->uri) return -1;
 	return 0;
@@ -110,6 +117,89 @@ tnt_opt_set(struct tnt_opt *opt, enum tnt_opt_type name, va_list args)
 	case TNT_OPT_RECV_BUF:
 		opt->recv_buf = va_arg(args, int);
 		break;
+	case TNT_OPT_NONBLOCK:
+		opt->nonblock = va_arg(args, int);
+		break;
+	case TNT_OPT_URING:
+		opt->uring = va_arg(args, struct tnt_uring *);
+		break;
+	case TNT_OPT_REPLY_ZEROCOPY:
+		opt->reply_zerocopy = va_arg(args, int);
+		break;
+	case TNT_OPT_RECV_BUF_MAX:
+		opt->recv_buf_max = va_arg(args, int);
+		break;
+	case TNT_OPT_SEND_BORROW:
+		opt->send_borrow = va_arg(args, int);
+		break;
+	case TNT_OPT_SCHEMA:
+		opt->schema = va_arg(args, struct tnt_schema *);
+		break;
+	case TNT_OPT_RECONNECT:
+		opt->reconnect = va_arg(args, int);
+		break;
+	case TNT_OPT_RECONNECT_DELAY:
+		tvp = va_arg(args, struct timeval*);
+		memcpy(&opt->reconnect_delay, tvp, sizeof(struct timeval));
+		break;
+	case TNT_OPT_CONNECT_STAGGER:
+		tvp = va_arg(args, struct timeval*);
+		memcpy(&opt->connect_stagger, tvp, sizeof(struct timeval));
+		break;
+	case TNT_OPT_RESOLVE_TTL:
+		opt->resolve_ttl = va_arg(args, int);
+		break;
+	case TNT_OPT_SOCKBUF:
+		opt->sockbuf = va_arg(args, int);
+		break;
+	case TNT_OPT_SOCKBUF_SEND:
+		opt->sockbuf_send = va_arg(args, int);
+		break;
+	case TNT_OPT_SOCKBUF_RECV:
+		opt->sockbuf_recv = va_arg(args, int);
+		break;
+	case TNT_OPT_FLUSH_BYTES:
+		opt->flush_bytes = va_arg(args, int);
+		break;
+	case TNT_OPT_FLUSH_COUNT:
+		opt->flush_count = va_arg(args, int);
+		break;
+	case TNT_OPT_FLUSH_DELAY:
+		tvp = va_arg(args, struct timeval*);
+		memcpy(&opt->flush_delay, tvp, sizeof(struct timeval));
+		break;
+	case TNT_OPT_WINDOW:
+		opt->window = va_arg(args, int);
+		break;
+	case TNT_OPT_WINDOW_MODE:
+		opt->window_mode = va_arg(args, int);
+		break;
+	case TNT_OPT_WINDOW_ADAPTIVE:
+		opt->window_adaptive = va_arg(args, int);
+		break;
+	case TNT_OPT_REQUEST_TIMEOUT:
+		tvp = va_arg(args, struct timeval*);
+		memcpy(&opt->request_timeout, tvp, sizeof(struct timeval));
+		break;
+	case TNT_OPT_SEND_ZEROCOPY:
+		opt->send_zerocopy = va_arg(args, int);
+		break;
+	case TNT_OPT_SEND_ZEROCOPY_CB:
+		opt->send_zerocopy_cb = va_arg(args, void*);
+		break;
+	case TNT_OPT_SEND_ZEROCOPY_CB_ARG:
+		opt->send_zerocopy_cb_arg = va_arg(args, void*);
+		break;
+	case TNT_OPT_LOW_LATENCY:
+		opt->low_latency = va_arg(args, int);
+		break;
+	case TNT_OPT_BUSY_POLL:
+		opt->busy_poll = va_arg(args, int);
+		break;
+	case TNT_OPT_RECV_SPIN:
+		tvp = va_arg(args, struct timeval*);
+		memcpy(&opt->recv_spin, tvp, sizeof(struct timeval));
+		break;
 	default:
 		return TNT_EFAIL;
 	}
@@ -0,0 +1,390 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <poll.h>
+#include <sys/time.h>
+
+#include <tarantool/tnt_mem.h>
+#include <tarantool/tnt_stream.h>
+#include <tarantool/tnt_net.h>
+#include <tarantool/tnt_io.h>
+#include <tarantool/tnt_schema.h>
+#include <tarantool/tnt_pool.h>
+
+#include "pmatomic.h"
+
+#define TIMEVAL_TO_MSEC(tv) ((tv).tv_sec * 1000 + (tv).tv_usec / 1000)
+#define TIMEVAL_DIFF_MSEC(tv_end, tv_start) \
+	(((tv_end).tv_sec - (tv_start).tv_sec) * 1000 + \
+	((tv_end).tv_usec - (tv_start).tv_usec) / 1000)
+
+struct tnt_pool {
+	struct tnt_stream **conn;
+	int count;
+	int size;
+	int next; /* where the search for least loaded connection starts */
+	int owner; /* connection, that owns schema, -1 if not chosen yet */
+};
+
+struct tnt_pool *
+tnt_pool_new(void)
+{
+	struct tnt_pool *p = tnt_mem_alloc(sizeof(struct tnt_pool));
+	if (p == NULL)
+		return NULL;
+	memset(p, 0, sizeof(struct tnt_pool));
+	p->owner = -1;
+	return p;
+}
+
+static inline struct tnt_schema *
+tnt_pool_schema(struct tnt_pool *p)
+{
+	if (p->owner < 0)
+		return NULL;
+	return TNT_SNET_CAST(p->conn[p->owner])->schema;
+}
+
+void
+tnt_pool_free(struct tnt_pool *p)
+{
+	struct tnt_schema *sch = tnt_pool_schema(p);
+	int i;
+	for (i = p->count - 1; i >= 0; --i) {
+		if (i == p->owner)
+			continue;
+		struct tnt_stream_net *sn = TNT_SNET_CAST(p->conn[i]);
+		/* own empty schema of connection, that was never rebound */
+		if (sn->schema != sch)
+			sn->opt.schema = NULL;
+		tnt_stream_free(p->conn[i]);
+	}
+	/* schema owner goes last */
+	if (p->owner >= 0)
+		tnt_stream_free(p->conn[p->owner]);
+	tnt_mem_free(p->conn);
+	tnt_mem_free(p);
+}
+
+int
+tnt_pool_add(struct tnt_pool *p, const char *uri, int count)
+{
+	if (p->count + count > p->size) {
+		int size = p->size ? p->size : 4;
+		while (size < p->count + count)
+			size *= 2;
+		struct tnt_stream **conn =
+			tnt_mem_realloc(p->conn, size * sizeof(*conn));
+		if (conn == NULL)
+			return -1;
+		p->conn = conn;
+		p->size = size;
+	}
+	int i;
+	for (i = 0; i < count; ++i) {
+		struct tnt_stream *s = tnt_net(NULL);
+		if (s == NULL)
+			return -1;
+		if (tnt_set(s, TNT_OPT_URI, uri) == -1) {
+			tnt_stream_free(s);
+			return -1;
+		}
+		p->conn[p->count++] = s;
+	}
+	return 0;
+}
+
+int
+tnt_pool_set(struct tnt_pool *p, int opt, ...)
+{
+	int i, rc = 0;
+	for (i = 0; i < p->count; ++i) {
+		struct tnt_stream_net *sn = TNT_SNET_CAST(p->conn[i]);
+		va_list args;
+		va_start(args, opt);
+		sn->error = tnt_opt_set(&sn->opt, opt, args);
+		va_end(args);
+		if (sn->error != TNT_EOK)
+			rc = -1;
+	}
+	return rc;
+}
+
+static inline int
+tnt_pool_ready(struct tnt_stream *s)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	return sn->connected && sn->state == TNT_STATE_READY;
+}
+
+/*
+ * Start connecting the stream in non-blocking mode. Returns 1, if
+ * the stream is waited for.
+ */
+static int
+tnt_pool_start(struct tnt_pool *p, int i, char *blocking)
+{
+	struct tnt_stream *s = p->conn[i];
+	struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+	if (sn->opt.uring != NULL) {
+		sn->error = TNT_EFAIL;
+		return 0;
+	}
+	if (!sn->inited) {
+		sn->opt.schema = tnt_pool_schema(p);
+		if (!sn->opt.nonblock) {
+			sn->opt.nonblock = 1;
+			blocking[i] = 1;
+		}
+		if (tnt_init(s) == -1)
+			return 0;
+		/*
+		 * Until the owner is chosen, connection keeps own empty
+		 * schema, that isn't loaded on connect.
+		 */
+		if (sn->opt.schema == NULL)
+			sn->opt.schema = sn->schema;
+	} else if (!sn->opt.nonblock) {
+		/* broken blocking connection */
+		if (sn->connected)
+			tnt_close(s);
+		sn->opt.nonblock = 1;
+		blocking[i] = 1;
+	}
+	if (tnt_connect(s) == 0 || tnt_error(s) != TNT_EAGAIN)
+		return 0;
+	return 1;
+}
+
+/* owner failed to load schema, it keeps own one unloaded */
+static void
+tnt_pool_unelect(struct tnt_pool *p)
+{
+	struct tnt_stream_net *sn = TNT_SNET_CAST(p->conn[p->owner]);
+	sn->opt.schema = sn->schema;
+	p->owner = -1;
+}
+
+/*
+ * Make the first ready connection the schema owner, it loads schema
+ * for all others. Returns 1, if the owner is waited for.
+ */
+static int
+tnt_pool_elect(struct tnt_pool *p)
+{
+	int i;
+	for (i = 0; i < p->count && p->owner < 0; ++i) {
+		struct tnt_stream *s = p->conn[i];
+		struct tnt_stream_net *sn = TNT_SNET_CAST(s);
+		if (!tnt_pool_ready(s))
+			continue;
+		p->owner = i;
+		sn->opt.schema = NULL;
+		if (tnt_reload_schema(s) == 0)
+			return 0;
+		if (tnt_error(s) == TNT_EAGAIN)
+			return 1;
+		tnt_pool_unelect(p);
+	}
+	return 0;
+}
+
+/* make all other connections borrow schema of the owner */
+static void
+tnt_pool_rebind(struct tnt_pool *p)
+{
+	struct tnt_schema *sch = tnt_pool_schema(p);
+	int i;
+	for (i = 0; i < p->count; ++i) {
+		struct tnt_stream_net *sn = TNT_SNET_CAST(p->conn[i]);
+		if (i == p->owner || !sn->inited || sn->schema == sch)
+			continue;
+		tnt_schema_free(sn->schema);
+		tnt_mem_free(sn->schema);
+		sn->schema = sch;
+		sn->opt.schema = sch;
+	}
+}
+
+int
+tnt_pool_connect(struct tnt_pool *p)
+{
+	if (p->count == 0)
+		return -1;
+	char *blocking = tnt_mem_alloc(p->count);
+	int *wait = tnt_mem_alloc(p->count * sizeof(int));
+	struct pollfd *pfd = tnt_mem_alloc(p->count * sizeof(struct pollfd));
+	if (blocking == NULL || wait == NULL || pfd == NULL) {
+		tnt_mem_free(blocking);
+		tnt_mem_free(wait);
+		tnt_mem_free(pfd);
+		return -1;
+	}
+	memset(blocking, 0, p->count);
+	int i, nwait = 0, timeout = 0;
+	for (i = 0; i < p->count; ++i) {
+		if (tnt_pool_ready(p->conn[i]) ||
+		    !tnt_pool_start(p, i, blocking))
+			continue;
+		wait[nwait++] = i;
+		struct tnt_stream_net *sn = TNT_SNET_CAST(p->conn[i]);
+		if (TIMEVAL_TO_MSEC(sn->opt.tmout_connect) > timeout)
+			timeout = TIMEVAL_TO_MSEC(sn->opt.tmout_connect);
+	}
+	int electing = 0;
+	struct timeval start, now;
+	gettimeofday(&start, NULL);
+	for (;;) {
+		if (p->owner < 0 && tnt_pool_elect(p)) {
+			struct tnt_stream_net *sn =
+				TNT_SNET_CAST(p->conn[p->owner]);
+			wait[nwait++] = p->owner;
+			electing = 1;
+			if (TIMEVAL_TO_MSEC(sn->opt.tmout_connect) > timeout)
+				timeout = TIMEVAL_TO_MSEC(sn->opt.tmout_connect);
+		}
+		if (nwait == 0)
+			break;
+		int left = -1;
+		if (timeout > 0) {
+			gettimeofday(&now, NULL);
+			left = timeout - TIMEVAL_DIFF_MSEC(now, start);
+			if (left < 0)
+				left = 0;
+		}
+		for (i = 0; i < nwait; ++i) {
+			pfd[i].fd = tnt_fd(p->conn[wait[i]]);
+			pfd[i].events = tnt_events(p->conn[wait[i]]);
+			pfd[i].revents = 0;
+		}
+		int rc = poll(pfd, nwait, left);
+		if (rc == 0 || (rc == -1 && errno != EINTR)) {
+			for (i = 0; i < nwait; ++i) {
+				struct tnt_stream *s = p->conn[wait[i]];
+				tnt_close(s);
+				TNT_SNET_CAST(s)->error = TNT_ETMOUT;
+				if (rc == -1) {
+					TNT_SNET_CAST(s)->error = TNT_ESYSTEM;
+					TNT_SNET_CAST(s)->errno_ = errno;
+				}
+			}
+			break;
+		}
+		int n = 0;
+		for (i = 0; i < nwait; ++i) {
+			struct tnt_stream *s = p->conn[wait[i]];
+			if (pfd[i].revents == 0 || (tnt_connect(s) == -1 &&
+			    tnt_error(s) == TNT_EAGAIN)) {
+				wait[n++] = wait[i];
+				continue;
+			}
+			if (electing && wait[i] == p->owner) {
+				electing = 0;
+				/* another owner is elected on the next step */
+				if (!tnt_pool_ready(s))
+					tnt_pool_unelect(p);
+			}
+		}
+		nwait = n;
+	}
+	/* the owner timed out loading schema */
+	if (electing)
+		tnt_pool_unelect(p);
+	if (p->owner >= 0)
+		tnt_pool_rebind(p);
+	int ready = 0;
+	for (i = 0; i < p->count; ++i) {
+		struct tnt_stream_net *sn = TNT_SNET_CAST(p->conn[i]);
+		if (blocking[i]) {
+			sn->opt.nonblock = 0;
+			if (tnt_pool_ready(p->conn[i]) &&
+			    (sn->error = tnt_io_nonblock(sn, 0)) != TNT_EOK)
+				tnt_close(p->conn[i]);
+		}
+		if (tnt_pool_ready(p->conn[i]))
+			ready++;
+	}
+	tnt_mem_free(blocking);
+	tnt_mem_free(wait);
+	tnt_mem_free(pfd);
+	return ready > 0 ? ready : -1;
+}
+
+struct tnt_stream *
+tnt_pool_get(struct tnt_pool *p)
+{
+	struct tnt_stream *best = NULL;
+	uint32_t best_wrcnt = UINT32_MAX;
+	int i, pos = 0;
+	for (i = 0; i < p->count; ++i) {
+		int j = (p->next + i) % p->count;
+		struct tnt_stream *s = p->conn[j];
+		if (!tnt_pool_ready(s))
+			continue;
+		uint32_t wrcnt = pm_atomic_load(&s->wrcnt);
+		if (best == NULL || wrcnt < best_wrcnt) {
+			best = s;
+			best_wrcnt = wrcnt;
+			pos = j;
+			if (wrcnt == 0)
+				break;
+		}
+	}
+	if (best != NULL)
+		p->next = (pos + 1) % p->count;
+	return best;
+}
+
+int
+tnt_pool_count(struct tnt_pool *p)
+{
+	return p->count;
+}
+
+struct tnt_stream *
+tnt_pool_owner(struct tnt_pool *p)
+{
+	if (p->owner < 0)
+		return NULL;
+	return p->conn[p->owner];
+}
+
+struct tnt_stream *
+tnt_pool_stream(struct tnt_pool *p, int i)
+{
+	if (i < 0 || i >= p->count)
+		return NULL;
+	return p->conn[i];
+}
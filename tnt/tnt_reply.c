@@ -32,17 +32,19 @@
 #include <string.h>
 
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #include <msgpuck.h>
 
 #include <tarantool/tnt_mem.h>
 #include <tarantool/tnt_proto.h>
 #include <tarantool/tnt_reply.h>
+#include <tarantool/tnt_iob.h>
 
 struct tnt_reply *tnt_reply_init(struct tnt_reply *r) {
 	int alloc = (r == NULL);
 	if (alloc) {
-		r = tnt_mem_alloc(sizeof(struct tnt_reply));
+		r = tnt_mem_pool_alloc(sizeof(struct tnt_reply));
 		if (!r) return NULL;
 	}
 	memset(r, 0, sizeof(struct tnt_reply));
@@ -50,19 +52,42 @@ struct tnt_reply *tnt_reply_init(struct tnt_reply *r) {
 	return r;
 }
 
+static void tnt_reply_buf_free(struct tnt_reply *r) {
+	if (r->buf_mem != NULL)
+		tnt_mem_ctx_free(r->buf_mem, (void *)r->buf);
+	else
+		tnt_mem_pool_free_data((void *)r->buf, r->buf_alloc);
+	r->buf_mem = NULL;
+}
+
 void tnt_reply_free(struct tnt_reply *r) {
+	if (r->pin) {
+		/* buf points into receive buffer */
+		tnt_iob_unpin(r->pin);
+		r->pin = NULL;
+		r->buf = NULL;
+	}
 	if (r->buf) {
-		tnt_mem_free((void *)r->buf);
+		tnt_reply_buf_free(r);
 		r->buf = NULL;
 	}
-	if (r->alloc) tnt_mem_free(r);
+	if (r->alloc) tnt_mem_pool_free(r, sizeof(struct tnt_reply));
 }
 
 int tnt_reply_from(struct tnt_reply *r, tnt_reply_t rcv, void *ptr) {
+	return tnt_reply_from_mem(r, rcv, ptr, NULL);
+}
+
+int tnt_reply_from_mem(struct tnt_reply *r, tnt_reply_t rcv, void *ptr,
+		       struct tnt_mem_ctx *mem) {
 	/* cleanup, before processing response */
 	int alloc = r->alloc;
+	struct tnt_mem_ctx *own = r->mem;
 	memset(r, 0 , sizeof(struct tnt_reply));
 	r->alloc = alloc;
+	r->mem = own;
+	if (own != NULL)
+		mem = own;
 	/* reading iproto header */
 	char length[TNT_REPLY_IPROTO_HDR_SIZE]; const char *data = (const char *)length;
 	if (rcv(ptr, length, sizeof(length)) == -1)
@@ -70,7 +95,11 @@ int tnt_reply_from(struct tnt_reply *r, tnt_reply_t rcv, void *ptr) {
 	if (mp_typeof(*length) != MP_UINT)
 		goto rollback;
 	size_t size = mp_decode_uint(&data);
-	r->buf = tnt_mem_alloc(size);
+	if (mem != NULL)
+		r->buf = tnt_mem_ctx_alloc(mem, size);
+	else
+		r->buf = tnt_mem_pool_alloc_data(size, &r->buf_alloc);
+	r->buf_mem = mem;
 	r->buf_size = size;
 	if (r->buf == NULL)
 		goto rollback;
@@ -86,10 +115,11 @@ int tnt_reply_from(struct tnt_reply *r, tnt_reply_t rcv, void *ptr) {
 
 	return 0;
 rollback:
-	if (r->buf) tnt_mem_free((void *)r->buf);
+	if (r->buf) tnt_reply_buf_free(r);
 	alloc = r->alloc;
 	memset(r, 0, sizeof(struct tnt_reply));
 	r->alloc = alloc;
+	r->mem = own;
 	return -1;
 }
 
@@ -237,6 +267,12 @@ tnt_reply_body0(struct tnt_reply *r, const char *buf, size_t size, size_t *off)
 
 int
 tnt_reply(struct tnt_reply *r, char *buf, size_t size, size_t *off) {
+	return tnt_reply_mem(r, buf, size, off, NULL);
+}
+
+int
+tnt_reply_mem(struct tnt_reply *r, char *buf, size_t size, size_t *off,
+	      struct tnt_mem_ctx *mem) {
 	/* supplied buffer must contain full reply,
 	 * if it doesn't then returning count of bytes
 	 * needed to process */
@@ -258,7 +294,7 @@ tnt_reply(struct tnt_reply *r, char *buf, size_t size, size_t *off) {
 	}
 	size_t offv = 0;
 	void *ptr[2] = { buf, &offv };
-	int rc = tnt_reply_from(r, (tnt_reply_t)tnt_reply_cb, ptr);
+	int rc = tnt_reply_from_mem(r, (tnt_reply_t)tnt_reply_cb, ptr, mem);
 	if (off)
 		*off = offv;
 	return rc;
@@ -12,8 +12,9 @@
 #include <tarantool/tnt_reply.h>
 #include <tarantool/tnt_stream.h>
 #include <tarantool/tnt_net.h>
-#include <tarantool/tnt_object.h>
 #include <tarantool/tnt_buf.h>
+#include <tarantool/tnt_object.h>
+#include <tarantool/tnt_format.h>
 #include <tarantool/tnt_proto.h>
 #include <tarantool/tnt_schema.h>
 
@@ -24,7 +25,7 @@
 struct tnt_request *tnt_request_init(struct tnt_request *req) {
 	int alloc = (req == NULL);
 	if (req == NULL) {
-		req = tnt_mem_alloc(sizeof(struct tnt_request));
+		req = tnt_mem_pool_alloc(sizeof(struct tnt_request));
 		if (!req) return NULL;
 	}
 	memset(req, 0, sizeof(struct tnt_request));
@@ -33,14 +34,24 @@ struct tnt_request *tnt_request_init(struct tnt_request *req) {
 	return req;
 };
 
+/* key (tuple) object is freed as a whole inline object */
+static void
+tnt_request_object_free(struct tnt_stream **obj)
+{
+	if (*obj == NULL)
+		return;
+	(*obj)->alloc = 0;
+	tnt_stream_free(*obj);
+	tnt_mem_pool_free(*obj, sizeof(struct tnt_object_inline));
+	*obj = NULL;
+}
+
 void tnt_request_free(struct tnt_request *req) {
-	if (req->key_object)
-		tnt_stream_free(req->key_object);
-	req->key_object = NULL;
-	if (req->tuple_object)
-		tnt_stream_free(req->tuple_object);
-	req->tuple_object = NULL;
-	if (req->alloc) tnt_mem_free(req);
+	tnt_request_object_free(&req->key_object);
+	tnt_request_object_free(&req->tuple_object);
+	tnt_mem_free(req->tmpl);
+	req->tmpl = NULL;
+	if (req->alloc) tnt_mem_pool_free(req, sizeof(struct tnt_request));
 }
 
 #define TNT_REQUEST_CUSTOM(NM, CNM)				\
@@ -110,13 +121,27 @@ int tnt_request_set_key(struct tnt_request *req, struct tnt_stream *s)
 	return 0;
 }
 
+/*
+ * Key (tuple) object of request, emptied for new value. It's allocated as
+ * a single inline object, so small keys cost one allocation per request.
+ */
+static struct tnt_stream *
+tnt_request_object(struct tnt_stream **obj)
+{
+	if (*obj) {
+		tnt_object_reset(*obj);
+		return *obj;
+	}
+	struct tnt_object_inline *o = tnt_mem_pool_alloc(sizeof(*o));
+	if (o == NULL)
+		return NULL;
+	*obj = tnt_object_inline(o);
+	return *obj;
+}
+
 int tnt_request_set_key_format(struct tnt_request *req, const char *fmt, ...)
 {
-	if (req->key_object)
-		tnt_object_reset(req->key_object);
-	else
-		req->key_object = tnt_object(NULL);
-	if (!req->key_object)
+	if (!tnt_request_object(&req->key_object))
 		return -1;
 	va_list args;
 	va_start(args, fmt);
@@ -127,6 +152,21 @@ int tnt_request_set_key_format(struct tnt_request *req, const char *fmt, ...)
 	return tnt_request_set_key(req, req->key_object);
 }
 
+
+int tnt_request_set_key_compiled(struct tnt_request *req,
+				 const struct tnt_format *fmt, ...)
+{
+	if (!tnt_request_object(&req->key_object))
+		return -1;
+	va_list args;
+	va_start(args, fmt);
+	ssize_t res = tnt_format_vencode(req->key_object, fmt, args);
+	va_end(args);
+	if (res == -1)
+		return -1;
+	return tnt_request_set_key(req, req->key_object);
+}
+
 int
 tnt_request_set_func(struct tnt_request *req, const char *func,
 		     uint32_t flen)
@@ -197,11 +237,7 @@ int tnt_request_set_tuple(struct tnt_request *req, struct tnt_stream *s)
 
 int tnt_request_set_tuple_format(struct tnt_request *req, const char *fmt, ...)
 {
-	if (req->tuple_object)
-		tnt_object_reset(req->tuple_object);
-	else
-		req->tuple_object = tnt_object(NULL);
-	if (!req->tuple_object)
+	if (!tnt_request_object(&req->tuple_object))
 		return -1;
 	va_list args;
 	va_start(args, fmt);
@@ -212,28 +248,50 @@ int tnt_request_set_tuple_format(struct tnt_request *req, const char *fmt, ...)
 	return tnt_request_set_tuple(req, req->tuple_object);
 }
 
-int
-tnt_request_writeout(struct tnt_stream *s, struct tnt_request *req,
-		     uint64_t *sync) {
+int tnt_request_set_tuple_compiled(struct tnt_request *req,
+				   const struct tnt_format *fmt, ...)
+{
+	if (!tnt_request_object(&req->tuple_object))
+		return -1;
+	va_list args;
+	va_start(args, fmt);
+	ssize_t res = tnt_format_vencode(req->tuple_object, fmt, args);
+	va_end(args);
+	if (res == -1)
+		return -1;
+	return tnt_request_set_tuple(req, req->tuple_object);
+}
+
+/*
+ * Encode request into v: header part, with room for length prefix
+ * before it, lives in header, key and tuple are referenced in place and
+ * their iovec indexes are stored into key_v and tuple_v (-1 if absent).
+ * A prepared template has to patch sync later, so its sync is encoded
+ * as uint64 of fixed size then, and length is always a 5 byte uint32.
+ */
+static int
+tnt_request_encode(struct tnt_request *req, char *header, struct iovec *v,
+		   int *key_v, int *tuple_v, int prepare)
+{
 	enum tnt_request_t tp = req->hdr.type;
-	if (sync != NULL && *sync == INT64_MAX &&
-	    (s->reqid & INT64_MAX) == INT64_MAX) {
-		s->reqid = 0;
-	}
-	req->hdr.sync = s->reqid++;
 	/* header */
 	/* int (9) + 1 + sync + 1 + op */
-	struct iovec v[10]; int v_sz = 0;
-	char header[128];
+	int v_sz = 0;
 	char *pos = header + 9;
 	char *begin = pos;
 	v[v_sz].iov_base = begin;
 	v[v_sz++].iov_len  = 0;
+	*key_v = *tuple_v = -1;
 	pos = mp_encode_map(pos, 2);              /* 1 */
 	pos = mp_encode_uint(pos, TNT_CODE);      /* 1 */
 	pos = mp_encode_uint(pos, req->hdr.type); /* 1 */
 	pos = mp_encode_uint(pos, TNT_SYNC);      /* 1 */
-	pos = mp_encode_uint(pos, req->hdr.sync); /* 9 */
+	if (prepare) {
+		pos = mp_store_u8(pos, 0xcf);             /* 1 */
+		pos = mp_store_u64(pos, req->hdr.sync);   /* 8 */
+	} else {
+		pos = mp_encode_uint(pos, req->hdr.sync); /* 9 */
+	}
 	char *map = pos++;                        /* 1 */
 	size_t nd = 0;
 	if (tp < TNT_OP_CALL_16 || tp == TNT_OP_UPSERT) {
@@ -288,6 +346,7 @@ tnt_request_writeout(struct tnt_stream *s, struct tnt_request *req,
 		v[v_sz].iov_base  = begin;
 		v[v_sz++].iov_len = pos - begin;
 		begin = pos;
+		*key_v = v_sz;
 		v[v_sz].iov_base  = (void *)req->key;
 		v[v_sz++].iov_len = req->key_end - req->key;
 		nd += 1;
@@ -297,6 +356,7 @@ tnt_request_writeout(struct tnt_stream *s, struct tnt_request *req,
 		v[v_sz].iov_base  = begin;
 		v[v_sz++].iov_len = pos - begin;
 		begin = pos;
+		*tuple_v = v_sz;
 		v[v_sz].iov_base  = (void *)req->tuple;
 		v[v_sz++].iov_len = req->tuple_end - req->tuple;
 		nd += 1;
@@ -315,10 +375,143 @@ tnt_request_writeout(struct tnt_stream *s, struct tnt_request *req,
 
 	size_t plen = 0;
 	for (int i = 1; i < v_sz; ++i) plen += v[i].iov_len;
-	size_t hlen = mp_sizeof_luint32(plen);
+	size_t hlen = prepare ? 1 + sizeof(uint32_t) : mp_sizeof_luint32(plen);
 	v[0].iov_base -= hlen;
 	v[0].iov_len  += hlen;
-	mp_encode_luint32(v[0].iov_base, plen);
+	if (prepare) {
+		/* real length is stored by tnt_request_writeout */
+		mp_store_u32(mp_store_u8(v[0].iov_base, 0xce), 0);
+	} else {
+		mp_encode_luint32(v[0].iov_base, plen);
+	}
+	return v_sz;
+}
+
+/* function name and expression are a part of template */
+static inline int
+tnt_request_key_fixed(struct tnt_request *req)
+{
+	return req->hdr.type == TNT_OP_EVAL || is_call(req->hdr.type);
+}
+
+/*
+ * Write prepared request. Length prefix and header, that ends with sync,
+ * are patched in a copy, so template stays intact, while its previous
+ * writes may be still referenced by send queue.
+ */
+static int
+tnt_request_writeout_prepared(struct tnt_stream *s, struct tnt_request *req)
+{
+	/* presence of key and tuple is fixed by template */
+	if ((!tnt_request_key_fixed(req) &&
+	     (req->tmpl_key != -1) != (req->key != NULL)) ||
+	    (req->tmpl_tuple != -1) != (req->tuple != NULL))
+		return -1;
+	size_t plen = req->tmpl_size - (1 + sizeof(uint32_t));
+	if (req->tmpl_key != -1)
+		plen += req->key_end - req->key;
+	if (req->tmpl_tuple != -1)
+		plen += req->tuple_end - req->tuple;
+	if (plen > UINT32_MAX)
+		return -1;
+	char header[32];
+	assert(req->tmpl_hdr <= sizeof(header));
+	memcpy(header, req->tmpl, req->tmpl_hdr);
+	mp_store_u32(header + 1, plen);
+	mp_store_u64(header + req->tmpl_hdr - sizeof(uint64_t),
+		     req->hdr.sync);
+	struct iovec v[6];
+	int v_sz = 0;
+	v[v_sz].iov_base  = header;
+	v[v_sz++].iov_len = req->tmpl_hdr;
+	size_t off = req->tmpl_hdr;
+	if (req->tmpl_key != -1) {
+		v[v_sz].iov_base  = req->tmpl + off;
+		v[v_sz++].iov_len = req->tmpl_key - off;
+		v[v_sz].iov_base  = (void *)req->key;
+		v[v_sz++].iov_len = req->key_end - req->key;
+		off = req->tmpl_key;
+	}
+	if (req->tmpl_tuple != -1) {
+		v[v_sz].iov_base  = req->tmpl + off;
+		v[v_sz++].iov_len = req->tmpl_tuple - off;
+		v[v_sz].iov_base  = (void *)req->tuple;
+		v[v_sz++].iov_len = req->tuple_end - req->tuple;
+		off = req->tmpl_tuple;
+	}
+	if (off < req->tmpl_size) {
+		v[v_sz].iov_base  = req->tmpl + off;
+		v[v_sz++].iov_len = req->tmpl_size - off;
+	}
+	return s->writev(s, v, v_sz) == -1 ? -1 : 0;
+}
+
+int
+tnt_request_prepare(struct tnt_request *req)
+{
+	struct iovec v[10];
+	char header[128];
+	int key_v, tuple_v;
+	int v_sz = tnt_request_encode(req, header, v, &key_v, &tuple_v, 1);
+	if (v_sz == -1)
+		return -1;
+	if (tnt_request_key_fixed(req))
+		key_v = -1;
+	size_t size = 0;
+	for (int i = 0; i < v_sz; ++i) {
+		if (i != key_v && i != tuple_v)
+			size += v[i].iov_len;
+	}
+	char *tmpl = tnt_mem_alloc(size);
+	if (tmpl == NULL)
+		return -1;
+	size_t off = 0;
+	for (int i = 0; i < v_sz; ++i) {
+		if (i == key_v) {
+			req->tmpl_key = off;
+			continue;
+		}
+		if (i == tuple_v) {
+			req->tmpl_tuple = off;
+			continue;
+		}
+		memcpy(tmpl + off, v[i].iov_base, v[i].iov_len);
+		off += v[i].iov_len;
+	}
+	if (key_v == -1)
+		req->tmpl_key = -1;
+	if (tuple_v == -1)
+		req->tmpl_tuple = -1;
+	/* length, map(2), code key, code, sync key, uint64 sync */
+	req->tmpl_hdr = 1 + sizeof(uint32_t) + 3 +
+			mp_sizeof_uint(req->hdr.type) + 1 + sizeof(uint64_t);
+	tnt_mem_free(req->tmpl);
+	req->tmpl = tmpl;
+	req->tmpl_size = size;
+	return 0;
+}
+
+int
+tnt_request_writeout(struct tnt_stream *s, struct tnt_request *req,
+		     uint64_t *sync) {
+	if (sync != NULL && *sync == INT64_MAX &&
+	    (s->reqid & INT64_MAX) == INT64_MAX) {
+		s->reqid = 0;
+	}
+	req->hdr.sync = s->reqid++;
+	if (req->tmpl != NULL) {
+		if (tnt_request_writeout_prepared(s, req) == -1)
+			return -1;
+		if (sync != NULL)
+			*sync = req->hdr.sync;
+		return 0;
+	}
+	struct iovec v[10];
+	char header[128];
+	int key_v, tuple_v;
+	int v_sz = tnt_request_encode(req, header, v, &key_v, &tuple_v, 0);
+	if (v_sz == -1)
+		return -1;
 	ssize_t rv = s->writev(s, v, v_sz);
 	if (rv == -1)
 		return -1;
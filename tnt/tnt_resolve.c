@@ -0,0 +1,190 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <pthread.h>
+
+#include <tarantool/tnt_mem.h>
+
+#include "tnt_resolve.h"
+
+#define TNT_RESOLVE_CACHE_SIZE 64
+
+struct tnt_resolve_entry {
+	char *host;
+	char *port;
+	struct tnt_addr *addrs;
+	int count;
+	time_t resolved; /* CLOCK_MONOTONIC seconds */
+};
+
+static struct tnt_resolve_entry tnt_resolve_cache[TNT_RESOLVE_CACHE_SIZE];
+static pthread_mutex_t tnt_resolve_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static time_t
+tnt_resolve_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+static struct tnt_addr *
+tnt_resolve_dup(const struct tnt_addr *addrs, int count)
+{
+	struct tnt_addr *copy = tnt_mem_alloc(count * sizeof(struct tnt_addr));
+	if (copy != NULL)
+		memcpy(copy, addrs, count * sizeof(struct tnt_addr));
+	return copy;
+}
+
+/* cached copy of addresses, or -1 if there's no valid entry */
+static int
+tnt_resolve_cached(const char *host, const char *port, int ttl,
+		   struct tnt_addr **addrs)
+{
+	int i, count = -1;
+	time_t now = tnt_resolve_now();
+	pthread_mutex_lock(&tnt_resolve_lock);
+	for (i = 0; i < TNT_RESOLVE_CACHE_SIZE; ++i) {
+		struct tnt_resolve_entry *e = &tnt_resolve_cache[i];
+		if (e->host == NULL || strcmp(e->host, host) != 0 ||
+		    strcmp(e->port, port) != 0)
+			continue;
+		if (now - e->resolved < ttl &&
+		    (*addrs = tnt_resolve_dup(e->addrs, e->count)) != NULL)
+			count = e->count;
+		break;
+	}
+	pthread_mutex_unlock(&tnt_resolve_lock);
+	return count;
+}
+
+/* replace entry of the same host and port, or the oldest one */
+static void
+tnt_resolve_store(const char *host, const char *port,
+		  const struct tnt_addr *addrs, int count)
+{
+	struct tnt_addr *copy = tnt_resolve_dup(addrs, count);
+	char *host_copy = tnt_mem_dup((char *)host);
+	char *port_copy = tnt_mem_dup((char *)port);
+	if (copy == NULL || host_copy == NULL || port_copy == NULL) {
+		tnt_mem_free(copy);
+		tnt_mem_free(host_copy);
+		tnt_mem_free(port_copy);
+		return;
+	}
+	pthread_mutex_lock(&tnt_resolve_lock);
+	struct tnt_resolve_entry *e = &tnt_resolve_cache[0];
+	int i;
+	for (i = 0; i < TNT_RESOLVE_CACHE_SIZE; ++i) {
+		struct tnt_resolve_entry *it = &tnt_resolve_cache[i];
+		if (it->host == NULL || (strcmp(it->host, host) == 0 &&
+					 strcmp(it->port, port) == 0)) {
+			e = it;
+			break;
+		}
+		if (it->resolved < e->resolved)
+			e = it;
+	}
+	tnt_mem_free(e->host);
+	tnt_mem_free(e->port);
+	tnt_mem_free(e->addrs);
+	e->host = host_copy;
+	e->port = port_copy;
+	e->addrs = copy;
+	e->count = count;
+	e->resolved = tnt_resolve_now();
+	pthread_mutex_unlock(&tnt_resolve_lock);
+}
+
+int
+tnt_resolve(const char *host, const char *port, int ttl,
+	    struct tnt_addr **addrs)
+{
+	int count;
+	if (ttl > 0 && (count = tnt_resolve_cached(host, port, ttl, addrs)) > 0)
+		return count;
+	struct addrinfo *addr_info = NULL;
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+	if (getaddrinfo(host, port, &hints, &addr_info) != 0 ||
+	    addr_info == NULL)
+		return -1;
+	struct addrinfo *ai;
+	count = 0;
+	for (ai = addr_info; ai != NULL; ai = ai->ai_next)
+		count++;
+	struct tnt_addr *list = tnt_mem_alloc(count * sizeof(struct tnt_addr));
+	if (list == NULL) {
+		freeaddrinfo(addr_info);
+		return -1;
+	}
+	/* first family and the other ones take turns */
+	int family = addr_info->ai_family;
+	struct addrinfo *first = addr_info, *other = addr_info;
+	int i;
+	for (i = 0; i < count; ++i) {
+		int want_first = (i % 2 == 0);
+		while (first != NULL && first->ai_family != family)
+			first = first->ai_next;
+		while (other != NULL && other->ai_family == family)
+			other = other->ai_next;
+		if (first == NULL)
+			want_first = 0;
+		if (other == NULL)
+			want_first = 1;
+		ai = want_first ? first : other;
+		if (want_first)
+			first = first->ai_next;
+		else
+			other = other->ai_next;
+		struct tnt_addr *a = &list[i];
+		memset(a, 0, sizeof(struct tnt_addr));
+		a->family = ai->ai_family;
+		a->socktype = ai->ai_socktype;
+		a->protocol = ai->ai_protocol;
+		a->len = ai->ai_addrlen;
+		memcpy(&a->addr, ai->ai_addr, ai->ai_addrlen);
+	}
+	freeaddrinfo(addr_info);
+	if (ttl > 0)
+		tnt_resolve_store(host, port, list, count);
+	*addrs = list;
+	return count;
+}
@@ -0,0 +1,49 @@
+#ifndef TNT_RESOLVE_H_INCLUDED
+#define TNT_RESOLVE_H_INCLUDED
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+/*!
+ * \internal
+ * \file tnt_resolve.h
+ * \brief Name resolution with process-wide cache
+ */
+
+struct tnt_addr {
+	int family;
+	int socktype;
+	int protocol;
+	socklen_t len;
+	struct sockaddr_storage addr;
+};
+
+/*!
+ * \brief Resolve host and port into addresses
+ *
+ * Addresses are ordered for connection attempts: address families
+ * are interleaved, starting with the first one returned by resolver
+ * (RFC 8305). Result is cached for ttl seconds and shared by all streams.
+ *
+ * \param host  host name or address
+ * \param port  service name or port
+ * \param ttl   seconds, cached result is valid for (0 - resolve anyway
+ *              and don't cache)
+ * \param addrs array of addresses, freed by tnt_mem_free()
+ *
+ * \returns count of addresses
+ * \retval  -1 failed to resolve or oom
+ */
+int
+tnt_resolve(const char *host, const char *port, int ttl,
+	    struct tnt_addr **addrs);
+
+#if defined(__cplusplus)
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* TNT_RESOLVE_H_INCLUDED */
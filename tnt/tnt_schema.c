@@ -19,13 +19,13 @@
 #include "tnt_assoc.h"
 
 static inline void
-tnt_schema_ival_free(struct tnt_schema_ival *val) {
-	if (val) tnt_mem_free((void *)val->name);
-	tnt_mem_free(val);
+tnt_schema_ival_free(struct tnt_mem_ctx *mem, struct tnt_schema_ival *val) {
+	if (val) tnt_mem_ctx_free(mem, (void *)val->name);
+	tnt_mem_ctx_free(mem, val);
 }
 
 static inline void
-tnt_schema_index_free(struct mh_assoc_t *schema) {
+tnt_schema_index_free(struct tnt_mem_ctx *mem, struct mh_assoc_t *schema) {
 	mh_int_t pos = 0;
 	mh_int_t index_slot = 0;
 	mh_foreach(schema, pos) {
@@ -54,26 +54,26 @@ tnt_schema_index_free(struct mh_assoc_t *schema) {
 			av2 = *mh_assoc_node(schema, index_slot);
 			mh_assoc_del(schema, index_slot, NULL);
 		} while (0);
-		tnt_schema_ival_free(ival);
-		if (av1) tnt_mem_free((void *)av1);
-		if (av2) tnt_mem_free((void *)av2);
+		tnt_schema_ival_free(mem, ival);
+		if (av1) tnt_mem_ctx_free(mem, (void *)av1);
+		if (av2) tnt_mem_ctx_free(mem, (void *)av2);
 	}
 }
 
 static inline void
-tnt_schema_sval_free(struct tnt_schema_sval *val) {
+tnt_schema_sval_free(struct tnt_mem_ctx *mem, struct tnt_schema_sval *val) {
 	if (val) {
-		tnt_mem_free(val->name);
+		tnt_mem_ctx_free(mem, val->name);
 		if (val->index) {
-			tnt_schema_index_free(val->index);
+			tnt_schema_index_free(mem, val->index);
 			mh_assoc_delete(val->index);
 		}
 	}
-	tnt_mem_free(val);
+	tnt_mem_ctx_free(mem, val);
 }
 
 static inline void
-tnt_schema_space_free(struct mh_assoc_t *schema) {
+tnt_schema_space_free(struct tnt_mem_ctx *mem, struct mh_assoc_t *schema) {
 	mh_int_t pos = 0;
 	mh_int_t space_slot = 0;
 	mh_foreach(schema, pos) {
@@ -102,14 +102,15 @@ tnt_schema_space_free(struct mh_assoc_t *schema) {
 			av2 = *mh_assoc_node(schema, space_slot);
 			mh_assoc_del(schema, space_slot, NULL);
 		} while (0);
-		tnt_schema_sval_free(sval);
-		if (av1) tnt_mem_free((void *)av1);
-		if (av2) tnt_mem_free((void *)av2);
+		tnt_schema_sval_free(mem, sval);
+		if (av1) tnt_mem_ctx_free(mem, (void *)av1);
+		if (av2) tnt_mem_ctx_free(mem, (void *)av2);
 	}
 }
 
 static inline int
-tnt_schema_add_space(struct mh_assoc_t *schema, const char **data)
+tnt_schema_add_space(struct tnt_mem_ctx *mem, struct mh_assoc_t *schema,
+		     const char **data)
 {
 	struct tnt_schema_sval *space = NULL;
 	struct assoc_val *space_string = NULL, *space_number = NULL;
@@ -117,7 +118,7 @@ tnt_schema_add_space(struct mh_assoc_t *schema, const char **data)
 	if (mp_typeof(*tuple) != MP_ARRAY)
 		goto error;
 	uint32_t tuple_len = mp_decode_array(&tuple); (void )tuple_len;
-	space = tnt_mem_alloc(sizeof(struct tnt_schema_sval));
+	space = tnt_mem_ctx_alloc(mem, sizeof(struct tnt_schema_sval));
 	if (!space)
 		goto error;
 	memset(space, 0, sizeof(struct tnt_schema_sval));
@@ -128,7 +129,7 @@ tnt_schema_add_space(struct mh_assoc_t *schema, const char **data)
 	if (mp_typeof(*tuple) != MP_STR)
 		goto error;
 	const char *name_tmp = mp_decode_str(&tuple, &space->name_len);
-	space->name = tnt_mem_alloc(space->name_len);
+	space->name = tnt_mem_ctx_alloc(mem, space->name_len);
 	if (!space->name)
 		goto error;
 	memcpy(space->name, name_tmp, space->name_len);
@@ -136,13 +137,13 @@ tnt_schema_add_space(struct mh_assoc_t *schema, const char **data)
 	space->index = mh_assoc_new();
 	if (!space->index)
 		goto error;
-	space_string = tnt_mem_alloc(sizeof(struct assoc_val));
+	space_string = tnt_mem_ctx_alloc(mem, sizeof(struct assoc_val));
 	if (!space_string)
 		goto error;
 	space_string->key.id     = space->name;
 	space_string->key.id_len = space->name_len;
 	space_string->data = space;
-	space_number = tnt_mem_alloc(sizeof(struct assoc_val));
+	space_number = tnt_mem_ctx_alloc(mem, sizeof(struct assoc_val));
 	if (!space_number)
 		goto error;
 	space_number->key.id = (void *)&(space->number);
@@ -156,9 +157,9 @@ tnt_schema_add_space(struct mh_assoc_t *schema, const char **data)
 	return 0;
 error:
 	mp_next(data);
-	tnt_schema_sval_free(space);
-	if (space_string) tnt_mem_free(space_string);
-	if (space_number) tnt_mem_free(space_number);
+	tnt_schema_sval_free(mem, space);
+	if (space_string) tnt_mem_ctx_free(mem, space_string);
+	if (space_number) tnt_mem_ctx_free(mem, space_number);
 	return -1;
 }
 
@@ -172,14 +173,15 @@ int tnt_schema_add_spaces(struct tnt_schema *schema_obj, struct tnt_reply *r) {
 		return -1;
 	uint32_t space_count = mp_decode_array(&tuple);
 	while (space_count-- > 0) {
-		if (tnt_schema_add_space(schema, &tuple))
+		if (tnt_schema_add_space(schema_obj->mem, schema, &tuple))
 			return -1;
 	}
 	return 0;
 }
 
 static inline int
-tnt_schema_add_index(struct mh_assoc_t *schema, const char **data) {
+tnt_schema_add_index(struct tnt_mem_ctx *mem, struct mh_assoc_t *schema,
+		     const char **data) {
 	const struct tnt_schema_sval *space = NULL;
 	struct tnt_schema_ival *index = NULL;
 	struct assoc_val *index_number = NULL, *index_string = NULL;
@@ -198,7 +200,7 @@ tnt_schema_add_index(struct mh_assoc_t *schema, const char **data) {
 	if (space_slot == mh_end(schema))
 		return -1;
 	space = (*mh_assoc_node(schema, space_slot))->data;
-	index = tnt_mem_alloc(sizeof(struct tnt_schema_ival));
+	index = tnt_mem_ctx_alloc(mem, sizeof(struct tnt_schema_ival));
 	if (!index)
 		goto error;
 	memset(index, 0, sizeof(struct tnt_schema_ival));
@@ -208,17 +210,17 @@ tnt_schema_add_index(struct mh_assoc_t *schema, const char **data) {
 	if (mp_typeof(*tuple) != MP_STR)
 		goto error;
 	const char *name_tmp = mp_decode_str(&tuple, &index->name_len);
-	index->name = tnt_mem_alloc(index->name_len);
+	index->name = tnt_mem_ctx_alloc(mem, index->name_len);
 	if (!index->name)
 		goto error;
 	memcpy((void *)index->name, name_tmp, index->name_len);
 
-	index_string = tnt_mem_alloc(sizeof(struct assoc_val));
+	index_string = tnt_mem_ctx_alloc(mem, sizeof(struct assoc_val));
 	if (!index_string) goto error;
 	index_string->key.id     = index->name;
 	index_string->key.id_len = index->name_len;
 	index_string->data = index;
-	index_number = tnt_mem_alloc(sizeof(struct assoc_val));
+	index_number = tnt_mem_ctx_alloc(mem, sizeof(struct assoc_val));
 	if (!index_number) goto error;
 	index_number->key.id     = (void *)&(index->number);
 	index_number->key.id_len = sizeof(uint32_t);
@@ -231,9 +233,9 @@ tnt_schema_add_index(struct mh_assoc_t *schema, const char **data) {
 	return 0;
 error:
 	mp_next(data);
-	if (index_string) tnt_mem_free(index_string);
-	if (index_number) tnt_mem_free(index_number);
-	tnt_schema_ival_free(index);
+	if (index_string) tnt_mem_ctx_free(mem, index_string);
+	if (index_number) tnt_mem_ctx_free(mem, index_number);
+	tnt_schema_ival_free(mem, index);
 	return -1;
 }
 
@@ -247,7 +249,7 @@ int tnt_schema_add_indexes(struct tnt_schema *schema_obj, struct tnt_reply *r) {
 		return -1;
 	uint32_t space_count = mp_decode_array(&tuple);
 	while (space_count-- > 0) {
-		if (tnt_schema_add_index(schema, &tuple))
+		if (tnt_schema_add_index(schema_obj->mem, schema, &tuple))
 			return -1;
 	}
 	return 0;
@@ -291,17 +293,18 @@ struct tnt_schema *tnt_schema_new(struct tnt_schema *s) {
 	}
 	s->space_hash = mh_assoc_new();
 	s->alloc = alloc;
+	s->mem = NULL;
 	return s;
 }
 
 void tnt_schema_flush(struct tnt_schema *obj) {
-	tnt_schema_space_free(obj->space_hash);
+	tnt_schema_space_free(obj->mem, obj->space_hash);
 }
 
 void tnt_schema_free(struct tnt_schema *obj) {
 	if (obj == NULL)
 		return;
-	tnt_schema_space_free(obj->space_hash);
+	tnt_schema_space_free(obj->mem, obj->space_hash);
 	mh_assoc_delete(obj->space_hash);
 }
 
@@ -52,7 +52,7 @@ tnt_stream_init(struct tnt_stream *s)
 {
 	int alloc = (s == NULL);
 	if (alloc) {
-		s = tnt_mem_alloc(sizeof(struct tnt_stream));
+		s = tnt_mem_pool_alloc(sizeof(struct tnt_stream));
 		if (s == NULL)
 			return NULL;
 	}
@@ -61,11 +61,19 @@ tnt_stream_init(struct tnt_stream *s)
 	return s;
 }
 
+struct tnt_mem_ctx *
+tnt_stream_mem(struct tnt_stream *s, struct tnt_mem_ctx *mem)
+{
+	struct tnt_mem_ctx *old = s->mem;
+	s->mem = mem;
+	return old;
+}
+
 void tnt_stream_free(struct tnt_stream *s) {
 	if (s == NULL)
 		return;
 	if (s->free)
 		s->free(s);
 	if (s->alloc)
-		tnt_mem_free(s);
+		tnt_mem_pool_free(s, sizeof(struct tnt_stream));
 }
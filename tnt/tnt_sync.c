@@ -0,0 +1,9 @@
+#include 		      <stdint.h>
+#include                      <string.h>
+#include                      <stdio.h>
+
+#include		      <tarantool/tnt_mem.h>
+
+#define MH_INCREMENTAL_RESIZE 1
+#define MH_SOURCE             1
+#include                      "tnt_sync.h"
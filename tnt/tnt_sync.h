@@ -0,0 +1,107 @@
+#ifndef TNT_SYNC_H_INCLUDED
+#define TNT_SYNC_H_INCLUDED
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+#include <stdint.h>
+#include <string.h>
+
+#include <tarantool/tnt_mem.h>
+
+/*!
+ * \internal
+ * \file tnt_sync.h
+ * \brief Table of requests in flight, keyed by sync
+ */
+
+struct tnt_sync_entry {
+	uint64_t sync;
+	void *data;
+	void *arg;
+};
+
+static inline void *
+tnt_sync_calloc(size_t count, size_t size) {
+	size_t sz = count * size;
+	void *alloc = tnt_mem_alloc(sz);
+	if (!alloc) return 0;
+	memset(alloc, 0, sz);
+	return alloc;
+}
+
+#define mh_arg_t void *
+
+#define mh_eq(a, b, arg)      ((a)->sync == (b)->sync)
+#define mh_eq_key(a, b, arg)  ((a) == (b)->sync)
+#define mh_hash(x, arg)       ((uint32_t)((x)->sync ^ ((x)->sync >> 32)))
+#define mh_hash_key(x, arg)   ((uint32_t)((x) ^ ((x) >> 32)))
+
+/* type for hash value */
+#define mh_node_t struct tnt_sync_entry
+/* type for hash key */
+#define mh_key_t  uint64_t
+
+#define MH_CALLOC(x, y) tnt_sync_calloc((x), (y))
+#define MH_FREE(x)      tnt_mem_free((x))
+
+#define mh_name               _sync
+#if !defined(MH_SOURCE)
+#define MH_UNDEF              1
+#endif
+#include                      <mhash.h>
+
+/*! \struct mh_sync_t */
+
+/*!
+ * \brief Remember data of request with given sync
+ *
+ * \retval 0  ok
+ * \retval -1 oom
+ */
+static inline int
+tnt_sync_put(struct mh_sync_t *h, uint64_t sync, void *data, void *arg)
+{
+	struct tnt_sync_entry entry = { sync, data, arg };
+	if (mh_sync_put(h, &entry, NULL, NULL) == mh_end(h))
+		return -1;
+	return 0;
+}
+
+/*!
+ * \brief Find request with given sync
+ *
+ * \retval NULL request isn't found
+ */
+static inline struct tnt_sync_entry *
+tnt_sync_find(struct mh_sync_t *h, uint64_t sync)
+{
+	uint32_t pos = mh_sync_find(h, sync, NULL);
+	if (pos == mh_end(h))
+		return NULL;
+	return mh_sync_node(h, pos);
+}
+
+/*!
+ * \brief Remove request with given sync from table
+ *
+ * \returns data of request
+ * \retval NULL request isn't found
+ */
+static inline void *
+tnt_sync_take(struct mh_sync_t *h, uint64_t sync)
+{
+	uint32_t pos = mh_sync_find(h, sync, NULL);
+	if (pos == mh_end(h))
+		return NULL;
+	void *data = mh_sync_node(h, pos)->data;
+	mh_sync_del(h, pos, NULL);
+	return data;
+}
+
+#if defined(__cplusplus)
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* TNT_SYNC_H_INCLUDED */
@@ -147,67 +147,90 @@ int tnt_update_container_reset(struct tnt_stream *ops) {
 	return 0;
 }
 
-static ssize_t
-tnt_update_op(struct tnt_stream *ops, char op, uint32_t fieldno,
-	      const char *opdata, size_t opdata_len) {
-	struct iovec v[2]; size_t v_sz = 2;
-	char body[64], *data; data = body;
+/*
+ * Every operation is encoded right into ops buffer: header of operation
+ * is written into reserved space, value of size bytes goes after it and
+ * tnt_update_op_end() commits it as a single write (container counts
+ * operations by writes).
+ */
+static char *
+tnt_update_op_begin(struct tnt_stream *ops, char op, uint32_t fieldno,
+		    size_t size, size_t *total) {
+	struct tnt_stream_buf *sb = TNT_SBUF_CAST(ops);
+	if (sb->as)
+		return NULL;
+	*total = mp_sizeof_array(tnt_update_op_len(op)) + mp_sizeof_str(1) +
+		 mp_sizeof_uint(fieldno) + size;
+	char *data = sb->resize(ops, *total);
+	if (data == NULL)
+		return NULL;
 	data = mp_encode_array(data, tnt_update_op_len(op));
 	data = mp_encode_str(data, &op, 1);
-	data = mp_encode_uint(data, fieldno);
-	v[0].iov_base = body;
-	v[0].iov_len  = data - body;
-	v[1].iov_base = (void *)opdata;
-	v[1].iov_len  = opdata_len;
+	return mp_encode_uint(data, fieldno);
+}
 
-	return ops->writev(ops, v, v_sz);
+static ssize_t
+tnt_update_op_end(struct tnt_stream *ops, size_t total) {
+	TNT_SBUF_CAST(ops)->size += total;
+	ops->wrcnt++;
+	return total;
+}
+
+static ssize_t
+tnt_update_op(struct tnt_stream *ops, char op, uint32_t fieldno,
+	      const char *opdata, size_t opdata_len) {
+	size_t total;
+	char *data = tnt_update_op_begin(ops, op, fieldno, opdata_len, &total);
+	if (data == NULL)
+		return -1;
+	memcpy(data, opdata, opdata_len);
+	return tnt_update_op_end(ops, total);
 }
 
 ssize_t
 tnt_update_bit(struct tnt_stream *ops, uint32_t fieldno, char op,
 	       uint64_t value) {
 	if (op != '&' && op != '^' && op != '|') return -1;
-	char body[10], *data; data = body;
-	data = mp_encode_uint(data, value);
-	return tnt_update_op(ops, op, fieldno, body, data - body);
+	return tnt_update_value_uint(ops, fieldno, op, value);
 }
 
 ssize_t
 tnt_update_arith_int(struct tnt_stream *ops, uint32_t fieldno, char op,
 		     int64_t value) {
 	if (op != '+' && op != '-') return -1;
-	char body[10], *data; data = body;
-	if (value >= 0)
-		data = mp_encode_uint(data, value);
-	else
-		data = mp_encode_int(data, value);
-	return tnt_update_op(ops, op, fieldno, body, data - body);
+	return tnt_update_value_int(ops, fieldno, op, value);
 }
 
 ssize_t
 tnt_update_arith_float(struct tnt_stream *ops, uint32_t fieldno, char op,
 		       float value) {
 	if (op != '+' && op != '-') return -1;
-	char body[10], *data; data = body;
-	data = mp_encode_float(data, value);
-	return tnt_update_op(ops, op, fieldno, body, data - body);
+	size_t total;
+	char *data = tnt_update_op_begin(ops, op, fieldno,
+					 mp_sizeof_float(value), &total);
+	if (data == NULL)
+		return -1;
+	mp_encode_float(data, value);
+	return tnt_update_op_end(ops, total);
 }
 
 ssize_t
 tnt_update_arith_double(struct tnt_stream *ops, uint32_t fieldno, char op,
 		        double value) {
 	if (op != '+' && op != '-') return -1;
-	char body[10], *data; data = body;
-	data = mp_encode_double(data, value);
-	return tnt_update_op(ops, op, fieldno, body, data - body);
+	return tnt_update_value_double(ops, fieldno, op, value);
 }
 
 ssize_t
 tnt_update_delete(struct tnt_stream *ops, uint32_t fieldno,
 		  uint32_t fieldcount) {
-	char body[10], *data; data = body;
-	data = mp_encode_uint(data, fieldcount);
-	return tnt_update_op(ops, '#', fieldno, body, data - body);
+	size_t total;
+	char *data = tnt_update_op_begin(ops, '#', fieldno,
+					 mp_sizeof_uint(fieldcount), &total);
+	if (data == NULL)
+		return -1;
+	mp_encode_uint(data, fieldcount);
+	return tnt_update_op_end(ops, total);
 }
 
 ssize_t
@@ -232,16 +255,94 @@ ssize_t
 tnt_update_splice(struct tnt_stream *ops, uint32_t fieldno,
 		  uint32_t position, uint32_t offset,
 		  const char *buffer, size_t buffer_len) {
-	size_t buf_size = mp_sizeof_uint(position) +
-		          mp_sizeof_uint(offset) +
-			  mp_sizeof_str(buffer_len);
-	char *buf = tnt_mem_alloc(buf_size), *data = NULL;
-	if (!buf) return -1;
-	data = buf;
+	size_t size = mp_sizeof_uint(position) + mp_sizeof_uint(offset) +
+		      mp_sizeof_str(buffer_len);
+	size_t total;
+	char *data = tnt_update_op_begin(ops, ':', fieldno, size, &total);
+	if (data == NULL)
+		return -1;
 	data = mp_encode_uint(data, position);
 	data = mp_encode_uint(data, offset);
-	data = mp_encode_str(data, buffer, buffer_len);
-	ssize_t retval = tnt_update_op(ops, ':', fieldno, buf, buf_size);
-	tnt_mem_free(buf);
-	return retval;
+	mp_encode_str(data, buffer, buffer_len);
+	return tnt_update_op_end(ops, total);
+}
+
+/* ops with single value argument: assign, insert, arithmetic, bit */
+static inline int
+tnt_update_value_op(char op) {
+	return tnt_update_op_len(op) == 3 && op != '#';
+}
+
+ssize_t
+tnt_update_value_int(struct tnt_stream *ops, uint32_t fieldno, char op,
+		     int64_t value) {
+	if (!tnt_update_value_op(op)) return -1;
+	if (value >= 0)
+		return tnt_update_value_uint(ops, fieldno, op, value);
+	size_t total;
+	char *data = tnt_update_op_begin(ops, op, fieldno,
+					 mp_sizeof_int(value), &total);
+	if (data == NULL)
+		return -1;
+	mp_encode_int(data, value);
+	return tnt_update_op_end(ops, total);
+}
+
+ssize_t
+tnt_update_value_uint(struct tnt_stream *ops, uint32_t fieldno, char op,
+		      uint64_t value) {
+	if (!tnt_update_value_op(op)) return -1;
+	size_t total;
+	char *data = tnt_update_op_begin(ops, op, fieldno,
+					 mp_sizeof_uint(value), &total);
+	if (data == NULL)
+		return -1;
+	mp_encode_uint(data, value);
+	return tnt_update_op_end(ops, total);
+}
+
+ssize_t
+tnt_update_value_double(struct tnt_stream *ops, uint32_t fieldno, char op,
+			double value) {
+	if (!tnt_update_value_op(op)) return -1;
+	size_t total;
+	char *data = tnt_update_op_begin(ops, op, fieldno,
+					 mp_sizeof_double(value), &total);
+	if (data == NULL)
+		return -1;
+	mp_encode_double(data, value);
+	return tnt_update_op_end(ops, total);
+}
+
+ssize_t
+tnt_update_value_bool(struct tnt_stream *ops, uint32_t fieldno, char op,
+		      char value) {
+	if (op != '=' && op != '!') return -1;
+	size_t total;
+	char *data = tnt_update_op_begin(ops, op, fieldno,
+					 mp_sizeof_bool(value), &total);
+	if (data == NULL)
+		return -1;
+	mp_encode_bool(data, value);
+	return tnt_update_op_end(ops, total);
+}
+
+ssize_t
+tnt_update_value_str(struct tnt_stream *ops, uint32_t fieldno, char op,
+		     const char *str, uint32_t len) {
+	if (op != '=' && op != '!') return -1;
+	size_t total;
+	char *data = tnt_update_op_begin(ops, op, fieldno,
+					 mp_sizeof_str(len), &total);
+	if (data == NULL)
+		return -1;
+	mp_encode_str(data, str, len);
+	return tnt_update_op_end(ops, total);
+}
+
+ssize_t
+tnt_update_value_raw(struct tnt_stream *ops, uint32_t fieldno, char op,
+		     const char *value, size_t len) {
+	if (op != '=' && op != '!') return -1;
+	return tnt_update_op(ops, op, fieldno, value, len);
 }
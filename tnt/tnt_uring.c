@@ -0,0 +1,483 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <tarantool/tnt_mem.h>
+#include <tarantool/tnt_net.h>
+#include <tarantool/tnt_uring.h>
+
+#if defined(TNT_HAVE_IO_URING)
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+struct tnt_uring {
+	int fd;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ptr;
+	size_t sq_size;
+	void *cq_ptr;
+	size_t cq_size;
+	size_t sqes_size;
+	unsigned sq_entries;
+	unsigned sq_local_tail; /* tail of queued, but not published sqes */
+	unsigned pending; /* queued, but not yet submitted */
+	unsigned nbufs; /* size of registered buffers table */
+	unsigned char *bufs; /* used pairs of registered buffers table */
+};
+
+#define TNT_URING_OP_MASK 7ULL
+
+static int
+tnt_uring_submit(struct tnt_uring *r, unsigned wait_nr)
+{
+	__atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+	unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+	int rc;
+	do {
+		rc = syscall(__NR_io_uring_enter, r->fd, r->pending, wait_nr,
+			     flags, NULL, 0);
+	} while (rc == -1 && errno == EINTR);
+	if (rc == -1)
+		return -1;
+	r->pending -= rc;
+	return 0;
+}
+
+static struct io_uring_sqe *
+tnt_uring_sqe(struct tnt_uring *r)
+{
+	unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+	if (r->sq_local_tail - head == r->sq_entries) {
+		/* submission queue is full, flush it to kernel */
+		if (tnt_uring_submit(r, 0) == -1)
+			return NULL;
+		head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+		if (r->sq_local_tail - head == r->sq_entries) {
+			errno = EBUSY;
+			return NULL;
+		}
+	}
+	struct io_uring_sqe *sqe = &r->sqes[r->sq_local_tail & *r->sq_mask];
+	memset(sqe, 0, sizeof(*sqe));
+	r->sq_local_tail++;
+	r->pending++;
+	return sqe;
+}
+
+static int
+tnt_uring_sqe_fail(struct tnt_stream_net *s)
+{
+	s->error = TNT_ESYSTEM;
+	s->errno_ = errno;
+	return -1;
+}
+
+static void
+tnt_uring_complete(uint64_t data, int res)
+{
+	/* cancel requests are sent with zero user_data */
+	if (data == 0)
+		return;
+	struct tnt_stream_net *s =
+		(struct tnt_stream_net *)(uintptr_t)(data & ~TNT_URING_OP_MASK);
+	int op = (int)(data & TNT_URING_OP_MASK);
+	s->uring_ops &= ~op;
+	if (res == -ECANCELED)
+		return;
+	switch (op) {
+	case TNT_URING_SEND:
+		if (res < 0)
+			break;
+		/* data, that was appended while send was in flight, stays */
+		memmove(s->sbuf.buf, s->sbuf.buf + res, s->sbuf.off - res);
+		s->sbuf.off -= res;
+		return;
+	case TNT_URING_RECV:
+		if (res == 0)
+			res = -ECONNRESET;
+		if (res < 0)
+			break;
+		s->rbuf.top += res;
+		return;
+	default:
+		return;
+	}
+	s->uring_errno = -res;
+}
+
+static int
+tnt_uring_reap(struct tnt_uring *r)
+{
+	unsigned head = *r->cq_head;
+	int count = 0;
+	while (head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+		struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+		tnt_uring_complete(cqe->user_data, cqe->res);
+		head++;
+		count++;
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+	return count;
+}
+
+static void
+tnt_uring_register_init(struct tnt_uring *r)
+{
+#if defined(IORING_RSRC_REGISTER_SPARSE)
+	unsigned nbufs = r->sq_entries * 2;
+	r->bufs = tnt_mem_alloc(nbufs / 2);
+	if (r->bufs == NULL)
+		return;
+	memset(r->bufs, 0, nbufs / 2);
+	struct io_uring_rsrc_register reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.nr = nbufs;
+	reg.flags = IORING_RSRC_REGISTER_SPARSE;
+	if (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_BUFFERS2,
+		    &reg, sizeof(reg)) == -1) {
+		tnt_mem_free(r->bufs);
+		r->bufs = NULL;
+		return;
+	}
+	r->nbufs = nbufs;
+#else
+	(void)r;
+#endif
+}
+
+struct tnt_uring *
+tnt_uring_new(unsigned entries)
+{
+	struct tnt_uring *r = tnt_mem_alloc(sizeof(struct tnt_uring));
+	if (r == NULL)
+		return NULL;
+	memset(r, 0, sizeof(struct tnt_uring));
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	r->fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (r->fd == -1) {
+		tnt_mem_free(r);
+		return NULL;
+	}
+	r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (r->cq_size > r->sq_size)
+			r->sq_size = r->cq_size;
+		r->cq_size = r->sq_size;
+	}
+	r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ptr == MAP_FAILED)
+		goto error;
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_ptr = r->sq_ptr;
+	} else {
+		r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE,
+				 MAP_SHARED | MAP_POPULATE, r->fd,
+				 IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED) {
+			r->cq_ptr = NULL;
+			goto error;
+		}
+	}
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+		       MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {
+		r->sqes = NULL;
+		goto error;
+	}
+	char *sq = r->sq_ptr, *cq = r->cq_ptr;
+	r->sq_head = (unsigned *)(sq + p.sq_off.head);
+	r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	r->cq_head = (unsigned *)(cq + p.cq_off.head);
+	r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	r->sq_entries = p.sq_entries;
+	r->sq_local_tail = *r->sq_tail;
+	/* sqes are used in order, so index array is identity */
+	unsigned *array = (unsigned *)(sq + p.sq_off.array);
+	for (unsigned i = 0; i < p.sq_entries; ++i)
+		array[i] = i;
+	tnt_uring_register_init(r);
+	return r;
+error:
+	tnt_uring_free(r);
+	return NULL;
+}
+
+void
+tnt_uring_free(struct tnt_uring *r)
+{
+	if (r == NULL)
+		return;
+	if (r->sqes)
+		munmap(r->sqes, r->sqes_size);
+	if (r->cq_ptr && r->cq_ptr != r->sq_ptr)
+		munmap(r->cq_ptr, r->cq_size);
+	if (r->sq_ptr && r->sq_ptr != MAP_FAILED)
+		munmap(r->sq_ptr, r->sq_size);
+	close(r->fd);
+	tnt_mem_free(r->bufs);
+	tnt_mem_free(r);
+}
+
+int
+tnt_uring_enter(struct tnt_uring *r, unsigned wait_nr)
+{
+	if (r->pending > 0 || wait_nr > 0) {
+		/* don't sleep, if completions are already here */
+		if (*r->cq_head != __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE))
+			wait_nr = 0;
+		if (tnt_uring_submit(r, wait_nr) == -1)
+			return -1;
+	}
+	return tnt_uring_reap(r);
+}
+
+static int
+tnt_uring_update(struct tnt_uring *r, unsigned offset, struct iovec *iov)
+{
+#if defined(IORING_RSRC_REGISTER_SPARSE)
+	struct io_uring_rsrc_update2 up;
+	memset(&up, 0, sizeof(up));
+	up.offset = offset;
+	up.data = (uint64_t)(uintptr_t)iov;
+	up.nr = 2;
+	if (syscall(__NR_io_uring_register, r->fd,
+		    IORING_REGISTER_BUFFERS_UPDATE, &up, sizeof(up)) == -1)
+		return -1;
+	return 0;
+#else
+	(void)r; (void)offset; (void)iov;
+	return -1;
+#endif
+}
+
+void
+tnt_uring_attach(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	s->uring_buf = -1;
+	unsigned i;
+	for (i = 0; i < r->nbufs / 2 && r->bufs[i]; ++i)
+		;
+	if (i == r->nbufs / 2)
+		return;
+	struct iovec iov[2] = {
+		{ s->sbuf.buf, s->sbuf.size },
+		{ s->rbuf.buf, s->rbuf.size }
+	};
+	if (tnt_uring_update(r, i * 2, iov) == -1)
+		return;
+	r->bufs[i] = 1;
+	s->uring_buf = i * 2;
+}
+
+void
+tnt_uring_detach(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	if (s->uring_buf == -1)
+		return;
+	struct iovec iov[2];
+	memset(iov, 0, sizeof(iov));
+	tnt_uring_update(r, s->uring_buf, iov);
+	r->bufs[s->uring_buf / 2] = 0;
+	s->uring_buf = -1;
+}
+
+int
+tnt_uring_send(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	if ((s->uring_ops & TNT_URING_SEND) || s->sbuf.off == 0)
+		return 0;
+	struct io_uring_sqe *sqe = tnt_uring_sqe(r);
+	if (sqe == NULL)
+		return tnt_uring_sqe_fail(s);
+	if (s->uring_buf != -1) {
+		sqe->opcode = IORING_OP_WRITE_FIXED;
+		sqe->buf_index = s->uring_buf;
+	} else {
+		sqe->opcode = IORING_OP_SEND;
+	}
+	sqe->fd = s->fd;
+	sqe->addr = (uint64_t)(uintptr_t)s->sbuf.buf;
+	sqe->len = s->sbuf.off;
+	sqe->user_data = (uint64_t)(uintptr_t)s | TNT_URING_SEND;
+	s->uring_ops |= TNT_URING_SEND;
+	return 0;
+}
+
+int
+tnt_uring_recv(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	if ((s->uring_ops & TNT_URING_RECV) || s->rbuf.top == s->rbuf.size)
+		return 0;
+	struct io_uring_sqe *sqe = tnt_uring_sqe(r);
+	if (sqe == NULL)
+		return tnt_uring_sqe_fail(s);
+	if (s->uring_buf != -1) {
+		sqe->opcode = IORING_OP_READ_FIXED;
+		sqe->buf_index = s->uring_buf + 1;
+	} else {
+		sqe->opcode = IORING_OP_RECV;
+	}
+	sqe->fd = s->fd;
+	sqe->addr = (uint64_t)(uintptr_t)(s->rbuf.buf + s->rbuf.top);
+	sqe->len = s->rbuf.size - s->rbuf.top;
+	sqe->user_data = (uint64_t)(uintptr_t)s | TNT_URING_RECV;
+	s->uring_ops |= TNT_URING_RECV;
+	return 0;
+}
+
+int
+tnt_uring_poll(struct tnt_uring *r, struct tnt_stream_net *s, int events)
+{
+	if (s->uring_ops & TNT_URING_POLL)
+		return 0;
+	struct io_uring_sqe *sqe = tnt_uring_sqe(r);
+	if (sqe == NULL)
+		return tnt_uring_sqe_fail(s);
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = s->fd;
+	sqe->poll32_events = events;
+	sqe->user_data = (uint64_t)(uintptr_t)s | TNT_URING_POLL;
+	s->uring_ops |= TNT_URING_POLL;
+	return 0;
+}
+
+void
+tnt_uring_cancel(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	int op, cancelled = 0;
+	/* buffers must not be touched by kernel after return */
+	while (s->uring_ops != 0) {
+		/* full queue is drained by enter, cancels are queued then */
+		for (op = TNT_URING_SEND; op <= TNT_URING_POLL; op <<= 1) {
+			if (!(s->uring_ops & op) || (cancelled & op))
+				continue;
+			struct io_uring_sqe *sqe = tnt_uring_sqe(r);
+			if (sqe == NULL)
+				break;
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->fd = -1;
+			sqe->addr = (uint64_t)(uintptr_t)s | op;
+			cancelled |= op;
+		}
+		if (tnt_uring_enter(r, 1) == -1)
+			break;
+	}
+	s->uring_errno = 0;
+}
+
+#else /* !defined(TNT_HAVE_IO_URING) */
+
+struct tnt_uring *
+tnt_uring_new(unsigned entries)
+{
+	(void)entries;
+	errno = ENOSYS;
+	return NULL;
+}
+
+void
+tnt_uring_free(struct tnt_uring *r)
+{
+	(void)r;
+}
+
+int
+tnt_uring_enter(struct tnt_uring *r, unsigned wait_nr)
+{
+	(void)r; (void)wait_nr;
+	errno = ENOSYS;
+	return -1;
+}
+
+void
+tnt_uring_attach(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	(void)r;
+	s->uring_buf = -1;
+}
+
+void
+tnt_uring_detach(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	(void)r; (void)s;
+}
+
+int
+tnt_uring_send(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	(void)r;
+	s->error = TNT_ESYSTEM;
+	s->errno_ = ENOSYS;
+	return -1;
+}
+
+int
+tnt_uring_recv(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	return tnt_uring_send(r, s);
+}
+
+int
+tnt_uring_poll(struct tnt_uring *r, struct tnt_stream_net *s, int events)
+{
+	(void)events;
+	return tnt_uring_send(r, s);
+}
+
+void
+tnt_uring_cancel(struct tnt_uring *r, struct tnt_stream_net *s)
+{
+	(void)r; (void)s;
+}
+
+#endif /* defined(TNT_HAVE_IO_URING) */
@@ -0,0 +1,209 @@
+/*
+ * Redistribution and use in source and binary forms, with or
+ * without modification, are permitted provided that the following
+ * conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above
+ *    copyright notice, this list of conditions and the
+ *    following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials
+ *    provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY <COPYRIGHT HOLDER> ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED
+ * TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+ * <COPYRIGHT HOLDER> OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+ * BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ * LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+ * THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <tarantool/tnt_mem.h>
+
+#include "tnt_wheel.h"
+
+#define TNT_WHEEL_MASK (TNT_WHEEL_SLOTS - 1)
+
+struct tnt_wheel *
+tnt_wheel_new(int64_t now)
+{
+	struct tnt_wheel *w = tnt_mem_alloc(sizeof(struct tnt_wheel));
+	if (w == NULL)
+		return NULL;
+	memset(w, 0, sizeof(struct tnt_wheel));
+	w->now = now;
+	return w;
+}
+
+static void
+tnt_wheel_link(struct tnt_wheel *w, struct tnt_timer *t)
+{
+	int64_t expire = t->expire > w->now ? t->expire : w->now;
+	int64_t block = 0;
+	int level;
+	for (level = 0; level < TNT_WHEEL_LEVELS; level++) {
+		int shift = TNT_WHEEL_BITS * level;
+		block = expire >> shift;
+		if (block - (w->now >> shift) < TNT_WHEEL_SLOTS)
+			break;
+	}
+	if (level == TNT_WHEEL_LEVELS) {
+		/* too far, timer is moved, when the last block is reached */
+		level = TNT_WHEEL_LEVELS - 1;
+		block = (w->now >> (TNT_WHEEL_BITS * level)) +
+			TNT_WHEEL_SLOTS - 1;
+	}
+	struct tnt_timer **slot = &w->slots[level][block & TNT_WHEEL_MASK];
+	t->next = *slot;
+	if (t->next != NULL)
+		t->next->prev = &t->next;
+	t->prev = slot;
+	*slot = t;
+}
+
+static void
+tnt_wheel_unlink(struct tnt_timer *t)
+{
+	*t->prev = t->next;
+	if (t->next != NULL)
+		t->next->prev = t->prev;
+}
+
+void
+tnt_wheel_release(struct tnt_wheel *w, struct tnt_timer *t)
+{
+	t->next = w->free;
+	w->free = t;
+}
+
+void
+tnt_wheel_clear(struct tnt_wheel *w)
+{
+	int level, i;
+	for (level = 0; level < TNT_WHEEL_LEVELS; level++) {
+		for (i = 0; i < TNT_WHEEL_SLOTS; i++) {
+			struct tnt_timer *t = w->slots[level][i];
+			while (t != NULL) {
+				struct tnt_timer *next = t->next;
+				tnt_wheel_release(w, t);
+				t = next;
+			}
+			w->slots[level][i] = NULL;
+		}
+	}
+	w->count = 0;
+}
+
+void
+tnt_wheel_free(struct tnt_wheel *w)
+{
+	tnt_wheel_clear(w);
+	while (w->free != NULL) {
+		struct tnt_timer *t = w->free;
+		w->free = t->next;
+		tnt_mem_free(t);
+	}
+	tnt_mem_free(w);
+}
+
+struct tnt_timer *
+tnt_wheel_add(struct tnt_wheel *w, uint64_t sync, int64_t expire)
+{
+	struct tnt_timer *t = w->free;
+	if (t != NULL)
+		w->free = t->next;
+	else if ((t = tnt_mem_alloc(sizeof(struct tnt_timer))) == NULL)
+		return NULL;
+	t->sync = sync;
+	t->expire = expire;
+	tnt_wheel_link(w, t);
+	w->count++;
+	return t;
+}
+
+void
+tnt_wheel_del(struct tnt_wheel *w, struct tnt_timer *t)
+{
+	tnt_wheel_unlink(t);
+	tnt_wheel_release(w, t);
+	w->count--;
+}
+
+struct tnt_timer *
+tnt_wheel_advance(struct tnt_wheel *w, int64_t now)
+{
+	if (now < w->now)
+		now = w->now;
+	if (w->count == 0) {
+		w->now = now;
+		return NULL;
+	}
+	/* timers of passed blocks are taken out and expired or relinked */
+	struct tnt_timer *passed = NULL, *expired = NULL;
+	int level;
+	for (level = 0; level < TNT_WHEEL_LEVELS; level++) {
+		int shift = TNT_WHEEL_BITS * level;
+		int64_t block = w->now >> shift, to = now >> shift;
+		if (to - block >= TNT_WHEEL_SLOTS)
+			to = block + TNT_WHEEL_SLOTS - 1;
+		for (; block <= to; block++) {
+			struct tnt_timer **slot =
+				&w->slots[level][block & TNT_WHEEL_MASK];
+			while (*slot != NULL) {
+				struct tnt_timer *t = *slot;
+				tnt_wheel_unlink(t);
+				t->next = passed;
+				passed = t;
+			}
+		}
+	}
+	w->now = now;
+	while (passed != NULL) {
+		struct tnt_timer *t = passed;
+		passed = t->next;
+		if (t->expire <= now) {
+			t->next = expired;
+			expired = t;
+			w->count--;
+		} else {
+			tnt_wheel_link(w, t);
+		}
+	}
+	return expired;
+}
+
+int64_t
+tnt_wheel_next(struct tnt_wheel *w)
+{
+	if (w->count == 0)
+		return -1;
+	int64_t next = -1;
+	int level, i;
+	for (level = 0; level < TNT_WHEEL_LEVELS; level++) {
+		int shift = TNT_WHEEL_BITS * level;
+		int64_t block = w->now >> shift;
+		for (i = 0; i < TNT_WHEEL_SLOTS; i++, block++) {
+			if (w->slots[level][block & TNT_WHEEL_MASK] == NULL)
+				continue;
+			int64_t start = block << shift;
+			if (start < w->now)
+				start = w->now;
+			if (next == -1 || start < next)
+				next = start;
+			break;
+		}
+	}
+	return next;
+}
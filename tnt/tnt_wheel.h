@@ -0,0 +1,103 @@
+#ifndef TNT_WHEEL_H_INCLUDED
+#define TNT_WHEEL_H_INCLUDED
+
+#if defined(__cplusplus)
+extern "C" {
+#endif /* defined(__cplusplus) */
+
+#include <stdint.h>
+
+/*!
+ * \internal
+ * \file tnt_wheel.h
+ * \brief Hierarchical timing wheel of request deadlines
+ *
+ * Time is counted in milliseconds of monotonic clock. Level L keeps
+ * timers, expiring in one of 64 next blocks of 64^L milliseconds, a timer
+ * moves to lower levels, when its block becomes current. Adding and
+ * removing timer is O(1), advancing touches only passed slots.
+ */
+
+#define TNT_WHEEL_BITS 6
+#define TNT_WHEEL_SLOTS (1 << TNT_WHEEL_BITS)
+#define TNT_WHEEL_LEVELS 4
+
+struct tnt_timer {
+	uint64_t sync; /*!< sync of request */
+	int64_t expire; /*!< deadline, msec */
+	struct tnt_timer *next;
+	struct tnt_timer **prev; /*!< pointer, that points to this timer */
+};
+
+struct tnt_wheel {
+	int64_t now; /*!< time of last advance, msec */
+	int count; /*!< timers in wheel */
+	struct tnt_timer *slots[TNT_WHEEL_LEVELS][TNT_WHEEL_SLOTS];
+	struct tnt_timer *free; /*!< released timers */
+};
+
+/*!
+ * \brief Create wheel, starting at now (msec)
+ */
+struct tnt_wheel *
+tnt_wheel_new(int64_t now);
+
+/*!
+ * \brief Free wheel with all timers
+ */
+void
+tnt_wheel_free(struct tnt_wheel *w);
+
+/*!
+ * \brief Release all timers in wheel
+ */
+void
+tnt_wheel_clear(struct tnt_wheel *w);
+
+/*!
+ * \brief Add timer, expiring at expire (msec)
+ *
+ * \returns timer
+ * \retval  NULL oom
+ */
+struct tnt_timer *
+tnt_wheel_add(struct tnt_wheel *w, uint64_t sync, int64_t expire);
+
+/*!
+ * \brief Remove timer from wheel and release it
+ */
+void
+tnt_wheel_del(struct tnt_wheel *w, struct tnt_timer *t);
+
+/*!
+ * \brief Release timer, returned by tnt_wheel_advance()
+ */
+void
+tnt_wheel_release(struct tnt_wheel *w, struct tnt_timer *t);
+
+/*!
+ * \brief Advance wheel to now (msec)
+ *
+ * \returns list of expired timers (linked by next), they are removed
+ *          from wheel and released by tnt_wheel_release()
+ */
+struct tnt_timer *
+tnt_wheel_advance(struct tnt_wheel *w, int64_t now);
+
+/*!
+ * \brief Get time of the nearest expiration
+ *
+ * Timers of upper levels are accounted by start of their block, so
+ * result may be earlier, than real expiration.
+ *
+ * \returns msec
+ * \retval  -1 wheel is empty
+ */
+int64_t
+tnt_wheel_next(struct tnt_wheel *w);
+
+#if defined(__cplusplus)
+}
+#endif /* defined(__cplusplus) */
+
+#endif /* TNT_WHEEL_H_INCLUDED */